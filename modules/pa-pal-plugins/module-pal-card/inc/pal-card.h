@@ -111,11 +111,14 @@ typedef enum {
     PA_PAL_CARD_USECASE_TYPE_DYNAMIC = 1,
 } pa_pal_card_usecase_type_t;
 
+/* software fade around an asynchronous device switch, driven by the control
+ * worker and stepped by the thread moving the audio */
 typedef enum {
-    PA_PAL_NO_EVENT = -1,
-    PA_PAL_VOLUME_APPLY = 1,
-    PA_PAL_DEVICE_SWITCH,
-} pa_pal_ctrl_event_t;
+    PA_PAL_SWITCH_IDLE,
+    PA_PAL_SWITCH_FADE_OUT, /* next buffer is ramped down */
+    PA_PAL_SWITCH_MUTED,    /* ramp is out, the device may be switched */
+    PA_PAL_SWITCH_FADE_IN,  /* switched, next buffer is ramped up */
+} pa_pal_switch_state_t;
 
 typedef struct {
     pal_device_id_t device;
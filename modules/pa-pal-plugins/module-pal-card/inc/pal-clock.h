@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalclockfoo
+#define foopalclockfoo
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Time base shared with the DSP. PAL stamps pal_get_timestamp() with the
+ * architected system counter, so on ARM the counter is read directly and
+ * scaled with the frequency published in CNTFRQ. Other hosts fall back to
+ * CLOCK_MONOTONIC, which is what the PAL stub stamps with.
+ *
+ * The file has no PulseAudio dependencies so it can be built and exercised
+ * on its own on x86.
+ */
+
+/* counter frequency in Hz, read once */
+uint64_t pa_pal_clock_get_frequency(void);
+
+/* current counter value in us */
+uint64_t pa_pal_clock_now_us(void);
+
+/*
+ * Second order delay locked loop smoothing a stream position against the
+ * clock. Each update takes a raw (clock, position) pair, both in us, and
+ * returns the filtered position at that clock time. The output never goes
+ * backwards unless the loop is reset, which happens by itself when the raw
+ * position jumps by more than PA_PAL_CLOCK_DLL_MAX_ERROR_US. It is never more
+ * than PA_PAL_CLOCK_DLL_MAX_LEAD_US ahead of the raw position either, so a
+ * stalled DSP is not extrapolated into latency and underrun accounting.
+ */
+#define PA_PAL_CLOCK_DLL_BANDWIDTH_HZ 0.5
+#define PA_PAL_CLOCK_DLL_MAX_ERROR_US 10000
+#define PA_PAL_CLOCK_DLL_MAX_LEAD_US 2000
+
+typedef struct {
+    bool valid;
+    uint64_t base_clock_us;
+    double base_pos_us;
+    double rate;
+    uint64_t last_pos_us;
+} pa_pal_clock_dll;
+
+void pa_pal_clock_dll_reset(pa_pal_clock_dll *dll);
+uint64_t pa_pal_clock_dll_update(pa_pal_clock_dll *dll, uint64_t clock_us, uint64_t pos_us);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopaldumpfoo
+#define foopaldumpfoo
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <pulse/sample.h>
+#include <pulsecore/atomic.h>
+
+/*
+ * PCM tap for field captures. The realtime side only copies into a lock-free
+ * ring, a low priority thread drains it to the file. When the ring is full
+ * the buffer is dropped and counted rather than stalling the caller.
+ */
+typedef struct pa_pal_dump pa_pal_dump;
+
+/* a bare file name, no '/' and no "..", so it cannot leave the dump directory */
+bool pa_pal_dump_name_valid(const char *name);
+
+/* wav adds a RIFF header, patched with the final size on free. path must not exist yet */
+pa_pal_dump *pa_pal_dump_new(const char *path, const pa_sample_spec *ss, bool wav);
+void pa_pal_dump_write(pa_pal_dump *d, const void *data, size_t length);
+void pa_pal_dump_free(pa_pal_dump *d);
+
+/*
+ * Where a stream keeps its tap. The realtime side writes through it without a
+ * lock, the control side swaps the tap and waits for a write in progress
+ * before freeing the old one.
+ */
+typedef struct pa_pal_dump_slot {
+    pa_atomic_ptr_t dump;
+    pa_atomic_t users;
+} pa_pal_dump_slot;
+
+/* realtime side, a no-op while no tap is set */
+void pa_pal_dump_slot_write(pa_pal_dump_slot *s, const void *data, size_t length);
+/* installs d, NULL to stop, and frees the previous tap */
+void pa_pal_dump_slot_set(pa_pal_dump_slot *s, pa_pal_dump *d);
+
+#endif
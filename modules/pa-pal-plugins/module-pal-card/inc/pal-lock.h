@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopallockfoo
+#define foopallockfoo
+
+#include <pulsecore/mutex.h>
+
+#include "pal-stats.h"
+
+/*
+ * Lock a pal sink or source shares between its realtime I/O and PAL threads
+ * and its control paths. It inherits priority, so a control thread holding
+ * it is boosted to the realtime thread it blocks instead of being preempted
+ * with the lock held. Every acquisition records in the owner's stats how
+ * long it was waited for, if it was contended, and how long it was held.
+ */
+typedef struct pa_pal_lock pa_pal_lock;
+
+pa_pal_lock *pa_pal_lock_new(pa_pal_stats *stats);
+void pa_pal_lock_free(pa_pal_lock *l);
+
+void pa_pal_lock_acquire(pa_pal_lock *l);
+void pa_pal_lock_release(pa_pal_lock *l);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalpcmconvertfoo
+#define foopalpcmconvertfoo
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <pulse/sample.h>
+
+/*
+ * Conversion between the sample formats PulseAudio mixes in and packed 24 bit
+ * little endian (PAL_AUDIO_FMT_PCM_S24_3LE), done by the module instead of
+ * PulseAudio's generic per sample converters. Float is clamped to [-1, 1]
+ * and scaled by 0x7fffff when packing, 24 bit is scaled by 2^-31 from its
+ * S32 position when unpacking, like PulseAudio does. Every implementation
+ * gives bit identical results. Only depends on libpulse, so tools can link
+ * it directly.
+ */
+typedef enum {
+    PA_PAL_PCM_CONVERT_SCALAR,
+    PA_PAL_PCM_CONVERT_SSSE3,
+    PA_PAL_PCM_CONVERT_NEON,
+    PA_PAL_PCM_CONVERT_MAX,
+} pa_pal_pcm_convert_impl_t;
+
+/* sample sizes on either side of a conversion */
+#define PA_PAL_PCM_CONVERT_HOST_BYTES 4
+#define PA_PAL_PCM_CONVERT_PACKED_BYTES 3
+
+/* n samples, not frames. dst and src must not overlap. */
+typedef void (*pa_pal_pcm_convert_func_t)(void *dst, const void *src, size_t n);
+
+/* float32le, s32le and s24-32le */
+bool pa_pal_pcm_convert_supported(pa_sample_format_t format);
+
+bool pa_pal_pcm_convert_impl_available(pa_pal_pcm_convert_impl_t impl);
+const char *pa_pal_pcm_convert_impl_to_string(pa_pal_pcm_convert_impl_t impl);
+/* fastest one this CPU runs, PA_PAL_PCM_CONVERT=scalar|ssse3|neon overrides it */
+pa_pal_pcm_convert_impl_t pa_pal_pcm_convert_best(void);
+
+/* NULL if the format or the implementation is not supported */
+pa_pal_pcm_convert_func_t pa_pal_pcm_convert_get_pack(pa_pal_pcm_convert_impl_t impl, pa_sample_format_t format);
+pa_pal_pcm_convert_func_t pa_pal_pcm_convert_get_unpack(pa_pal_pcm_convert_impl_t impl, pa_sample_format_t format);
+
+#endif
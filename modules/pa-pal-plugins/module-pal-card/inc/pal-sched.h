@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalschedfoo
+#define foopalschedfoo
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pulsecore/core.h>
+
+/*
+ * Scheduling of an audio thread: policy, realtime priority and the CPUs it
+ * may run on. A thread applies its own configuration when it starts, fields
+ * left at zero keep what the daemon would do without one.
+ */
+typedef enum {
+    PA_PAL_SCHED_POLICY_DEFAULT, /* realtime if the daemon has realtime scheduling enabled */
+    PA_PAL_SCHED_POLICY_FIFO,
+    PA_PAL_SCHED_POLICY_RR,
+    PA_PAL_SCHED_POLICY_OTHER, /* never realtime */
+} pa_pal_sched_policy_t;
+
+typedef struct {
+    pa_pal_sched_policy_t policy;
+    int priority; /* 0 uses the daemon's realtime priority */
+    uint64_t cpu_mask; /* bit n is CPU n, 0 runs anywhere */
+} pa_pal_sched_config;
+
+/* fifo, rr or other */
+int pa_pal_sched_parse_policy(const char *s, pa_pal_sched_policy_t *policy);
+/* 1 to 99 */
+int pa_pal_sched_parse_priority(const char *s, int *priority);
+/* a CPU list like 4-7,9 or a hex mask like 0xf0 */
+int pa_pal_sched_parse_cpu_mask(const char *s, uint64_t *mask);
+
+/* calling thread only. core may be NULL for threads that are not realtime by default. */
+void pa_pal_sched_apply(const pa_pal_sched_config *cfg, pa_core *core, const char *name);
+
+#endif
@@ -12,23 +12,41 @@
 #include <pulsecore/card.h>
 #include <pulsecore/core.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/memchunk.h>
+#include <pulsecore/mutex.h>
 
 #include <PalApi.h>
 #include <PalDefs.h>
 
 #include "pal-card.h"
+#include "pal-clock.h"
+#include "pal-dump.h"
+#include "pal-lock.h"
+#include "pal-stats.h"
+#include "pal-stream-cache.h"
+#include "pal-worker.h"
+#include "pal-pcm-convert.h"
+#include "pal-sched.h"
+#include "pal-volume.h"
 
-typedef enum {
-    PAL_SINK_MESSAGE_WRITE_READY,
-} pal_msgs_t;
+/* number of rendered PCM buffers the sink I/O thread may queue ahead of the PAL thread */
+#define PAL_SINK_RING_DEPTH 2
+/* compressed sinks keep up to buffer_count encoded buffers in flight, capped here */
+#define PAL_SINK_RING_MAX_DEPTH 8
 
+/* Adaptive PAL buffer size for PCM sinks, stepped by the sink I/O thread
+ * from the underrun and late write counters, see pa_pal_sink_adapt_update */
 typedef struct {
-    pa_msgobject parent;
-    void *userdata;
-} pal_msg_obj;
-
-PA_DEFINE_PRIVATE_CLASS(pal_msg_obj, pa_msgobject);
-#define PAL_MSG_OBJ(o) (pal_msg_obj_cast(o))
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t cur_ms; /* size of the open session */
+    uint32_t target_ms; /* applied at the next safe point */
+    uint64_t errors; /* underruns + late writes at the window start */
+    pa_usec_t window_end;
+    unsigned clean_windows;
+    unsigned shrink_windows; /* clean windows needed before shrinking */
+    unsigned since_shrink; /* windows since the last shrink */
+} pa_pal_sink_adapt;
 
 typedef struct {
     char *name;
@@ -49,6 +67,16 @@ typedef struct {
     pa_pal_card_usecase_type_t usecase_type;
     uint32_t buffer_size;
     uint32_t buffer_count;
+    bool tsched;
+    uint32_t tsched_watermark_ms;
+    bool gapless;
+    uint32_t standby_hold_ms;
+    uint32_t stream_cache_size;
+    uint32_t adaptive_buffer_min_ms;
+    uint32_t adaptive_buffer_max_ms;
+    pa_sample_format_t convert_format; /* format an s24le sink renders in, packed by the module */
+    uint32_t volume_ramp_ms;
+    pa_pal_sched_config sched; /* I/O and PAL writer threads */
 } pa_pal_sink_config;
 
 typedef struct {
@@ -61,28 +89,97 @@ typedef struct {
     size_t buffer_size;
     size_t buffer_count;
     uint32_t sink_latency_us;
-    uint64_t bytes_written;
+    uint64_t bytes_written; /* atomic, see pa_pal_sink_bytes_written */
+    /* smooths the DSP position used for latency reports */
+    pa_pal_clock_dll latency_dll;
 
-    int write_fd;
+    pa_pal_dump_slot dump; /* optional PCM tap */
     int index;
 
     bool standby;
-    pa_mutex *mutex;
+    pa_pal_lock *lock; /* serialises PAL calls between the PAL thread and control callbacks */
+    pa_mutex *write_mutex; /* held across pal_stream_write instead of lock, taken before it to close or flush */
 
     /* Sink events */
     pa_fdsem *pal_fdsem;
-    pa_cond *cond_ctrl_thread;
-    pa_pal_ctrl_event_t sink_event_id;
 
     /* PAL sink_write thread */
-    pal_msg_obj *pal_msg;
     pa_thread_mq pal_thread_mq;
     pa_thread *pal_thread;
     pa_rtpoll *pal_thread_rtpoll;
     pa_rtpoll_item *pal_rtpoll_item;
     pa_atomic_t restart_in_progress;
-    pa_atomic_t write_done;
     pa_atomic_t close_output;
+    pa_atomic_t drain_pending; /* compressed drain deferred until the ring is written out */
+    pa_atomic_t write_ready; /* set by WRITE_READY only, pal_fdsem is posted for other reasons too */
+
+    /* Lock-free SPSC ring of rendered chunks, produced by the sink I/O thread
+     * and consumed by the PAL thread. ring_fill is the only shared index,
+     * each side owns its own read/write index. Indices wrap at the array
+     * size, the usable depth depends on the stream, see pa_pal_sink_ring_depth. */
+    pa_memchunk ring[PAL_SINK_RING_MAX_DEPTH];
+    int ring_seq[PAL_SINK_RING_MAX_DEPTH];
+    pa_usec_t ring_time[PAL_SINK_RING_MAX_DEPTH]; /* when the chunk was rendered */
+    int ring_track[PAL_SINK_RING_MAX_DEPTH]; /* gapless track the chunk belongs to */
+    unsigned ring_write_index;
+    unsigned ring_read_index;
+    pa_atomic_t ring_fill;
+    pa_atomic_t ring_bytes;
+    pa_atomic_t rewind_seq; /* bumped by every rewind, stale ring chunks are dropped */
+    pa_atomic_t flush_pending; /* a rewind waits for the PAL thread to flush the stream */
+    pa_atomic_t dll_reset; /* set by the PAL thread after rebasing bytes_written */
+
+    /* timer based scheduling for PCM sinks, see pa_pal_sink_tsched_fill */
+    bool tsched;
+    pa_usec_t tsched_watermark_us;
+    pa_usec_t tsched_watermark_cfg_us; /* before clamping to the buffer geometry */
+
+    /* adaptive buffer size for PCM sinks, see pa_pal_sink_adapt_update */
+    bool adaptive;
+    pa_pal_sink_adapt adapt; /* sink I/O thread only */
+    pa_usec_t late_write_us; /* a chunk rendered longer ago than this starved the DSP */
+
+    /* ultra low latency: the sink I/O thread renders straight into the DSP
+     * buffer, paced by its read position, see pa_pal_sink_mmap_fill */
+    bool mmap;
+    struct pal_mmap_buffer mmap_buffer;
+    uint64_t mmap_written; /* frames, sink I/O thread only */
+    uint64_t mmap_read; /* frames the DSP consumed */
+    int32_t mmap_position; /* raw PAL position of the last query */
+
+    /* gapless offload, see pa_pal_sink_gapless_queue_track */
+    bool gapless;
+    pa_atomic_t track; /* bumped for every track continued on the open session */
+    int written_track; /* last track handed to PAL, PAL thread only */
+    struct pal_compr_gapless_mdata next_gapless_mdata; /* under lock */
+    pal_param_payload *gapless_payload; /* allocated with a gapless compressed session */
+
+    /* warm standby: a suspended PCM sink keeps its session paused for
+     * standby_hold_us before closing it, see pa_pal_sink_standby */
+    pa_usec_t standby_hold_us;
+    pa_usec_t standby_deadline;
+    pa_atomic_t warm; /* session paused and owned by whoever clears this first */
+
+    pa_pal_stream_cache *stream_cache; /* stopped sessions of earlier media configs, NULL if disabled */
+
+    /* device switches run on the control worker, see pa_pal_sink_switch_device */
+    pa_pal_worker *ctrl_worker;
+    pa_pal_volume *volume; /* sent by ctrl_worker, latest update wins */
+    pa_pal_sched_config sched;
+    pa_atomic_t switch_state; /* pa_pal_switch_state_t */
+    void *switch_buf; /* faded copy of the chunk, PAL thread only */
+    size_t switch_buf_size;
+
+    /* PulseAudio renders in a 32 bit format, packed to 24 bit for PAL by the
+     * PAL thread. buffer_size and the byte counters stay in rendered bytes,
+     * see pa_pal_sink_pal_bytes. NULL when PAL gets what was rendered. */
+    pa_pal_pcm_convert_func_t convert;
+    void *convert_buf;
+    size_t convert_buf_size;
+
+    pa_pal_stats stats;
+    bool underrun; /* DSP queue ran dry, counted once per episode */
+    pa_usec_t start_time; /* atomic, 0 once the first write after a start completed */
 
     pa_encoding_t encoding;
     bool compressed;
@@ -129,6 +226,9 @@ void pa_pal_sink_module_deinit(void);
 int pa_pal_sink_get_media_config(pa_pal_sink_handle_t *handle, pa_sample_spec *ss, pa_channel_map *map, pa_encoding_t *encoding);
 pa_idxset* pa_pal_sink_get_config(pa_pal_sink_handle_t *handle);
 int pa_pal_sink_set_a2dp_suspend(const char *prm_value);
+char *pa_pal_sink_get_stats(pa_sink *s);
+void pa_pal_sink_update_stats_proplist(pa_sink *s);
+int pa_pal_sink_set_dump(pa_sink *s, const char *path);
 
 static inline bool pa_pal_sink_is_supported_encoding(pa_encoding_t encoding) {
     bool supported = true;
@@ -154,6 +254,8 @@ static inline pal_stream_type_t pa_pal_sink_get_type_from_string(const char *str
 
     if (pa_streq(stream_type, "PAL_STREAM_LOW_LATENCY")) {
         type = PAL_STREAM_LOW_LATENCY;
+    } else if (pa_streq(stream_type, "PAL_STREAM_ULTRA_LOW_LATENCY")) {
+        type = PAL_STREAM_ULTRA_LOW_LATENCY;
     } else if (pa_streq(stream_type,"PAL_STREAM_DEEP_BUFFER")) {
         type = PAL_STREAM_DEEP_BUFFER;
     } else if (pa_streq(stream_type,"PAL_STREAM_VOIP_TX")) {
@@ -10,11 +10,24 @@
 #include <pulse/sample.h>
 #include <pulsecore/card.h>
 #include <pulsecore/core.h>
+#include <pulsecore/memblock.h>
 
 #include <PalApi.h>
 #include <PalDefs.h>
 
 #include "pal-card.h"
+#include "pal-clock.h"
+#include "pal-dump.h"
+#include "pal-lock.h"
+#include "pal-stats.h"
+#include "pal-stream-cache.h"
+#include "pal-worker.h"
+#include "pal-pcm-convert.h"
+#include "pal-sched.h"
+#include "pal-volume.h"
+
+/* capture blocks recycled by the source I/O thread */
+#define PAL_SOURCE_POOL_DEPTH 8
 
 typedef size_t pa_pal_source_handle_t;
 
@@ -41,6 +54,9 @@ typedef struct {
     pa_pal_card_usecase_type_t usecase_type;
     uint32_t buffer_size;
     uint32_t buffer_count;
+    uint32_t stream_cache_size;
+    pa_sample_format_t convert_format; /* format an s24le source posts, unpacked by the module */
+    pa_pal_sched_config sched; /* I/O thread */
 } pa_pal_source_config;
 
 typedef struct {
@@ -50,11 +66,9 @@ typedef struct {
     struct pal_stream_attributes *stream_attributes;
     const char *device_url;
 
-    int write_fd;
+    pa_pal_dump_slot dump; /* optional PCM tap */
 
-    pa_mutex *mutex;
-    pa_cond *cond_ctrl_thread;
-    pa_pal_ctrl_event_t source_event_id;
+    pa_pal_lock *lock; /* serialises PAL calls between the I/O thread and control callbacks */
 
     size_t buffer_size;
     size_t buffer_count;
@@ -62,6 +76,41 @@ typedef struct {
     bool dynamic_usecase;
 
     bool standby;
+
+    /* bytes handed to the source since the stream was started */
+    uint64_t bytes_read;
+    /* smooths the DSP position used for latency reports */
+    pa_pal_clock_dll latency_dll;
+
+    /* capture block pool, only touched by the source I/O thread */
+    pa_memblock *pool[PAL_SOURCE_POOL_DEPTH];
+    unsigned pool_index;
+
+    pa_pal_stream_cache *stream_cache; /* stopped sessions of earlier media configs, NULL if disabled */
+
+    /* device switches run on the control worker, see pa_pal_source_switch_device */
+    pa_pal_worker *ctrl_worker;
+    pa_pal_volume *volume; /* sent by ctrl_worker, latest update wins */
+    pa_pal_sched_config sched;
+    pa_atomic_t switch_state; /* pa_pal_switch_state_t */
+
+    /* ultra low latency: the source I/O thread copies captured frames
+     * straight out of the DSP buffer, see pa_pal_source_mmap_capture */
+    bool mmap;
+    struct pal_mmap_buffer mmap_buffer;
+    uint64_t mmap_read; /* frames, source I/O thread only */
+    uint64_t mmap_written; /* frames the DSP captured */
+    int32_t mmap_position; /* raw PAL position of the last query */
+
+    /* PAL captures packed 24 bit, unpacked by the source I/O thread into the
+     * format PulseAudio was given. buffer_size and bytes_read stay in
+     * posted bytes. NULL when PAL captures what is posted. */
+    pa_pal_pcm_convert_func_t convert;
+    void *convert_buf;
+    size_t convert_buf_size;
+
+    pa_pal_stats stats;
+    bool overrun; /* latency beyond the DSP queue, counted once per episode */
 } pal_source_data;
 
 typedef struct {
@@ -88,6 +137,9 @@ bool pa_pal_source_is_supported_sample_rate(uint32_t sample_rate);
 pa_idxset* pa_pal_source_get_config(pa_pal_source_handle_t *handle);
 int pa_pal_source_get_media_config(pa_pal_source_handle_t *handle, pa_sample_spec *ss, pa_channel_map *map, pa_encoding_t *encoding);
 int pa_pal_source_set_device_connection_params(pa_pal_source_handle_t *handle, const char *prm_value);
+char *pa_pal_source_get_stats(pa_source *s);
+void pa_pal_source_update_stats_proplist(pa_source *s);
+int pa_pal_source_set_dump(pa_source *s, const char *path);
 
 static inline bool pa_pal_source_is_supported_type(char *source_type) {
     pa_assert(source_type);
@@ -123,6 +175,8 @@ static inline pal_stream_type_t pa_pal_source_get_type_from_string(const char *s
 
     if (pa_streq(stream_type, "PAL_STREAM_LOW_LATENCY")) {
         type = PAL_STREAM_LOW_LATENCY;
+    } else if (pa_streq(stream_type, "PAL_STREAM_ULTRA_LOW_LATENCY")) {
+        type = PAL_STREAM_ULTRA_LOW_LATENCY;
     } else if (pa_streq(stream_type,"PAL_STREAM_DEEP_BUFFER")) {
         type = PAL_STREAM_DEEP_BUFFER;
     } else if (pa_streq(stream_type, "PAL_STREAM_COMPRESSED")) {
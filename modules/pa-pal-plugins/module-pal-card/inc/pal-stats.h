@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalstatsfoo
+#define foopalstatsfoo
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pulse/proplist.h>
+
+/*
+ * Always-on hot path telemetry for pal sinks and sources. Every counter and
+ * histogram bucket is a 64 bit value updated with relaxed atomics, so the
+ * I/O and PAL threads never take a lock to record and readers in the main
+ * thread see a slightly stale but tear free snapshot.
+ *
+ * Histograms are log2 bucketed in us: bucket 0 holds 0 us, bucket n holds
+ * [2^(n-1), 2^n) us and the last bucket everything above.
+ */
+#define PA_PAL_STATS_HIST_BUCKETS 24
+
+#define PA_PAL_STATS_PROP_PREFIX "pal.stats."
+
+typedef enum {
+    PA_PAL_STATS_WRITES,
+    PA_PAL_STATS_WRITE_ERRORS,
+    PA_PAL_STATS_PARTIAL_WRITES,
+    PA_PAL_STATS_UNDERRUNS,
+    PA_PAL_STATS_READS,
+    PA_PAL_STATS_READ_ERRORS,
+    PA_PAL_STATS_OVERRUNS,
+    PA_PAL_STATS_POOL_ALLOCS,
+    PA_PAL_STATS_OPENS,
+    PA_PAL_STATS_CLOSES,
+    PA_PAL_STATS_WARM_STARTS,
+    PA_PAL_STATS_CACHE_HITS,
+    PA_PAL_STATS_CACHE_MISSES,
+    PA_PAL_STATS_LATE_WRITES,
+    PA_PAL_STATS_BUFFER_RESIZES,
+    PA_PAL_STATS_LOCK_CONTENDED,
+    PA_PAL_STATS_COUNTER_MAX,
+} pa_pal_stats_counter_t;
+
+typedef enum {
+    PA_PAL_STATS_WRITE_US,       /* time spent in pal_stream_write */
+    PA_PAL_STATS_READ_US,        /* time spent in pal_stream_read */
+    PA_PAL_STATS_WAIT_US,        /* PAL thread blocked waiting for data or WRITE_READY */
+    PA_PAL_STATS_RENDER_LAG_US,  /* render in the sink I/O thread to pal_stream_write */
+    PA_PAL_STATS_START_US,       /* sink start to the first completed pal_stream_write */
+    PA_PAL_STATS_RECONFIG_US,    /* restart with a new media config, old session released to new one open */
+    PA_PAL_STATS_SWITCH_US,      /* pal_stream_set_device on the control worker */
+    PA_PAL_STATS_LOCK_WAIT_US,   /* waiting for the sink or source lock, contended acquisitions only */
+    PA_PAL_STATS_LOCK_HOLD_US,   /* sink or source lock held, by any thread */
+    PA_PAL_STATS_HIST_MAX,
+} pa_pal_stats_hist_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[PA_PAL_STATS_HIST_BUCKETS];
+} pa_pal_stats_hist;
+
+typedef struct {
+    uint64_t counters[PA_PAL_STATS_COUNTER_MAX];
+    pa_pal_stats_hist hist[PA_PAL_STATS_HIST_MAX];
+} pa_pal_stats;
+
+void pa_pal_stats_inc(pa_pal_stats *stats, pa_pal_stats_counter_t counter);
+uint64_t pa_pal_stats_get(pa_pal_stats *stats, pa_pal_stats_counter_t counter);
+void pa_pal_stats_record(pa_pal_stats *stats, pa_pal_stats_hist_t hist, uint64_t value_us);
+
+/* "name=value;..." summary of every non-empty counter and histogram, pa_xfree() the result */
+char *pa_pal_stats_to_string(pa_pal_stats *stats);
+
+/* sets PA_PAL_STATS_PROP_PREFIX keys on p, returns true if any value changed */
+bool pa_pal_stats_to_proplist(pa_pal_stats *stats, pa_proplist *p);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalstreamcachefoo
+#define foopalstreamcachefoo
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <PalApi.h>
+#include <PalDefs.h>
+
+/*
+ * Stopped PAL streams kept open per sink or source, keyed by everything the
+ * session was opened with. Reconfiguring back to a cached media config then
+ * only swaps the handle instead of paying pal_stream_close, pal_stream_open
+ * and pal_stream_set_buffer_size. The least recently parked stream is closed
+ * when the cache is full. Safe to use from the main and I/O threads.
+ */
+typedef struct {
+    pal_stream_type_t type;
+    pal_audio_fmt_t aud_fmt_id;
+    uint32_t sample_rate;
+    uint32_t bit_width;
+    struct pal_channel_info ch_info;
+    pal_device_id_t device;
+    /* the device config, a port or device config change needs a new session */
+    uint32_t device_sample_rate;
+    uint32_t device_bit_width;
+    struct pal_channel_info device_ch_info;
+    char device_custom_key[PAL_MAX_CUSTOM_KEY_SIZE];
+    size_t buffer_size;
+    size_t buffer_count;
+} pa_pal_stream_key;
+
+typedef struct pa_pal_stream_cache pa_pal_stream_cache;
+
+/* size 0 disables caching, NULL is returned */
+pa_pal_stream_cache *pa_pal_stream_cache_new(unsigned size);
+/* closes every cached stream */
+void pa_pal_stream_cache_free(pa_pal_stream_cache *c);
+
+void pa_pal_stream_key_init(pa_pal_stream_key *key, struct pal_stream_attributes *attr, bool playback,
+                            struct pal_device *device, size_t buffer_size, size_t buffer_count);
+
+/* removes and returns a stopped stream opened with key, NULL on a miss */
+pal_stream_handle_t *pa_pal_stream_cache_take(pa_pal_stream_cache *c, const pa_pal_stream_key *key);
+/* parks a stopped stream, returns false if the caller still has to close it */
+bool pa_pal_stream_cache_put(pa_pal_stream_cache *c, const pa_pal_stream_key *key, pal_stream_handle_t *handle);
+void pa_pal_stream_cache_clear(pa_pal_stream_cache *c);
+
+#endif
@@ -29,6 +29,11 @@ const char* pa_pal_util_get_port_name_from_jack_type(pa_pal_jack_type_t jack_typ
 pa_channel_map pa_pal_map_remove_invalid_channels(pa_channel_map *def_map_with_inval_ch);
 void pa_pal_util_get_jack_sys_path(pa_pal_card_port_config *config_port, pa_pal_jack_in_config *jack_in_config);
 int pa_pal_set_volume(pal_stream_handle_t *handle, uint32_t num_channels, float value);
+int pa_pal_util_get_session_time(pal_stream_handle_t *handle, uint64_t *session_time, uint64_t *cur_session_time);
+int pa_pal_util_get_mmap_frames(pal_stream_handle_t *handle, int32_t *last, uint64_t *frames, bool reset);
+/* linear fade over the whole buffer, src and dst may alias. Returns false
+ * and leaves dst untouched for sample formats it cannot scale. */
+bool pa_pal_util_ramp(void *dst, const void *src, size_t length, const pa_sample_spec *ss, bool up);
 int pa_pal_set_device_connection_state(pal_device_id_t pal_dev_id, bool connection_state);
 pa_pal_card_avoid_processing_config_id_t pa_pal_utils_get_config_id_from_string(const char *config_str);
 #endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalvolumefoo
+#define foopalvolumefoo
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <PalApi.h>
+#include <PalDefs.h>
+
+/*
+ * Volume of one PAL stream. Any thread stores the latest gain, the control
+ * worker sends it with pal_stream_set_volume from a payload allocated once
+ * per stream, so a burst of updates costs one PAL call. The DSP ramps every
+ * change over ramp_ms instead of stepping.
+ */
+typedef struct pa_pal_volume pa_pal_volume;
+
+#define PA_PAL_VOLUME_DEFAULT_RAMP_MS 20
+
+/* ramp_ms 0 leaves the DSP's own ramp in place */
+pa_pal_volume *pa_pal_volume_new(uint32_t ramp_ms);
+void pa_pal_volume_free(pa_pal_volume *v);
+
+/* any thread, replaces an update that was not sent yet */
+void pa_pal_volume_set(pa_pal_volume *v, float gain, uint32_t channels, uint32_t channel_mask);
+/* sends the latest update to handle, returns 0 if none was pending */
+int pa_pal_volume_apply(pa_pal_volume *v, pal_stream_handle_t *handle);
+/* the ramp is requested again with the next update, for a new stream handle */
+void pa_pal_volume_reset(pa_pal_volume *v);
+
+#endif
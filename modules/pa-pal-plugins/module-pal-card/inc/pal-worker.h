@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalworkerfoo
+#define foopalworkerfoo
+
+#include <stdbool.h>
+
+/*
+ * Control worker for PAL calls that may take as long as a DSP graph
+ * reconfiguration, so neither the main thread nor an I/O thread has to
+ * wait for them. Jobs run one at a time in posting order. Posting with a
+ * key replaces a job with the same key that has not started yet, so only
+ * the latest request of a burst is executed.
+ *
+ * A pool runs jobs on several threads, oldest first, but never two jobs
+ * with the same key at once: a job whose key is running waits and the next
+ * one in the queue goes ahead. A job that posts itself again with its own
+ * key goes to the back of the queue, which shares the threads round-robin
+ * between keys.
+ */
+typedef struct pa_pal_worker pa_pal_worker;
+
+typedef void (*pa_pal_worker_cb_t)(void *userdata);
+
+pa_pal_worker *pa_pal_worker_new(const char *name);
+/* init_cb, if set, runs first on every thread, e.g. to apply its scheduling */
+pa_pal_worker *pa_pal_worker_new_pool(const char *name, unsigned n_threads, pa_pal_worker_cb_t init_cb,
+                                      void *init_userdata);
+/* waits for the running job, queued jobs are dropped */
+void pa_pal_worker_free(pa_pal_worker *w);
+
+/* key NULL never coalesces, returns false if the job could not be queued */
+bool pa_pal_worker_post(pa_pal_worker *w, const void *key, pa_pal_worker_cb_t cb, void *userdata);
+/* returns once the queue is empty and no job is running */
+void pa_pal_worker_sync(pa_pal_worker *w);
+/*
+ * Drops the queued jobs with key and waits for the running one, including
+ * what it posts again before returning. Must not be called from a job with
+ * key, keeping anyone else from posting it is the caller's job.
+ */
+void pa_pal_worker_cancel(pa_pal_worker *w, const void *key);
+
+#endif
@@ -7,8 +7,12 @@
 #include <config.h>
 #endif
 
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/core-rtclock.h>
 #include <pulsecore/dbus-util.h>
+#include <pulsecore/namereg.h>
 #include <pulsecore/modargs.h>
 #include <pulsecore/protocol-dbus.h>
 #include <pulsecore/thread.h>
@@ -27,6 +31,7 @@
 #include "pal-source.h"
 #include "pal-sink.h"
 #include "pal-config-parser.h"
+#include "pal-dump.h"
 
 //to be updated in PalDefs.h
 #define PAL_PARAM_SET_CUSTOM_VOLUME_INDEX 52
@@ -45,6 +50,9 @@
 
 #define OK 0
 
+/* how often sink/source proplists are refreshed with the pal.stats.* keys */
+#define PAL_STATS_PROPLIST_INTERVAL_USEC (10 * PA_USEC_PER_SEC)
+
 
 #ifndef PAL_USES_CUTILS
 struct str_parms *str_parms_create_str(const char *_string){return NULL;}
@@ -60,7 +68,10 @@ void str_parms_destroy(struct str_parms *str_parms){return;}
 struct pal_module_extn_data {
 	char *obj_path;
 	pa_dbus_protocol *dbus_protocol;
+	pa_core *core;
 	pa_card *card;
+	pa_time_event *stats_event;
+	char *dump_dir; /* NULL disables SetDump */
 };
 
 static struct pal_module_extn_data *pal_extn_mdata = NULL;
@@ -68,11 +79,15 @@ static struct pal_module_extn_data *pal_extn_mdata = NULL;
 /* key,value based set params*/
 static void pal_module_set_parameters(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void pal_module_get_parameters(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void pal_module_get_stats(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void pal_module_set_dump(DBusConnection *conn, DBusMessage *msg, void *userdata);
 
 enum module_method_handler_index {
 	METHOD_HANDLER_SET_PARAMETERS,
 	METHOD_HANDLER_GET_PARAMETERS,
-	METHOD_HANDLER_MODULE_LAST = METHOD_HANDLER_GET_PARAMETERS,
+	METHOD_HANDLER_GET_STATS,
+	METHOD_HANDLER_SET_DUMP,
+	METHOD_HANDLER_MODULE_LAST = METHOD_HANDLER_SET_DUMP,
 	METHOD_HANDLER_MODULE_MAX = METHOD_HANDLER_MODULE_LAST + 1,
 };
 
@@ -85,6 +100,16 @@ static pa_dbus_arg_info get_parameters_args[] = {
 	{"value", "s", "out"}
 };
 
+static pa_dbus_arg_info get_stats_args[] = {
+	{"name", "s", "in"},
+	{"stats", "s", "out"}
+};
+
+static pa_dbus_arg_info set_dump_args[] = {
+	{"name", "s", "in"},
+	{"file_name", "s", "in"}
+};
+
 static pa_dbus_method_handler module_method_handlers[METHOD_HANDLER_MODULE_MAX] = {
 	[METHOD_HANDLER_SET_PARAMETERS] = {
 		.method_name = "SetParameters",
@@ -96,6 +121,16 @@ static pa_dbus_method_handler module_method_handlers[METHOD_HANDLER_MODULE_MAX]
 		.arguments = get_parameters_args,
 		.n_arguments = sizeof(get_parameters_args)/sizeof(pa_dbus_arg_info),
 		.receive_cb = pal_module_get_parameters},
+	[METHOD_HANDLER_GET_STATS] = {
+		.method_name = "GetStats",
+		.arguments = get_stats_args,
+		.n_arguments = sizeof(get_stats_args)/sizeof(pa_dbus_arg_info),
+		.receive_cb = pal_module_get_stats},
+	[METHOD_HANDLER_SET_DUMP] = {
+		.method_name = "SetDump",
+		.arguments = set_dump_args,
+		.n_arguments = sizeof(set_dump_args)/sizeof(pa_dbus_arg_info),
+		.receive_cb = pal_module_set_dump},
 };
 
 static pa_dbus_interface_info module_interface_info = {
@@ -290,7 +325,119 @@ static void pal_module_get_parameters(DBusConnection *conn, DBusMessage *msg, vo
 	}
 }
 
-int pa_pal_module_extn_init(pa_core *core, pa_card *card)
+/* hot path telemetry of a sink or source of this card, see pal-stats.h for the format */
+static void pal_module_get_stats(DBusConnection *conn, DBusMessage *msg, void *userdata)
+{
+	struct pal_module_extn_data *mdata = userdata;
+	DBusError error;
+	const char *name = NULL;
+	char *stats = NULL;
+	pa_sink *sink;
+	pa_source *source;
+
+	pa_assert(conn);
+	pa_assert(msg);
+	pa_assert(mdata);
+	dbus_error_init(&error);
+
+	if (!dbus_message_get_args(msg, &error, DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID)) {
+		pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "%s", error.message);
+		dbus_error_free(&error);
+		return;
+	}
+
+	if ((sink = pa_namereg_get(mdata->core, name, PA_NAMEREG_SINK)) && sink->card == mdata->card)
+		stats = pa_pal_sink_get_stats(sink);
+	else if ((source = pa_namereg_get(mdata->core, name, PA_NAMEREG_SOURCE)) && source->card == mdata->card)
+		stats = pa_pal_source_get_stats(source);
+
+	if (!stats) {
+		pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "no pal sink or source %s", name);
+		return;
+	}
+
+	pa_dbus_send_basic_value_reply(conn, msg, DBUS_TYPE_STRING, &stats);
+	pa_xfree(stats);
+}
+
+/*
+ * starts a PCM tap of a sink or source of this card into file_name in the
+ * dump_dir module argument, an empty file_name stops it
+ */
+static void pal_module_set_dump(DBusConnection *conn, DBusMessage *msg, void *userdata)
+{
+	struct pal_module_extn_data *mdata = userdata;
+	DBusError error;
+	const char *name = NULL, *file_name = NULL;
+	char *path = NULL;
+	pa_sink *sink;
+	pa_source *source;
+	int status;
+
+	pa_assert(conn);
+	pa_assert(msg);
+	pa_assert(mdata);
+	dbus_error_init(&error);
+
+	if (!dbus_message_get_args(msg, &error, DBUS_TYPE_STRING, &name, DBUS_TYPE_STRING, &file_name, DBUS_TYPE_INVALID)) {
+		pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "%s", error.message);
+		dbus_error_free(&error);
+		return;
+	}
+
+	if (*file_name) {
+		if (!mdata->dump_dir) {
+			pa_dbus_send_error(conn, msg, DBUS_ERROR_ACCESS_DENIED, "dumps are disabled, no dump_dir module argument");
+			return;
+		}
+
+		if (!pa_pal_dump_name_valid(file_name)) {
+			pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "%s is not a bare file name", file_name);
+			return;
+		}
+
+		path = pa_sprintf_malloc("%s/%s", mdata->dump_dir, file_name);
+	}
+
+	if ((sink = pa_namereg_get(mdata->core, name, PA_NAMEREG_SINK)) && sink->card == mdata->card) {
+		status = pa_pal_sink_set_dump(sink, path);
+	} else if ((source = pa_namereg_get(mdata->core, name, PA_NAMEREG_SOURCE)) && source->card == mdata->card) {
+		status = pa_pal_source_set_dump(source, path);
+	} else {
+		pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "no pal sink or source %s", name);
+		goto exit;
+	}
+
+	if (OK != status) {
+		pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "could not start dump to %s", file_name);
+		goto exit;
+	}
+
+	pa_dbus_send_empty_reply(conn, msg);
+
+exit:
+	pa_xfree(path);
+}
+
+static void pal_module_stats_event_cb(pa_mainloop_api *a, pa_time_event *e, const struct timeval *t, void *userdata)
+{
+	struct pal_module_extn_data *mdata = userdata;
+	pa_sink *sink;
+	pa_source *source;
+	uint32_t idx;
+
+	pa_assert(mdata);
+
+	PA_IDXSET_FOREACH(sink, mdata->card->sinks, idx)
+		pa_pal_sink_update_stats_proplist(sink);
+
+	PA_IDXSET_FOREACH(source, mdata->card->sources, idx)
+		pa_pal_source_update_stats_proplist(source);
+
+	pa_core_rttime_restart(mdata->core, e, pa_rtclock_now() + PAL_STATS_PROPLIST_INTERVAL_USEC);
+}
+
+int pa_pal_module_extn_init(pa_core *core, pa_card *card, const char *dump_dir)
 {
 	pa_assert(core);
 	pa_assert(card);
@@ -304,10 +451,19 @@ int pa_pal_module_extn_init(pa_core *core, pa_card *card)
 	pal_extn_mdata = pa_xnew0(struct pal_module_extn_data, 1);
 	pal_extn_mdata->obj_path = pa_sprintf_malloc("%s", PAL_DBUS_OBJECT_PATH_PREFIX);
 	pal_extn_mdata->dbus_protocol = pa_dbus_protocol_get(core);
+	pal_extn_mdata->core = core;
 	pal_extn_mdata->card = card;
 
+	if (dump_dir && dump_dir[0] != '/')
+		pa_log_error("%s: dump_dir %s is not absolute, dumps are disabled", __func__, dump_dir);
+	else if (dump_dir)
+		pal_extn_mdata->dump_dir = pa_xstrdup(dump_dir);
+
 	pa_assert_se(pa_dbus_protocol_add_interface(pal_extn_mdata->dbus_protocol,
 					pal_extn_mdata->obj_path, &module_interface_info, pal_extn_mdata) >= 0);
+
+	pal_extn_mdata->stats_event = pa_core_rttime_new(core, pa_rtclock_now() + PAL_STATS_PROPLIST_INTERVAL_USEC,
+					pal_module_stats_event_cb, pal_extn_mdata);
 	return 0;
 }
 
@@ -316,10 +472,13 @@ void pa_pal_module_extn_deinit(void)
 	pa_assert(pal_extn_mdata);
 	pa_assert(pal_extn_mdata->dbus_protocol);
 	pa_assert(pal_extn_mdata->obj_path);
+	if (pal_extn_mdata->stats_event)
+		pal_extn_mdata->core->mainloop->time_free(pal_extn_mdata->stats_event);
 	pa_assert_se(pa_dbus_protocol_remove_interface(pal_extn_mdata->dbus_protocol,
 				pal_extn_mdata->obj_path, module_interface_info.name) >= 0);
 	pa_dbus_protocol_unref(pal_extn_mdata->dbus_protocol);
 	pa_xfree(pal_extn_mdata->obj_path);
+	pa_xfree(pal_extn_mdata->dump_dir);
 	pa_xfree(pal_extn_mdata);
 	pal_extn_mdata = NULL;
 }
@@ -20,7 +20,11 @@
 
 #include <PalApi.h>
 #include <PalDefs.h>
+#ifdef PAL_STUB_ENABLED
+#include "pal-stub.h"
+#else
 #include <agm/agm_api.h>
+#endif
 
 #include "pal-source.h"
 #include "pal-sink.h"
@@ -67,6 +71,7 @@ static const char* const valid_modargs[] = {
     "module",
     "conf_dir_name",
     "conf_file_name",
+    "dump_dir",
     NULL
 };
 
@@ -105,7 +110,7 @@ static int pa_pal_card_add_source(pa_module *module, pa_card *card, const char *
 static int pa_pal_card_add_sink(pa_module *module, pa_card *card, const char *driver, char *module_name, pa_pal_sink_config *sink,
                                 pa_pal_sink_handle_t **sink_handle);
 void pa__done(pa_module *m);
-int pa_pal_module_extn_init(pa_core *core, pa_card *card);
+int pa_pal_module_extn_init(pa_core *core, pa_card *card, const char *dump_dir);
 void pa_pal_module_extn_deinit(void);
 
 static void pa_pal_card_profiles_free(struct userdata *u, pa_hashmap *profiles) {
@@ -1146,7 +1151,7 @@ int pa__init(pa_module *m) {
 
     pa_log_debug("module %s loaded", u->module_name);
 
-    ret = pa_pal_module_extn_init(u->core, u->card);
+    ret = pa_pal_module_extn_init(u->core, u->card, pa_modargs_get_value(ma, "dump_dir", NULL));
     if(ret)
         pa_log_error("pal extn init failed\n");
     pa_log_debug("Pal extn module loaded successfully\n", __func__);
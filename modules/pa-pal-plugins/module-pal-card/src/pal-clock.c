@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "pal-clock.h"
+
+#define PA_PAL_CLOCK_USEC_PER_SEC 1000000ULL
+#define PA_PAL_CLOCK_NSEC_PER_USEC 1000ULL
+
+/* used when CNTFRQ was not programmed by the firmware */
+#define PA_PAL_CLOCK_DEFAULT_FREQUENCY 19200000ULL
+
+#define PA_PAL_CLOCK_DLL_MIN_RATE 0.95
+#define PA_PAL_CLOCK_DLL_MAX_RATE 1.05
+
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+static uint64_t clock_frequency;
+
+static void pa_pal_clock_init(void) {
+    uint64_t freq = 0;
+
+#if defined __aarch64__
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+#elif defined __arm__
+    uint32_t freq32;
+
+    asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(freq32));
+    freq = freq32;
+#else
+    freq = PA_PAL_CLOCK_USEC_PER_SEC * PA_PAL_CLOCK_NSEC_PER_USEC;
+#endif
+
+    clock_frequency = freq ? freq : PA_PAL_CLOCK_DEFAULT_FREQUENCY;
+}
+
+uint64_t pa_pal_clock_get_frequency(void) {
+    pthread_once(&clock_once, pa_pal_clock_init);
+
+    return clock_frequency;
+}
+
+#if defined __aarch64__ || defined __arm__
+/* ticks * 1e6 / freq without overflowing after a few days of uptime */
+static uint64_t pa_pal_clock_ticks_to_us(uint64_t ticks, uint64_t freq) {
+    return (ticks / freq) * PA_PAL_CLOCK_USEC_PER_SEC + ((ticks % freq) * PA_PAL_CLOCK_USEC_PER_SEC) / freq;
+}
+#endif
+
+uint64_t pa_pal_clock_now_us(void) {
+#if defined __aarch64__
+    uint64_t ticks;
+
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return pa_pal_clock_ticks_to_us(ticks, pa_pal_clock_get_frequency());
+#elif defined __arm__
+    uint64_t ticks;
+
+    asm volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(ticks));
+    return pa_pal_clock_ticks_to_us(ticks, pa_pal_clock_get_frequency());
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * PA_PAL_CLOCK_USEC_PER_SEC + (uint64_t)ts.tv_nsec / PA_PAL_CLOCK_NSEC_PER_USEC;
+#endif
+}
+
+void pa_pal_clock_dll_reset(pa_pal_clock_dll *dll) {
+    memset(dll, 0, sizeof(*dll));
+}
+
+static uint64_t pa_pal_clock_dll_restart(pa_pal_clock_dll *dll, uint64_t clock_us, uint64_t pos_us) {
+    dll->valid = true;
+    dll->base_clock_us = clock_us;
+    dll->base_pos_us = (double)pos_us;
+    dll->rate = 1.0;
+    dll->last_pos_us = pos_us;
+
+    return pos_us;
+}
+
+uint64_t pa_pal_clock_dll_update(pa_pal_clock_dll *dll, uint64_t clock_us, uint64_t pos_us) {
+    double dt, predicted, err, w;
+    uint64_t pos;
+
+    if (!dll->valid || clock_us < dll->base_clock_us)
+        return pa_pal_clock_dll_restart(dll, clock_us, pos_us);
+
+    if (clock_us == dll->base_clock_us)
+        return dll->last_pos_us;
+
+    dt = (double)(clock_us - dll->base_clock_us);
+    predicted = dll->base_pos_us + dll->rate * dt;
+    err = (double)pos_us - predicted;
+
+    /* flush, seek or a restarted stream, not drift */
+    if (fabs(err) > PA_PAL_CLOCK_DLL_MAX_ERROR_US)
+        return pa_pal_clock_dll_restart(dll, clock_us, pos_us);
+
+    /* loop gains for a critically damped filter at the configured bandwidth */
+    w = 2.0 * M_PI * PA_PAL_CLOCK_DLL_BANDWIDTH_HZ * dt / PA_PAL_CLOCK_USEC_PER_SEC;
+    if (w > 0.5)
+        w = 0.5;
+
+    dll->base_pos_us = predicted + M_SQRT2 * w * err;
+    dll->rate += w * w * err / dt;
+    if (dll->rate < PA_PAL_CLOCK_DLL_MIN_RATE)
+        dll->rate = PA_PAL_CLOCK_DLL_MIN_RATE;
+    else if (dll->rate > PA_PAL_CLOCK_DLL_MAX_RATE)
+        dll->rate = PA_PAL_CLOCK_DLL_MAX_RATE;
+    dll->base_clock_us = clock_us;
+
+    pos = dll->base_pos_us > 0 ? (uint64_t)dll->base_pos_us : 0;
+    if (pos > pos_us + PA_PAL_CLOCK_DLL_MAX_LEAD_US)
+        pos = pos_us + PA_PAL_CLOCK_DLL_MAX_LEAD_US;
+    if (pos < dll->last_pos_us)
+        pos = dll->last_pos_us;
+    dll->last_pos_us = pos;
+
+    return pos;
+}
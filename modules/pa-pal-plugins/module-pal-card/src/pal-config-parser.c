@@ -113,6 +113,8 @@ static pa_pal_sink_config* pa_pal_config_get_sink(pa_hashmap *sinks, char *name)
 
     sink->formats = pa_idxset_new(NULL, NULL);
 
+    sink->volume_ramp_ms = PA_PAL_VOLUME_DEFAULT_RAMP_MS;
+
     sink->name = pa_xstrdup(name);
 
     pa_log_debug("%s::sink name is %s", __func__, sink->name);
@@ -468,6 +470,121 @@ exit:
     return ret;
 }
 
+static int pa_pal_config_parse_stream_cache_size(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    pa_pal_source_config *source = NULL;
+    uint32_t *size;
+
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if ((sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        size = &sink->stream_cache_size;
+    } else if ((source = pa_pal_config_get_source(config_data->sources, state->section))) {
+        size = &source->stream_cache_size;
+    } else {
+        pa_log_error("%s: [%s:%u] stream-cache-size is only supported for sinks and sources", __func__,
+                     state->filename, state->lineno);
+        goto exit;
+    }
+
+    if (pa_atou(state->rvalue, size) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding stream cache size %u to %s", __func__, *size, state->section);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_convert_sample_format(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    pa_pal_source_config *source = NULL;
+    pa_sample_format_t *format;
+
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if ((sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        format = &sink->convert_format;
+    } else if ((source = pa_pal_config_get_source(config_data->sources, state->section))) {
+        format = &source->convert_format;
+    } else {
+        pa_log_error("%s: [%s:%u] convert-sample-format is only supported for sinks and sources", __func__,
+                     state->filename, state->lineno);
+        goto exit;
+    }
+
+    *format = pa_parse_sample_format(state->rvalue);
+    if (!pa_pal_pcm_convert_supported(*format)) {
+        pa_log_error("%s: [%s:%u] unsupported convert format %s", __func__, state->filename, state->lineno,
+                     state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding convert format %s to %s", __func__, state->rvalue, state->section);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_sched(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    pa_pal_source_config *source = NULL;
+    pa_pal_sched_config *sched;
+    int rc;
+
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if ((sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        sched = &sink->sched;
+    } else if ((source = pa_pal_config_get_source(config_data->sources, state->section))) {
+        sched = &source->sched;
+    } else {
+        pa_log_error("%s: [%s:%u] %s is only supported for sinks and sources", __func__,
+                     state->filename, state->lineno, state->lvalue);
+        goto exit;
+    }
+
+    if (pa_streq(state->lvalue, "sched-policy"))
+        rc = pa_pal_sched_parse_policy(state->rvalue, &sched->policy);
+    else if (pa_streq(state->lvalue, "rt-priority"))
+        rc = pa_pal_sched_parse_priority(state->rvalue, &sched->priority);
+    else
+        rc = pa_pal_sched_parse_cpu_mask(state->rvalue, &sched->cpu_mask);
+
+    if (rc < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding %s %s to %s", __func__, state->lvalue, state->rvalue, state->section);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
 static int pa_pal_config_parse_default_buffer_count(pa_config_parser_state *state) {
     pa_pal_config_data* config_data = state->userdata;
     pa_pal_sink_config *sink = NULL;
@@ -495,6 +612,176 @@ exit:
     return ret;
 }
 
+static int pa_pal_config_parse_timer_scheduling(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    int b;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] timer-scheduling is only supported for sinks", __func__, state->filename, state->lineno);
+        goto exit;
+    }
+
+    if ((b = pa_parse_boolean(state->rvalue)) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    sink->tsched = b;
+    pa_log_debug("%s timer scheduling %s for sink %s", __func__, sink->tsched ? "enabled" : "disabled", sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_gapless(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    int b;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] gapless is only supported for sinks", __func__, state->filename, state->lineno);
+        goto exit;
+    }
+
+    if ((b = pa_parse_boolean(state->rvalue)) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    sink->gapless = b;
+    pa_log_debug("%s gapless %s for sink %s", __func__, sink->gapless ? "enabled" : "disabled", sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_standby_hold(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] standby-hold-ms is only supported for sinks", __func__, state->filename, state->lineno);
+        goto exit;
+    }
+
+    if (pa_atou(state->rvalue, &sink->standby_hold_ms) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding standby hold %u ms to sink %s", __func__, sink->standby_hold_ms, sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_volume_ramp(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] volume-ramp-ms is only supported for sinks", __func__, state->filename, state->lineno);
+        goto exit;
+    }
+
+    if (pa_atou(state->rvalue, &sink->volume_ramp_ms) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding volume ramp %u ms to sink %s", __func__, sink->volume_ramp_ms, sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_adaptive_buffer(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    uint32_t *value;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->lvalue);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] %s is only supported for sinks", __func__, state->filename, state->lineno, state->lvalue);
+        goto exit;
+    }
+
+    value = pa_streq(state->lvalue, "adaptive-buffer-min-ms") ? &sink->adaptive_buffer_min_ms : &sink->adaptive_buffer_max_ms;
+
+    if (pa_atou(state->rvalue, value) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding %s %u to sink %s", __func__, state->lvalue, *value, sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
+static int pa_pal_config_parse_tsched_watermark(pa_config_parser_state *state) {
+    pa_pal_config_data* config_data = state->userdata;
+    pa_pal_sink_config *sink = NULL;
+    int ret = -1;
+
+    pa_assert(config_data);
+    pa_assert(state);
+    pa_assert(state->rvalue);
+
+    if (!(sink = pa_pal_config_get_sink(config_data->sinks, state->section))) {
+        pa_log_error("%s: [%s:%u] tsched-watermark-ms is only supported for sinks", __func__, state->filename, state->lineno);
+        goto exit;
+    }
+
+    if (pa_atou(state->rvalue, &sink->tsched_watermark_ms) < 0) {
+        pa_log_error("%s: [%s:%u] invalid value %s", __func__, state->filename, state->lineno, state->rvalue);
+        goto exit;
+    }
+
+    pa_log_debug("%s adding tsched watermark %u ms to sink %s", __func__, sink->tsched_watermark_ms, sink->name);
+
+    ret = 0;
+
+exit:
+    return ret;
+}
+
 static int pa_pal_config_parse_sample_rates(pa_config_parser_state *state) {
     pa_pal_config_data* config_data = state->userdata;
     pa_pal_sink_config *sink = NULL;
@@ -1589,6 +1876,18 @@ pa_pal_config_data* pa_pal_config_parse_new(char *dir, char *conf_file_name) {
         { "default-channel-map",         pa_pal_config_parse_default_channel_map,                 NULL, NULL },
         { "default-buffer-size",         pa_pal_config_parse_default_buffer_size,                 NULL, NULL },
         { "default-buffer-count",        pa_pal_config_parse_default_buffer_count,                NULL, NULL },
+        { "timer-scheduling",            pa_pal_config_parse_timer_scheduling,                    NULL, NULL },
+        { "tsched-watermark-ms",         pa_pal_config_parse_tsched_watermark,                    NULL, NULL },
+        { "gapless",                     pa_pal_config_parse_gapless,                             NULL, NULL },
+        { "standby-hold-ms",             pa_pal_config_parse_standby_hold,                        NULL, NULL },
+        { "stream-cache-size",           pa_pal_config_parse_stream_cache_size,                   NULL, NULL },
+        { "adaptive-buffer-min-ms",      pa_pal_config_parse_adaptive_buffer,                     NULL, NULL },
+        { "adaptive-buffer-max-ms",      pa_pal_config_parse_adaptive_buffer,                     NULL, NULL },
+        { "convert-sample-format",       pa_pal_config_parse_convert_sample_format,               NULL, NULL },
+        { "volume-ramp-ms",              pa_pal_config_parse_volume_ramp,                         NULL, NULL },
+        { "sched-policy",                pa_pal_config_parse_sched,                               NULL, NULL },
+        { "rt-priority",                 pa_pal_config_parse_sched,                               NULL, NULL },
+        { "cpu-affinity",                pa_pal_config_parse_sched,                               NULL, NULL },
         { "encodings",                   pa_pal_config_parse_encodings,                           NULL, NULL },
         { "sample-rates",                pa_pal_config_parse_sample_rates,                        NULL, NULL },
         { "sample-formats",              pa_pal_config_parse_sample_formats,                      NULL, NULL },
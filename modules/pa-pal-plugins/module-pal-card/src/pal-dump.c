@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/atomic.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/thread.h>
+
+#include "pal-dump.h"
+
+/* audio the ring absorbs while the drain thread is not scheduled */
+#define PA_PAL_DUMP_RING_USEC (500 * PA_USEC_PER_MSEC)
+#define PA_PAL_DUMP_DRAIN_INTERVAL_MS 20
+#define PA_PAL_DUMP_THREAD_NICE 10
+/* how often a swap polls for a write in progress */
+#define PA_PAL_DUMP_SLOT_POLL_MS 1
+
+#define PA_PAL_DUMP_WAV_HEADER_SIZE 44
+#define PA_PAL_DUMP_WAV_FORMAT_PCM 1
+#define PA_PAL_DUMP_WAV_FORMAT_FLOAT 3
+#define PA_PAL_DUMP_WAV_FORMAT_ALAW 6
+#define PA_PAL_DUMP_WAV_FORMAT_ULAW 7
+
+struct pa_pal_dump {
+    char *path;
+    int fd;
+    bool wav;
+
+    uint8_t *ring;
+    size_t ring_size;
+    size_t write_index; /* realtime side only */
+    size_t read_index;  /* drain thread only */
+    pa_atomic_t fill;
+    pa_atomic_t dropped;
+
+    uint64_t data_bytes;
+    pa_thread *thread;
+    pa_atomic_t quit;
+};
+
+static void dump_put_le16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void dump_put_le32(uint8_t *p, uint32_t v) {
+    dump_put_le16(p, v & 0xffff);
+    dump_put_le16(p + 2, v >> 16);
+}
+
+static void dump_wav_header(uint8_t *h, const pa_sample_spec *ss, uint32_t data_bytes) {
+    uint16_t format = PA_PAL_DUMP_WAV_FORMAT_PCM;
+    uint16_t block_align = (uint16_t)pa_frame_size(ss);
+
+    switch (ss->format) {
+        case PA_SAMPLE_FLOAT32LE:
+            format = PA_PAL_DUMP_WAV_FORMAT_FLOAT;
+            break;
+        case PA_SAMPLE_ALAW:
+            format = PA_PAL_DUMP_WAV_FORMAT_ALAW;
+            break;
+        case PA_SAMPLE_ULAW:
+            format = PA_PAL_DUMP_WAV_FORMAT_ULAW;
+            break;
+        default:
+            break;
+    }
+
+    memcpy(h, "RIFF", 4);
+    dump_put_le32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    dump_put_le32(h + 16, 16);
+    dump_put_le16(h + 20, format);
+    dump_put_le16(h + 22, ss->channels);
+    dump_put_le32(h + 24, ss->rate);
+    dump_put_le32(h + 28, ss->rate * block_align);
+    dump_put_le16(h + 32, block_align);
+    dump_put_le16(h + 34, (uint16_t)(pa_sample_size(ss) * 8));
+    memcpy(h + 36, "data", 4);
+    dump_put_le32(h + 40, data_bytes);
+}
+
+static void dump_drain(pa_pal_dump *d) {
+    size_t fill, n;
+
+    while ((fill = (size_t)pa_atomic_load(&d->fill)) > 0) {
+        n = PA_MIN(fill, d->ring_size - d->read_index);
+
+        if (pa_loop_write(d->fd, d->ring + d->read_index, n, NULL) != (ssize_t)n)
+            pa_log_error("%s: write to %s failed: %s", __func__, d->path, pa_cstrerror(errno));
+        else
+            d->data_bytes += n;
+
+        d->read_index = (d->read_index + n) % d->ring_size;
+        pa_atomic_sub(&d->fill, (int)n);
+    }
+}
+
+static void dump_thread_func(void *userdata) {
+    pa_pal_dump *d = userdata;
+
+    /* Linux applies this to the calling thread only */
+    if (setpriority(PRIO_PROCESS, 0, PA_PAL_DUMP_THREAD_NICE) < 0)
+        pa_log_debug("%s: could not lower priority: %s", __func__, pa_cstrerror(errno));
+
+    while (!pa_atomic_load(&d->quit)) {
+        dump_drain(d);
+        pa_msleep(PA_PAL_DUMP_DRAIN_INTERVAL_MS);
+    }
+
+    dump_drain(d);
+}
+
+bool pa_pal_dump_name_valid(const char *name) {
+    return name && *name && !strchr(name, '/') && !strstr(name, "..");
+}
+
+pa_pal_dump *pa_pal_dump_new(const char *path, const pa_sample_spec *ss, bool wav) {
+    uint8_t header[PA_PAL_DUMP_WAV_HEADER_SIZE];
+    pa_pal_dump *d;
+
+    pa_assert(path);
+    pa_assert(ss);
+
+    d = pa_xnew0(pa_pal_dump, 1);
+    d->path = pa_xstrdup(path);
+    d->wav = wav;
+
+    /* never truncate or follow a link to a file that is already there */
+    if ((d->fd = pa_open_cloexec(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, S_IRUSR | S_IWUSR)) < 0) {
+        pa_log_error("%s: could not open %s: %s", __func__, path, pa_cstrerror(errno));
+        goto fail;
+    }
+
+    if (wav) {
+        dump_wav_header(header, ss, 0);
+        if (pa_loop_write(d->fd, header, sizeof(header), NULL) != (ssize_t)sizeof(header)) {
+            pa_log_error("%s: could not write header to %s", __func__, path);
+            goto fail;
+        }
+    }
+
+    d->ring_size = PA_MAX(pa_usec_to_bytes(PA_PAL_DUMP_RING_USEC, ss), (size_t)PA_PAGE_SIZE);
+    d->ring = pa_xmalloc(d->ring_size);
+
+    if (!(d->thread = pa_thread_new("pal-dump", dump_thread_func, d))) {
+        pa_log_error("%s: could not create drain thread", __func__);
+        goto fail;
+    }
+
+    pa_log_info("dumping PCM to %s", path);
+
+    return d;
+
+fail:
+    if (d->fd >= 0)
+        pa_close(d->fd);
+    pa_xfree(d->ring);
+    pa_xfree(d->path);
+    pa_xfree(d);
+
+    return NULL;
+}
+
+/* realtime side, never blocks */
+void pa_pal_dump_write(pa_pal_dump *d, const void *data, size_t length) {
+    size_t n;
+
+    pa_assert(d);
+
+    if (!length)
+        return;
+
+    /* drop whole buffers so the file stays frame aligned */
+    if (length > d->ring_size - (size_t)pa_atomic_load(&d->fill)) {
+        pa_atomic_inc(&d->dropped);
+        return;
+    }
+
+    n = PA_MIN(length, d->ring_size - d->write_index);
+    memcpy(d->ring + d->write_index, data, n);
+    if (n < length)
+        memcpy(d->ring, (const uint8_t *)data + n, length - n);
+
+    d->write_index = (d->write_index + length) % d->ring_size;
+    pa_atomic_add(&d->fill, (int)length);
+}
+
+void pa_pal_dump_free(pa_pal_dump *d) {
+    uint8_t riff_size[4], data_size[4];
+    uint32_t data_bytes;
+
+    pa_assert(d);
+
+    pa_atomic_store(&d->quit, 1);
+    pa_thread_free(d->thread);
+
+    if (d->wav) {
+        /* only the two size fields change, rewrite them in place */
+        data_bytes = (uint32_t)PA_MIN(d->data_bytes, (uint64_t)UINT32_MAX - 36);
+        dump_put_le32(riff_size, 36 + data_bytes);
+        dump_put_le32(data_size, data_bytes);
+        if (pwrite(d->fd, riff_size, 4, 4) != 4 || pwrite(d->fd, data_size, 4, 40) != 4)
+            pa_log_error("%s: could not finalize header of %s", __func__, d->path);
+    }
+
+    pa_log_info("PCM dump %s closed, %" PRIu64 " bytes written, %d buffers dropped", d->path, d->data_bytes,
+                pa_atomic_load(&d->dropped));
+
+    pa_close(d->fd);
+    pa_xfree(d->ring);
+    pa_xfree(d->path);
+    pa_xfree(d);
+}
+
+void pa_pal_dump_slot_write(pa_pal_dump_slot *s, const void *data, size_t length) {
+    pa_pal_dump *d;
+
+    pa_assert(s);
+
+    /* counted before the load, a swap either sees this writer or the writer sees the new tap */
+    pa_atomic_inc(&s->users);
+    if ((d = pa_atomic_ptr_load(&s->dump)))
+        pa_pal_dump_write(d, data, length);
+    pa_atomic_dec(&s->users);
+}
+
+void pa_pal_dump_slot_set(pa_pal_dump_slot *s, pa_pal_dump *d) {
+    pa_pal_dump *old;
+
+    pa_assert(s);
+
+    do {
+        old = pa_atomic_ptr_load(&s->dump);
+    } while (!pa_atomic_ptr_cmpxchg(&s->dump, old, d));
+
+    if (!old)
+        return;
+
+    while (pa_atomic_load(&s->users))
+        pa_msleep(PA_PAL_DUMP_SLOT_POLL_MS);
+
+    pa_pal_dump_free(old);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulse/rtclock.h>
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-rtclock.h>
+#include <pulsecore/macro.h>
+
+#include "pal-lock.h"
+
+struct pa_pal_lock {
+    pa_mutex *mutex;
+    pa_pal_stats *stats;
+    pa_usec_t acquired; /* written by the owner only */
+};
+
+pa_pal_lock *pa_pal_lock_new(pa_pal_stats *stats) {
+    pa_pal_lock *l;
+
+    pa_assert(stats);
+
+    l = pa_xnew0(pa_pal_lock, 1);
+    l->mutex = pa_mutex_new(false /* recursive */, true /* inherit_priority */);
+    l->stats = stats;
+
+    return l;
+}
+
+void pa_pal_lock_free(pa_pal_lock *l) {
+    pa_assert(l);
+
+    pa_mutex_free(l->mutex);
+    pa_xfree(l);
+}
+
+void pa_pal_lock_acquire(pa_pal_lock *l) {
+    pa_usec_t start;
+
+    pa_assert(l);
+
+    /* the uncontended case costs one extra clock read for the hold time */
+    if (PA_LIKELY(pa_mutex_try_lock(l->mutex))) {
+        l->acquired = pa_rtclock_now();
+        return;
+    }
+
+    start = pa_rtclock_now();
+    pa_mutex_lock(l->mutex);
+    l->acquired = pa_rtclock_now();
+
+    pa_pal_stats_inc(l->stats, PA_PAL_STATS_LOCK_CONTENDED);
+    pa_pal_stats_record(l->stats, PA_PAL_STATS_LOCK_WAIT_US, l->acquired - start);
+}
+
+void pa_pal_lock_release(pa_pal_lock *l) {
+    pa_usec_t held;
+
+    pa_assert(l);
+
+    held = pa_rtclock_now() - l->acquired;
+    pa_mutex_unlock(l->mutex);
+
+    pa_pal_stats_record(l->stats, PA_PAL_STATS_LOCK_HOLD_US, held);
+}
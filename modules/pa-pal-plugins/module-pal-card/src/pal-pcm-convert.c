@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PAL_PCM_CONVERT_HAVE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define PAL_PCM_CONVERT_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pal-pcm-convert.h"
+
+#define S24_SCALE ((float)0x7fffff)
+#define S32_TO_FLOAT (1.0f / 2147483648.0f)
+
+/* SIMD kernels convert this many samples per step, the rest goes scalar */
+#define BLOCK_SAMPLES 16
+
+enum {
+    FORMAT_S32LE,
+    FORMAT_S24_32LE,
+    FORMAT_FLOAT32LE,
+    FORMAT_MAX,
+};
+
+static int format_index(pa_sample_format_t format) {
+    switch (format) {
+        case PA_SAMPLE_S32LE:
+            return FORMAT_S32LE;
+        case PA_SAMPLE_S24_32LE:
+            return FORMAT_S24_32LE;
+        case PA_SAMPLE_FLOAT32LE:
+            return FORMAT_FLOAT32LE;
+        default:
+            return -1;
+    }
+}
+
+static inline void write24(uint8_t *d, int32_t v) {
+    d[0] = (uint8_t)v;
+    d[1] = (uint8_t)(v >> 8);
+    d[2] = (uint8_t)(v >> 16);
+}
+
+/* the 24 bit sample in the top of an S32 */
+static inline int32_t read24(const uint8_t *s) {
+    return (int32_t)(((uint32_t)s[0] << 8) | ((uint32_t)s[1] << 16) | ((uint32_t)s[2] << 24));
+}
+
+static inline int32_t float_to_s24(float f) {
+    f = (f < -1.0f) ? -1.0f : f;
+    f = (f > 1.0f) ? 1.0f : f;
+    return (int32_t)lrintf(f * S24_SCALE);
+}
+
+static void scalar_pack_s32(void *dst, const void *src, size_t n) {
+    const int32_t *s = src;
+    uint8_t *d = dst;
+
+    for (; n; n--, s++, d += 3)
+        write24(d, *s >> 8);
+}
+
+static void scalar_pack_s24_32(void *dst, const void *src, size_t n) {
+    const int32_t *s = src;
+    uint8_t *d = dst;
+
+    for (; n; n--, s++, d += 3)
+        write24(d, *s);
+}
+
+static void scalar_pack_float(void *dst, const void *src, size_t n) {
+    const float *s = src;
+    uint8_t *d = dst;
+
+    for (; n; n--, s++, d += 3)
+        write24(d, float_to_s24(*s));
+}
+
+static void scalar_unpack_s32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    int32_t *d = dst;
+
+    for (; n; n--, s += 3, d++)
+        *d = read24(s);
+}
+
+static void scalar_unpack_s24_32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    int32_t *d = dst;
+
+    for (; n; n--, s += 3, d++)
+        *d = read24(s) >> 8;
+}
+
+static void scalar_unpack_float(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    float *d = dst;
+
+    for (; n; n--, s += 3, d++)
+        *d = (float)read24(s) * S32_TO_FLOAT;
+}
+
+#ifdef PAL_PCM_CONVERT_HAVE_SSSE3
+/* Built for SSSE3 whatever the compiler baseline, only called after the CPU
+ * check in pa_pal_pcm_convert_impl_available. Four samples are shuffled into
+ * the low 12 bytes of a register, four such registers make 48 output bytes. */
+#define SSSE3 __attribute__((target("ssse3")))
+
+static const int8_t ssse3_pack_high[16] = { 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1 };
+static const int8_t ssse3_pack_low[16] = { 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 };
+static const int8_t ssse3_unpack[16] = { -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 };
+
+SSSE3 static inline void ssse3_store48(uint8_t *d, __m128i p0, __m128i p1, __m128i p2, __m128i p3) {
+    _mm_storeu_si128((__m128i *)d, _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+    _mm_storeu_si128((__m128i *)(d + 16), _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+    _mm_storeu_si128((__m128i *)(d + 32), _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+}
+
+/* 16 packed samples as S32 */
+SSSE3 static inline void ssse3_load48(const uint8_t *s, __m128i *g) {
+    const __m128i mask = _mm_loadu_si128((const __m128i *)ssse3_unpack);
+    __m128i in0 = _mm_loadu_si128((const __m128i *)s);
+    __m128i in1 = _mm_loadu_si128((const __m128i *)(s + 16));
+    __m128i in2 = _mm_loadu_si128((const __m128i *)(s + 32));
+
+    g[0] = _mm_shuffle_epi8(in0, mask);
+    g[1] = _mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), mask);
+    g[2] = _mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), mask);
+    g[3] = _mm_shuffle_epi8(_mm_srli_si128(in2, 4), mask);
+}
+
+SSSE3 static inline void ssse3_pack_int(uint8_t *d, const int32_t *s, size_t blocks, const int8_t *shuffle) {
+    const __m128i mask = _mm_loadu_si128((const __m128i *)shuffle);
+
+    for (; blocks; blocks--, s += BLOCK_SAMPLES, d += 3 * BLOCK_SAMPLES)
+        ssse3_store48(d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)s), mask),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 4)), mask),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 8)), mask),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 12)), mask));
+}
+
+SSSE3 static void ssse3_pack_s32(void *dst, const void *src, size_t n) {
+    size_t blocks = n / BLOCK_SAMPLES;
+
+    ssse3_pack_int(dst, src, blocks, ssse3_pack_high);
+    scalar_pack_s32((uint8_t *)dst + blocks * 3 * BLOCK_SAMPLES, (const int32_t *)src + blocks * BLOCK_SAMPLES,
+                    n % BLOCK_SAMPLES);
+}
+
+SSSE3 static void ssse3_pack_s24_32(void *dst, const void *src, size_t n) {
+    size_t blocks = n / BLOCK_SAMPLES;
+
+    ssse3_pack_int(dst, src, blocks, ssse3_pack_low);
+    scalar_pack_s24_32((uint8_t *)dst + blocks * 3 * BLOCK_SAMPLES, (const int32_t *)src + blocks * BLOCK_SAMPLES,
+                       n % BLOCK_SAMPLES);
+}
+
+SSSE3 static inline __m128i ssse3_float_to_s24(const float *s, __m128i mask) {
+    __m128 f = _mm_loadu_ps(s);
+
+    /* same clamp order as float_to_s24, cvtps rounds to nearest even like lrintf */
+    f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_shuffle_epi8(_mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(S24_SCALE))), mask);
+}
+
+SSSE3 static void ssse3_pack_float(void *dst, const void *src, size_t n) {
+    const __m128i mask = _mm_loadu_si128((const __m128i *)ssse3_pack_low);
+    const float *s = src;
+    uint8_t *d = dst;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += BLOCK_SAMPLES, d += 3 * BLOCK_SAMPLES)
+        ssse3_store48(d, ssse3_float_to_s24(s, mask), ssse3_float_to_s24(s + 4, mask),
+                         ssse3_float_to_s24(s + 8, mask), ssse3_float_to_s24(s + 12, mask));
+
+    scalar_pack_float(d, s, n);
+}
+
+SSSE3 static void ssse3_unpack_s32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    int32_t *d = dst;
+    __m128i g[4];
+    unsigned i;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += BLOCK_SAMPLES) {
+        ssse3_load48(s, g);
+        for (i = 0; i < 4; i++)
+            _mm_storeu_si128((__m128i *)(d + 4 * i), g[i]);
+    }
+
+    scalar_unpack_s32(d, s, n);
+}
+
+SSSE3 static void ssse3_unpack_s24_32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    int32_t *d = dst;
+    __m128i g[4];
+    unsigned i;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += BLOCK_SAMPLES) {
+        ssse3_load48(s, g);
+        for (i = 0; i < 4; i++)
+            _mm_storeu_si128((__m128i *)(d + 4 * i), _mm_srai_epi32(g[i], 8));
+    }
+
+    scalar_unpack_s24_32(d, s, n);
+}
+
+SSSE3 static void ssse3_unpack_float(void *dst, const void *src, size_t n) {
+    const __m128 scale = _mm_set1_ps(S32_TO_FLOAT);
+    const uint8_t *s = src;
+    float *d = dst;
+    __m128i g[4];
+    unsigned i;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += BLOCK_SAMPLES) {
+        ssse3_load48(s, g);
+        for (i = 0; i < 4; i++)
+            _mm_storeu_ps(d + 4 * i, _mm_mul_ps(_mm_cvtepi32_ps(g[i]), scale));
+    }
+
+    scalar_unpack_float(d, s, n);
+}
+#endif
+
+#ifdef PAL_PCM_CONVERT_HAVE_NEON
+/* NEON is mandatory on AArch64. The interleaving loads and stores split 16
+ * samples into one register per byte lane and back, packing keeps three of
+ * the four lanes. */
+static void neon_pack_s32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8x16x4_t in;
+    uint8x16x3_t out;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 4 * BLOCK_SAMPLES, d += 3 * BLOCK_SAMPLES) {
+        in = vld4q_u8(s);
+        out.val[0] = in.val[1];
+        out.val[1] = in.val[2];
+        out.val[2] = in.val[3];
+        vst3q_u8(d, out);
+    }
+
+    scalar_pack_s32(d, s, n);
+}
+
+static void neon_pack_s24_32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8x16x4_t in;
+    uint8x16x3_t out;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 4 * BLOCK_SAMPLES, d += 3 * BLOCK_SAMPLES) {
+        in = vld4q_u8(s);
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        vst3q_u8(d, out);
+    }
+
+    scalar_pack_s24_32(d, s, n);
+}
+
+static inline uint8x16_t neon_float_to_s24(const float *s) {
+    float32x4_t f = vld1q_f32(s);
+
+    /* same clamp order as float_to_s24, vcvtn rounds to nearest even like lrintf */
+    f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    return vreinterpretq_u8_s32(vcvtnq_s32_f32(vmulq_n_f32(f, S24_SCALE)));
+}
+
+static void neon_pack_float(void *dst, const void *src, size_t n) {
+    const float *s = src;
+    uint8_t *d = dst;
+    uint8x16x2_t ab, ce, even, odd;
+    uint8x16x3_t out;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += BLOCK_SAMPLES, d += 3 * BLOCK_SAMPLES) {
+        /* two unzips do what vld4q_u8 does for samples already in memory */
+        ab = vuzpq_u8(neon_float_to_s24(s), neon_float_to_s24(s + 4));
+        ce = vuzpq_u8(neon_float_to_s24(s + 8), neon_float_to_s24(s + 12));
+        even = vuzpq_u8(ab.val[0], ce.val[0]);
+        odd = vuzpq_u8(ab.val[1], ce.val[1]);
+        out.val[0] = even.val[0];
+        out.val[1] = odd.val[0];
+        out.val[2] = even.val[1];
+        vst3q_u8(d, out);
+    }
+
+    scalar_pack_float(d, s, n);
+}
+
+static void neon_unpack_s32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += 4 * BLOCK_SAMPLES) {
+        in = vld3q_u8(s);
+        out.val[0] = vdupq_n_u8(0);
+        out.val[1] = in.val[0];
+        out.val[2] = in.val[1];
+        out.val[3] = in.val[2];
+        vst4q_u8(d, out);
+    }
+
+    scalar_unpack_s32(d, s, n);
+}
+
+static void neon_unpack_s24_32(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += 4 * BLOCK_SAMPLES) {
+        in = vld3q_u8(s);
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        /* sign extension of the top byte */
+        out.val[3] = vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(in.val[2]), 7));
+        vst4q_u8(d, out);
+    }
+
+    scalar_unpack_s24_32(d, s, n);
+}
+
+static void neon_unpack_float(void *dst, const void *src, size_t n) {
+    const uint8_t *s = src;
+    float *d = dst;
+    uint8x16x3_t in;
+    uint8x16x2_t lo, hi;
+    uint16x8x2_t w0, w1;
+
+    for (; n >= BLOCK_SAMPLES; n -= BLOCK_SAMPLES, s += 3 * BLOCK_SAMPLES, d += BLOCK_SAMPLES) {
+        in = vld3q_u8(s);
+        /* interleave back to S32: zero, byte 0, byte 1, byte 2 */
+        lo = vzipq_u8(vdupq_n_u8(0), in.val[0]);
+        hi = vzipq_u8(in.val[1], in.val[2]);
+        w0 = vzipq_u16(vreinterpretq_u16_u8(lo.val[0]), vreinterpretq_u16_u8(hi.val[0]));
+        w1 = vzipq_u16(vreinterpretq_u16_u8(lo.val[1]), vreinterpretq_u16_u8(hi.val[1]));
+        vst1q_f32(d, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(w0.val[0])), S32_TO_FLOAT));
+        vst1q_f32(d + 4, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(w0.val[1])), S32_TO_FLOAT));
+        vst1q_f32(d + 8, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(w1.val[0])), S32_TO_FLOAT));
+        vst1q_f32(d + 12, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(w1.val[1])), S32_TO_FLOAT));
+    }
+
+    scalar_unpack_float(d, s, n);
+}
+#endif
+
+static const pa_pal_pcm_convert_func_t pack_funcs[PA_PAL_PCM_CONVERT_MAX][FORMAT_MAX] = {
+    [PA_PAL_PCM_CONVERT_SCALAR] = { scalar_pack_s32, scalar_pack_s24_32, scalar_pack_float },
+#ifdef PAL_PCM_CONVERT_HAVE_SSSE3
+    [PA_PAL_PCM_CONVERT_SSSE3] = { ssse3_pack_s32, ssse3_pack_s24_32, ssse3_pack_float },
+#endif
+#ifdef PAL_PCM_CONVERT_HAVE_NEON
+    [PA_PAL_PCM_CONVERT_NEON] = { neon_pack_s32, neon_pack_s24_32, neon_pack_float },
+#endif
+};
+
+static const pa_pal_pcm_convert_func_t unpack_funcs[PA_PAL_PCM_CONVERT_MAX][FORMAT_MAX] = {
+    [PA_PAL_PCM_CONVERT_SCALAR] = { scalar_unpack_s32, scalar_unpack_s24_32, scalar_unpack_float },
+#ifdef PAL_PCM_CONVERT_HAVE_SSSE3
+    [PA_PAL_PCM_CONVERT_SSSE3] = { ssse3_unpack_s32, ssse3_unpack_s24_32, ssse3_unpack_float },
+#endif
+#ifdef PAL_PCM_CONVERT_HAVE_NEON
+    [PA_PAL_PCM_CONVERT_NEON] = { neon_unpack_s32, neon_unpack_s24_32, neon_unpack_float },
+#endif
+};
+
+static const char * const impl_names[PA_PAL_PCM_CONVERT_MAX] = {
+    [PA_PAL_PCM_CONVERT_SCALAR] = "scalar",
+    [PA_PAL_PCM_CONVERT_SSSE3] = "ssse3",
+    [PA_PAL_PCM_CONVERT_NEON] = "neon",
+};
+
+bool pa_pal_pcm_convert_supported(pa_sample_format_t format) {
+    return format_index(format) >= 0;
+}
+
+bool pa_pal_pcm_convert_impl_available(pa_pal_pcm_convert_impl_t impl) {
+    switch (impl) {
+        case PA_PAL_PCM_CONVERT_SCALAR:
+            return true;
+#ifdef PAL_PCM_CONVERT_HAVE_SSSE3
+        case PA_PAL_PCM_CONVERT_SSSE3:
+            return __builtin_cpu_supports("ssse3");
+#endif
+#ifdef PAL_PCM_CONVERT_HAVE_NEON
+        case PA_PAL_PCM_CONVERT_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *pa_pal_pcm_convert_impl_to_string(pa_pal_pcm_convert_impl_t impl) {
+    return (impl < PA_PAL_PCM_CONVERT_MAX) ? impl_names[impl] : NULL;
+}
+
+pa_pal_pcm_convert_impl_t pa_pal_pcm_convert_best(void) {
+    const char *forced = getenv("PA_PAL_PCM_CONVERT");
+    int impl;
+
+    if (forced) {
+        for (impl = 0; impl < PA_PAL_PCM_CONVERT_MAX; impl++) {
+            if (!strcmp(forced, impl_names[impl]) && pa_pal_pcm_convert_impl_available(impl))
+                return impl;
+        }
+    }
+
+    for (impl = PA_PAL_PCM_CONVERT_MAX - 1; impl > PA_PAL_PCM_CONVERT_SCALAR; impl--) {
+        if (pa_pal_pcm_convert_impl_available(impl))
+            return impl;
+    }
+
+    return PA_PAL_PCM_CONVERT_SCALAR;
+}
+
+pa_pal_pcm_convert_func_t pa_pal_pcm_convert_get_pack(pa_pal_pcm_convert_impl_t impl, pa_sample_format_t format) {
+    int i = format_index(format);
+
+    if (i < 0 || !pa_pal_pcm_convert_impl_available(impl))
+        return NULL;
+
+    return pack_funcs[impl][i];
+}
+
+pa_pal_pcm_convert_func_t pa_pal_pcm_convert_get_unpack(pa_pal_pcm_convert_impl_t impl, pa_sample_format_t format) {
+    int i = format_index(format);
+
+    if (i < 0 || !pa_pal_pcm_convert_impl_available(impl))
+        return NULL;
+
+    return unpack_funcs[impl][i];
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* cpu_set_t and pthread_setaffinity_np */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pulsecore/core-error.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "pal-sched.h"
+
+/* what pulseaudio uses when realtime-priority is not configured */
+#define PA_PAL_SCHED_DEFAULT_PRIORITY 5
+#define PA_PAL_SCHED_MAX_CPUS 64
+
+int pa_pal_sched_parse_policy(const char *s, pa_pal_sched_policy_t *policy) {
+    pa_assert(s);
+    pa_assert(policy);
+
+    if (pa_streq(s, "fifo"))
+        *policy = PA_PAL_SCHED_POLICY_FIFO;
+    else if (pa_streq(s, "rr"))
+        *policy = PA_PAL_SCHED_POLICY_RR;
+    else if (pa_streq(s, "other"))
+        *policy = PA_PAL_SCHED_POLICY_OTHER;
+    else
+        return -1;
+
+    return 0;
+}
+
+int pa_pal_sched_parse_priority(const char *s, int *priority) {
+    int32_t value;
+
+    pa_assert(s);
+    pa_assert(priority);
+
+    if (pa_atoi(s, &value) < 0 || value < 1 || value > 99)
+        return -1;
+
+    *priority = value;
+
+    return 0;
+}
+
+int pa_pal_sched_parse_cpu_mask(const char *s, uint64_t *mask) {
+    unsigned long first, last;
+    uint64_t result = 0;
+    char *end;
+
+    pa_assert(s);
+    pa_assert(mask);
+
+    if (pa_startswith(s, "0x")) {
+        errno = 0;
+        result = strtoull(s, &end, 16);
+        if (errno || *end || end == s + 2 || !result)
+            return -1;
+
+        *mask = result;
+        return 0;
+    }
+
+    while (*s) {
+        errno = 0;
+        first = strtoul(s, &end, 10);
+        if (errno || end == s)
+            return -1;
+
+        last = first;
+        s = end;
+        if (*s == '-') {
+            s++;
+            last = strtoul(s, &end, 10);
+            if (errno || end == s)
+                return -1;
+            s = end;
+        }
+
+        if (first > last || last >= PA_PAL_SCHED_MAX_CPUS)
+            return -1;
+
+        for (; first <= last; first++)
+            result |= UINT64_C(1) << first;
+
+        if (*s == ',')
+            s++;
+        else if (*s)
+            return -1;
+    }
+
+    if (!result)
+        return -1;
+
+    *mask = result;
+
+    return 0;
+}
+
+static void pa_pal_sched_set_affinity(uint64_t cpu_mask, const char *name) {
+    cpu_set_t set;
+    unsigned i;
+    int rc;
+
+    CPU_ZERO(&set);
+    for (i = 0; i < PA_PAL_SCHED_MAX_CPUS; i++) {
+        if (cpu_mask & (UINT64_C(1) << i))
+            CPU_SET(i, &set);
+    }
+
+    if ((rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)))
+        pa_log_warn("%s: could not set cpu affinity 0x%" PRIx64 ": %s", name, cpu_mask, pa_cstrerror(rc));
+    else
+        pa_log_info("%s: cpu affinity 0x%" PRIx64, name, cpu_mask);
+}
+
+void pa_pal_sched_apply(const pa_pal_sched_config *cfg, pa_core *core, const char *name) {
+    struct sched_param param;
+    int priority;
+    int rc;
+
+    pa_assert(cfg);
+    pa_assert(name);
+
+    /* pinned first, a realtime thread should not start out on the wrong cluster */
+    if (cfg->cpu_mask)
+        pa_pal_sched_set_affinity(cfg->cpu_mask, name);
+
+    priority = cfg->priority ? cfg->priority :
+               (core ? core->realtime_priority : PA_PAL_SCHED_DEFAULT_PRIORITY);
+
+    switch (cfg->policy) {
+        case PA_PAL_SCHED_POLICY_DEFAULT:
+            if (!core || !core->realtime_scheduling)
+                break;
+            /* fall through */
+        case PA_PAL_SCHED_POLICY_RR:
+            /* goes through rtkit when the daemon may not set it itself */
+            if (pa_thread_make_realtime(priority) < 0)
+                pa_log_warn("%s: could not make thread realtime with prio %d", name, priority);
+            else
+                pa_log_info("%s: realtime with prio %d", name, priority);
+            break;
+        case PA_PAL_SCHED_POLICY_FIFO:
+            memset(&param, 0, sizeof(param));
+            param.sched_priority = priority;
+            if ((rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))) {
+                pa_log_warn("%s: could not set SCHED_FIFO prio %d: %s, trying SCHED_RR", name, priority,
+                            pa_cstrerror(rc));
+                if (pa_thread_make_realtime(priority) < 0)
+                    pa_log_warn("%s: could not make thread realtime with prio %d", name, priority);
+            } else {
+                pa_log_info("%s: SCHED_FIFO with prio %d", name, priority);
+            }
+            break;
+        case PA_PAL_SCHED_POLICY_OTHER:
+            pa_log_debug("%s: not realtime", name);
+            break;
+    }
+}
@@ -34,7 +34,12 @@
 
 /* #define SINK_DEBUG */
 
-/* #define SINK_DUMP_ENABLED */
+/* control worker polls the PAL thread for the end of the fade out */
+#define PA_PAL_SINK_SWITCH_POLL_MS 2
+
+/* optional format info properties of a compressed track, in samples */
+#define PA_PAL_SINK_PROP_ENCODER_DELAY "encoder-delay"
+#define PA_PAL_SINK_PROP_ENCODER_PADDING "encoder-padding"
 
 #define PAL_MAX_GAIN 1
 
@@ -47,7 +52,14 @@
 #define PA_BITS_PER_BYTE 8
 #define PA_DEFAULT_BUFFER_DURATION_MS 25
 #define PA_LOW_LATENCY_BUFFER_DURATION_MS 5
+#define PA_ULTRA_LOW_LATENCY_BUFFER_DURATION_MS 2
 #define PA_DEEP_BUFFER_BUFFER_DURATION_MS 20
+#define PA_PAL_SINK_DEFAULT_TSCHED_WATERMARK_MS 20
+
+/* adaptive buffer size: telemetry window, and clean windows before shrinking */
+#define PA_PAL_SINK_ADAPT_WINDOW_USEC (2 * PA_USEC_PER_SEC)
+#define PA_PAL_SINK_ADAPT_SHRINK_WINDOWS 5
+#define PA_PAL_SINK_ADAPT_MAX_SHRINK_WINDOWS 80
 
 
 typedef struct {
@@ -61,10 +73,12 @@ static int restart_pal_sink(pa_sink *s, pa_encoding_t encoding, pa_sample_spec *
                             pa_pal_sink_data *sdata, uint32_t buffer_size, uint32_t buffer_count);
 static int create_pal_sink(pa_pal_sink_config *sink, pa_pal_card_port_device_data *port_device_data, pa_pal_sink_data *sdata);
 static int close_pal_sink(pa_pal_sink_data *sdata);
+static int release_pal_sink(pa_pal_sink_data *sdata, bool park);
 static int free_pa_sink(pa_pal_sink_data *sdata);
 static int open_pal_sink(pa_pal_sink_data *sdata);
 static int pa_pal_set_param(pal_sink_data *pal_sdata, uint32_t param_id);
 static void free_pal_sink_thread_resources(pal_sink_data *pal_sdata);
+static void pa_pal_sink_update_buffering(pal_sink_data *pal_sdata, const pa_sample_spec *ss);
 
 static const uint32_t supported_sink_rates[] =
                           {8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000};
@@ -80,6 +94,9 @@ static size_t sink_get_buffer_size(pa_sample_spec spec, pal_stream_type_t type)
         case PAL_STREAM_LOW_LATENCY:
             buffer_duration = PA_LOW_LATENCY_BUFFER_DURATION_MS;
             break;
+        case PAL_STREAM_ULTRA_LOW_LATENCY:
+            buffer_duration = PA_ULTRA_LOW_LATENCY_BUFFER_DURATION_MS;
+            break;
         default:
             break;
     }
@@ -138,6 +155,8 @@ static const char *pa_pal_sink_get_name_from_type(pal_stream_type_t type) {
 
     if (type == PAL_STREAM_LOW_LATENCY)
         name = "low_latency";
+    else if (type == PAL_STREAM_ULTRA_LOW_LATENCY)
+        name = "ultra_low_latency";
     else if (type == PAL_STREAM_DEEP_BUFFER)
         name = "deep_buffer";
     else if (type == PAL_STREAM_COMPRESSED)
@@ -152,13 +171,21 @@ static const char *pa_pal_sink_get_name_from_type(pal_stream_type_t type) {
     return name;
 }
 
+/* control worker: send the latest volume, earlier updates of a burst were dropped */
+static void pa_pal_sink_apply_volume(void *userdata) {
+    pal_sink_data *pal_sdata = userdata;
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    if (pal_sdata->stream_handle)
+        pa_pal_volume_apply(pal_sdata->volume, pal_sdata->stream_handle);
+    pa_pal_lock_release(pal_sdata->lock);
+}
+
 static void pa_pal_sink_set_volume_cb(pa_sink *s) {
     pa_pal_sink_data *sdata = NULL;
     float gain;
-    int rc;
     pa_volume_t volume;
     pal_sink_data *pal_sdata = NULL;
-    struct pal_volume_data *volume_data = NULL;
     uint32_t i,no_vol_pair;
     uint32_t channel_mask = 1;
 
@@ -179,43 +206,28 @@ static void pa_pal_sink_set_volume_cb(pa_sink *s) {
     gain = ((float) pa_cvolume_max(&s->real_volume) * (float)PAL_MAX_GAIN) / (float)PA_VOLUME_NORM;
     volume = (pa_volume_t) roundf((float) gain * PA_VOLUME_NORM / PAL_MAX_GAIN);
 
-    volume_data = (struct pal_volume_data *)malloc(sizeof(uint32_t) +
-                                                 (sizeof(struct pal_channel_vol_kv) * (no_vol_pair)));
-    if (!volume_data) {
-        pa_log_error("malloc failed for size %zu", sizeof(uint32_t) +
-                 (sizeof(struct pal_channel_vol_kv) * (no_vol_pair)));
-        return;
-    }
-
-    volume_data->no_of_volpair = no_vol_pair;
-
     for (i = 0; i < no_vol_pair; i++) {
         channel_mask = (channel_mask | pal_sdata->stream_attributes->out_media_config.ch_info.ch_map[i]);
     }
 
     channel_mask = (channel_mask << 1);
 
-    for (i = 0; i < no_vol_pair; i++) {
-        volume_data->volume_pair[i].channel_mask = channel_mask;
-        volume_data->volume_pair[i].vol = gain;
+    /* a slider drag is a burst of these, the worker sends only the last one */
+    pa_pal_volume_set(pal_sdata->volume, gain, no_vol_pair, channel_mask);
+    if (!pa_pal_worker_post(pal_sdata->ctrl_worker, pal_sdata->volume, pa_pal_sink_apply_volume, pal_sdata)) {
+        pa_log_info("pal sink has no control worker, setting volume synchronously");
+        pa_pal_sink_apply_volume(pal_sdata);
     }
 
-    pal_sdata->sink_event_id = PA_PAL_VOLUME_APPLY;
-    pa_mutex_lock(pal_sdata->mutex);
-    rc = pal_stream_set_volume(pal_sdata->stream_handle, volume_data);
-    pal_sdata->sink_event_id = PA_PAL_NO_EVENT;
-    pa_mutex_unlock(pal_sdata->mutex);
-    pa_cond_signal(pal_sdata->cond_ctrl_thread, 0);
-    if (rc)
-        pa_log_error("pal stream : unable to set volume error %d\n", rc);
-    else
-        pa_cvolume_set(&s->real_volume, s->real_volume.channels, volume); /* TODO: Is this correct?  */
+    pa_cvolume_set(&s->real_volume, s->real_volume.channels, volume); /* TODO: Is this correct?  */
 
-    pa_xfree(volume_data);
     return;
 }
 
 static int pa_pal_sink_fill_info(pa_pal_sink_config *sink, pal_sink_data *pal_sdata, pa_pal_card_port_device_data *port_device_data, pal_audio_fmt_t encoding) {
+    pa_sample_spec ss;
+    pa_pal_pcm_convert_impl_t impl;
+
     pa_assert(pal_sdata);
 
     pal_sdata->stream_attributes = pa_xnew0(struct pal_stream_attributes, 1);
@@ -247,6 +259,22 @@ static int pa_pal_sink_fill_info(pa_pal_sink_config *sink, pal_sink_data *pal_sd
         pal_sdata->stream_attributes->info.opt_stream_info.duration_us = 4000;
         pal_sdata->stream_attributes->flags = PAL_STREAM_FLAG_NON_BLOCKING_MASK;
         pal_sdata->compressed = true;
+    } else if (pal_sdata->stream_attributes->type == PAL_STREAM_ULTRA_LOW_LATENCY) {
+        /* no IRQ, nothing reports consumed buffers, the I/O thread polls the DSP position */
+        pal_sdata->stream_attributes->flags = PAL_STREAM_FLAG_MMAP_NO_IRQ_MASK;
+        pal_sdata->mmap = true;
+    }
+
+    /* PulseAudio renders in convert_format, the PAL thread packs it */
+    ss = sink->default_spec;
+    if (sink->default_spec.format == PA_SAMPLE_S24LE && pa_pal_pcm_convert_supported(sink->convert_format) &&
+            !pal_sdata->compressed && !pal_sdata->mmap) {
+        impl = pa_pal_pcm_convert_best();
+        if ((pal_sdata->convert = pa_pal_pcm_convert_get_pack(impl, sink->convert_format))) {
+            ss.format = sink->convert_format;
+            pa_log_info("%s: packing %s to s24le, %s", sink->name, pa_sample_format_to_string(ss.format),
+                        pa_pal_pcm_convert_impl_to_string(impl));
+        }
     }
 
     pal_sdata->pal_snd_dec = pa_xnew0(pal_snd_dec_t, 1);
@@ -276,83 +304,241 @@ static int pa_pal_sink_fill_info(pa_pal_sink_config *sink, pal_sink_data *pal_sd
     pal_sdata->device_url = NULL; /* TODO: useful for BT devices */
     pal_sdata->bytes_written = 0;
     pal_sdata->index = sink->id;
-    pal_sdata->buffer_size = (size_t)(sink->buffer_size);
+    /* configured in packed bytes, kept in rendered bytes */
+    pal_sdata->buffer_size = pal_sdata->convert ?
+        (size_t)(sink->buffer_size) / PA_PAL_PCM_CONVERT_PACKED_BYTES * PA_PAL_PCM_CONVERT_HOST_BYTES :
+        (size_t)(sink->buffer_size);
     pal_sdata->buffer_count = (size_t)(sink->buffer_count);
-    /* FIXME: Add DSP latency */
-    pal_sdata->sink_latency_us = pa_bytes_to_usec(pal_sdata->buffer_size, &sink->default_spec);
-    pal_sdata->sink_event_id = PA_PAL_NO_EVENT;
-    pal_sdata->cond_ctrl_thread = pa_cond_new();
-    pa_log_debug("sink latency %dus", pal_sdata->sink_latency_us);
+
+    pal_sdata->gapless = sink->gapless;
+    pal_sdata->sched = sink->sched;
+
+    /* compressed sessions carry codec state, only PCM sessions are kept warm.
+     * An MMAP session is cheap to reopen and its position restarts at zero. */
+    pal_sdata->standby_hold_us = (pal_sdata->compressed || pal_sdata->mmap) ? 0 :
+                                 (pa_usec_t)sink->standby_hold_ms * PA_USEC_PER_MSEC;
+
+    /* timer scheduling keeps up to buffer_count buffers queued in the DSP */
+    pal_sdata->tsched = sink->tsched && !pal_sdata->compressed && !pal_sdata->mmap && pal_sdata->buffer_size > 0;
+    pal_sdata->tsched_watermark_cfg_us = sink->tsched_watermark_ms ?
+        (pa_usec_t)sink->tsched_watermark_ms * PA_USEC_PER_MSEC : PA_PAL_SINK_DEFAULT_TSCHED_WATERMARK_MS * PA_USEC_PER_MSEC;
+    pa_pal_sink_update_buffering(pal_sdata, &ss);
+
+    /* only buffer_size adapts, buffer_count stays as configured */
+    pal_sdata->adaptive = !pal_sdata->compressed && !pal_sdata->mmap && pal_sdata->buffer_size > 0 &&
+                          sink->adaptive_buffer_min_ms > 0 &&
+                          sink->adaptive_buffer_max_ms > sink->adaptive_buffer_min_ms;
+    if (pal_sdata->adaptive) {
+        pal_sdata->adapt.min_ms = sink->adaptive_buffer_min_ms;
+        pal_sdata->adapt.max_ms = sink->adaptive_buffer_max_ms;
+        pal_sdata->adapt.cur_ms = (uint32_t)(pa_bytes_to_usec(pal_sdata->buffer_size, &ss) / PA_USEC_PER_MSEC);
+        /* a configured size out of bounds is corrected at the first start */
+        pal_sdata->adapt.target_ms = PA_CLAMP(pal_sdata->adapt.cur_ms, pal_sdata->adapt.min_ms, pal_sdata->adapt.max_ms);
+        pal_sdata->adapt.shrink_windows = PA_PAL_SINK_ADAPT_SHRINK_WINDOWS;
+        pal_sdata->adapt.since_shrink = PA_PAL_SINK_ADAPT_MAX_SHRINK_WINDOWS;
+        pa_log_debug("adaptive buffer size between %u and %u ms", pal_sdata->adapt.min_ms, pal_sdata->adapt.max_ms);
+    }
 
     pal_sdata->standby = true;
 
     return 0;
 }
 
-static uint64_t pa_pal_sink_get_latency(pa_pal_sink_data *sdata) {
+/* bytes rendered into the ring but not yet handed to PAL */
+static size_t pa_pal_sink_ring_pending(pal_sink_data *pal_sdata) {
+    return (size_t)pa_atomic_load(&pal_sdata->ring_bytes);
+}
+
+/* everything that can sit between the render loop and the DSP read pointer */
+static size_t pa_pal_sink_get_max_rewind(pal_sink_data *pal_sdata) {
+    size_t max_rewind;
+
+    if (pal_sdata->compressed)
+        return 0;
+
+    /* rendered straight into the DSP buffer, at most buffer_size ahead of it */
+    if (pal_sdata->mmap)
+        return pal_sdata->buffer_size;
+
+    max_rewind = pal_sdata->buffer_size * PA_MAX(pal_sdata->buffer_count, (size_t)1);
+    /* without timer scheduling the ring fills on top of a full DSP queue */
+    if (!pal_sdata->tsched)
+        max_rewind += pal_sdata->buffer_size * PAL_SINK_RING_DEPTH;
+
+    return max_rewind;
+}
+
+/* Sink latency, tsched watermark and late write threshold for the current
+ * buffer size, called whenever buffer_size or the sample spec changes. */
+static void pa_pal_sink_update_buffering(pal_sink_data *pal_sdata, const pa_sample_spec *ss) {
+    pa_usec_t buffer_usec = pa_bytes_to_usec(pal_sdata->buffer_size, ss);
+    pa_usec_t capacity_usec = buffer_usec * PA_MAX(pal_sdata->buffer_count, (size_t)1);
+
+    /* FIXME: Add DSP latency */
+    pal_sdata->sink_latency_us = buffer_usec;
+    pal_sdata->late_write_us = pa_bytes_to_usec(pa_pal_sink_get_max_rewind(pal_sdata), ss);
+
+    if (pal_sdata->tsched) {
+        pal_sdata->tsched_watermark_us = pal_sdata->tsched_watermark_cfg_us;
+        if (pal_sdata->tsched_watermark_us + buffer_usec > capacity_usec) {
+            pa_log_info("tsched watermark %" PRIu64 " us too high for %" PRIu64 " us of DSP buffering, clamping",
+                        pal_sdata->tsched_watermark_us, capacity_usec);
+            pal_sdata->tsched_watermark_us = (capacity_usec > buffer_usec) ? capacity_usec - buffer_usec : 0;
+        }
+        pal_sdata->sink_latency_us = capacity_usec;
+        pa_log_debug("timer scheduling enabled, watermark %" PRIu64 " us", pal_sdata->tsched_watermark_us);
+    }
+    pa_log_debug("sink latency %dus", pal_sdata->sink_latency_us);
+}
+
+/* Compressed buffers are written non-blocking and refilled on WRITE_READY,
+ * keeping buffer_count of them queued hides the callback latency. */
+static unsigned pa_pal_sink_ring_depth(pal_sink_data *pal_sdata) {
+    if (!pal_sdata->compressed)
+        return PAL_SINK_RING_DEPTH;
+
+    return PA_CLAMP_UNLIKELY((unsigned)pal_sdata->buffer_count, 2U, PAL_SINK_RING_MAX_DEPTH);
+}
+
+/* producer side, sink I/O thread only */
+static bool pa_pal_sink_ring_push(pa_pal_sink_data *sdata, size_t length) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_memchunk *chunk;
+
+    if (pa_atomic_load(&pal_sdata->ring_fill) >= (int)pa_pal_sink_ring_depth(pal_sdata))
+        return false;
+
+    chunk = &pal_sdata->ring[pal_sdata->ring_write_index];
+    if (pal_sdata->compressed) {
+        /* an encoded stream must not be padded with silence */
+        pa_sink_render(sdata->pa_sdata->sink, length, chunk);
+        pa_assert(chunk->length > 0);
+    } else {
+        pa_sink_render_full(sdata->pa_sdata->sink, length, chunk);
+        pa_assert(chunk->length == length);
+    }
+
+    pal_sdata->ring_seq[pal_sdata->ring_write_index] = pa_atomic_load(&pal_sdata->rewind_seq);
+    pal_sdata->ring_time[pal_sdata->ring_write_index] = pa_rtclock_now();
+    pal_sdata->ring_track[pal_sdata->ring_write_index] = pa_atomic_load(&pal_sdata->track);
+    pal_sdata->ring_write_index = (pal_sdata->ring_write_index + 1) % PAL_SINK_RING_MAX_DEPTH;
+    pa_atomic_add(&pal_sdata->ring_bytes, (int)chunk->length);
+    pa_atomic_inc(&pal_sdata->ring_fill);
+
+    return true;
+}
+
+/* consumer side, PAL thread only */
+static pa_memchunk *pa_pal_sink_ring_peek(pal_sink_data *pal_sdata) {
+    if (pa_atomic_load(&pal_sdata->ring_fill) <= 0)
+        return NULL;
+
+    return &pal_sdata->ring[pal_sdata->ring_read_index];
+}
+
+/* ring_bytes is consumed by write_chunk as data reaches PAL, not here */
+static void pa_pal_sink_ring_pop(pal_sink_data *pal_sdata) {
+    pa_memchunk_reset(&pal_sdata->ring[pal_sdata->ring_read_index]);
+    pal_sdata->ring_read_index = (pal_sdata->ring_read_index + 1) % PAL_SINK_RING_MAX_DEPTH;
+    pa_atomic_dec(&pal_sdata->ring_fill);
+}
+
+/* bytes played out by the DSP so far, extrapolated from the last session timestamp */
+/* updated by the PAL thread and read by the sink I/O thread, 64 bit accesses may tear on 32 bit targets */
+static inline uint64_t pa_pal_sink_bytes_written(pal_sink_data *pal_sdata) {
+    return __atomic_load_n(&pal_sdata->bytes_written, __ATOMIC_ACQUIRE);
+}
+
+static inline void pa_pal_sink_set_bytes_written(pal_sink_data *pal_sdata, uint64_t bytes) {
+    __atomic_store_n(&pal_sdata->bytes_written, bytes, __ATOMIC_RELEASE);
+}
+
+static int pa_pal_sink_get_bytes_rendered(pa_pal_sink_data *sdata, uint64_t *bytes_rendered) {
     int rc;
-    uint64_t bytes_rendered;
-    int64_t delta, latency = 0, ticks = 0;
-    uint64_t cur_qtimer, abs_qtimer_time_stamp, session_time_stamp;
-    uint64_t cur_session_time = 0, time_in_future = 0, time_elapsed = 0;
-    pal_sink_data *pal_sdata;
+    uint64_t session_time_stamp = 0, cur_session_time = 0;
     pa_sink_data *pa_sdata;
-    struct pal_session_time stime = {0};
-
-#ifdef SINK_DEBUG
-    pa_log_debug("%s", __func__);
-#endif
 
     pa_assert(sdata);
     pa_assert(sdata->pa_sdata);
     pa_assert(sdata->pal_sdata);
 
-    pal_sdata = sdata->pal_sdata;
     pa_sdata = sdata->pa_sdata;
 
     pa_assert(pa_sdata->sink);
     pa_assert(sdata->pal_sdata->stream_handle);
 
-    rc = pal_get_timestamp(sdata->pal_sdata->stream_handle, &stime);
-    if (!rc) {
-        abs_qtimer_time_stamp = (uint64_t)(((uint64_t)stime.absolute_time.value_msw << 32) | (uint64_t)stime.absolute_time.value_lsw);
-        session_time_stamp = (uint64_t)(((uint64_t)stime.session_time.value_msw << 32) | (uint64_t)stime.session_time.value_lsw);
+    rc = pa_pal_util_get_session_time(sdata->pal_sdata->stream_handle, &session_time_stamp, &cur_session_time);
+    if (rc)
+        return rc;
+
 #ifndef PAL_DISABLE_COMPRESS_AUDIO_SUPPORT
-        pa_sdata->sink->sess_time = session_time_stamp;
+    pa_sdata->sink->sess_time = session_time_stamp;
 #endif
 
+    *bytes_rendered = pa_usec_to_bytes(cur_session_time, &pa_sdata->sink->sample_spec);
+
 #ifdef SINK_DEBUG
-        pa_log_debug("%s: abs_qtimer_time_stamp %" PRId64 " us, session_time_stamp %" PRId64 " us", __func__,
-                     abs_qtimer_time_stamp, session_time_stamp);
+    pa_log_debug("%s:: session_time_stamp %" PRIu64 ", cur_session_time %" PRIu64 " bytes_rendered %" PRIu64, __func__,
+                 session_time_stamp, cur_session_time, *bytes_rendered);
 #endif
 
-#if defined __aarch64__
-        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
-#else
-        asm volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(ticks));
-#endif
+    return 0;
+}
+
+/* frames rendered into the MMAP buffer the DSP has not read yet */
+static uint64_t pa_pal_sink_mmap_queued(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+
+    if (!pal_sdata->stream_handle || pal_sdata->standby)
+        return 0;
 
-        cur_qtimer = (uint64_t)(ticks * 10/192);
+    if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_read, false))
+        pa_log_debug("%s: mmap position unavailable, using the last one", __func__);
+
+    return (pal_sdata->mmap_written > pal_sdata->mmap_read) ? pal_sdata->mmap_written - pal_sdata->mmap_read : 0;
+}
+
+static uint64_t pa_pal_sink_get_latency(pa_pal_sink_data *sdata) {
+    uint64_t bytes_rendered, bytes_written;
+    int64_t delta, latency = 0;
+    pal_sink_data *pal_sdata;
+    pa_sink_data *pa_sdata;
 
 #ifdef SINK_DEBUG
-        pa_log_debug("%s:: ticks %" PRId64 " us, qtimer %" PRId64 " us", __func__, ticks, (int64_t)cur_qtimer);
+    pa_log_debug("%s", __func__);
 #endif
 
-        if (abs_qtimer_time_stamp > cur_qtimer) {
-            time_in_future = abs_qtimer_time_stamp - cur_qtimer;
-            if (time_in_future < session_time_stamp) {
-                cur_session_time = session_time_stamp - time_in_future;
-                bytes_rendered = pa_usec_to_bytes(cur_session_time, &pa_sdata->sink->sample_spec);
-            } else {
-                bytes_rendered = 0;
-            }
-        } else {
-            time_elapsed = cur_qtimer - abs_qtimer_time_stamp;
-            cur_session_time = session_time_stamp + time_elapsed;
-            bytes_rendered = pa_usec_to_bytes(cur_session_time, &pa_sdata->sink->sample_spec);
+    pa_assert(sdata);
+    pa_assert(sdata->pa_sdata);
+    pa_assert(sdata->pal_sdata);
+
+    pal_sdata = sdata->pal_sdata;
+    pa_sdata = sdata->pa_sdata;
+
+    if (pal_sdata->mmap)
+        return pa_bytes_to_usec(pa_pal_sink_mmap_queued(sdata) * pa_frame_size(&pa_sdata->sink->sample_spec),
+                                &pa_sdata->sink->sample_spec);
+
+    /* the PAL thread rebased bytes_written after a rewind flush */
+    if (pa_atomic_cmpxchg(&pal_sdata->dll_reset, 1, 0))
+        pa_pal_clock_dll_reset(&pal_sdata->latency_dll);
+
+    bytes_written = pa_pal_sink_bytes_written(pal_sdata);
+
+    if (!pa_pal_sink_get_bytes_rendered(sdata, &bytes_rendered)) {
+        bytes_rendered = pa_usec_to_bytes(pa_pal_clock_dll_update(&pal_sdata->latency_dll, pa_pal_clock_now_us(),
+                                          pa_bytes_to_usec(bytes_rendered, &pa_sdata->sink->sample_spec)),
+                                          &pa_sdata->sink->sample_spec);
+        delta = bytes_written + pa_pal_sink_ring_pending(pal_sdata) - bytes_rendered;
+
+        if (delta <= 0 && bytes_written && !pal_sdata->compressed) {
+            if (!pal_sdata->underrun)
+                pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_UNDERRUNS);
+            pal_sdata->underrun = true;
+        } else if (delta > 0) {
+            pal_sdata->underrun = false;
         }
 
-        delta = pal_sdata->bytes_written - bytes_rendered;
         /* bytes written should never be less than bytes rendered */
         if (delta <= 0) {
 #ifdef SINK_DEBUG
@@ -363,11 +549,11 @@ static uint64_t pa_pal_sink_get_latency(pa_pal_sink_data *sdata) {
 
         latency = pa_bytes_to_usec(delta, &pa_sdata->sink->sample_spec);
 #ifdef SINK_DEBUG
-        pa_log_debug("%s:: time_in_future %" PRId64 ", cur_session_time %" PRId64 " bytes_rendered %d, latency %" PRId64 "", __func__,
-                     time_in_future, cur_session_time, bytes_rendered, (int64_t)latency);
+        pa_log_debug("%s:: latency %" PRId64 "", __func__, (int64_t)latency);
 #endif
     } else  {
-        latency = (int64_t)(pa_bytes_to_usec(pal_sdata->bytes_written, &pa_sdata->sink->sample_spec));
+        latency = (int64_t)(pa_bytes_to_usec(bytes_written + pa_pal_sink_ring_pending(pal_sdata),
+                                             &pa_sdata->sink->sample_spec));
 #ifdef SINK_DEBUG
         pa_log_debug("pal_get_timestamp failed, using latency based on written bytes latency = %" PRId64 "", latency);
 #endif
@@ -381,6 +567,227 @@ static uint64_t pa_pal_sink_get_latency(pa_pal_sink_data *sdata) {
     return (uint64_t)latency;
 }
 
+/* Rewind by dropping everything queued after the DSP read pointer: flush the
+ * PAL stream, discard the ring and let the sink inputs re-render it all.
+ * The flush itself runs on the PAL thread, see pa_pal_sink_flush_rewound. */
+static void pa_pal_sink_process_rewind(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *sink = sdata->pa_sdata->sink;
+    uint64_t rendered, written;
+    size_t rewind_nbytes = 0, queued;
+
+    if (pal_sdata->compressed || !sdata->pal_sink_opened || pal_sdata->standby ||
+            !sink->thread_info.rewind_nbytes || !PA_SINK_IS_OPENED(sink->thread_info.state))
+        goto done;
+
+    if (pal_sdata->mmap) {
+        size_t frame_size = pa_frame_size(&sink->sample_spec);
+        uint64_t frames = pa_pal_sink_mmap_queued(sdata);
+        uint64_t burst = pal_sdata->mmap_buffer.burst_size_frames;
+
+        /* the next burst may already be on its way to the DSP, rewrite everything after it */
+        frames = (frames > burst) ? frames - burst : 0;
+        frames = PA_MIN(frames, PA_MIN(sink->thread_info.rewind_nbytes, sink->thread_info.max_rewind) / frame_size);
+        pal_sdata->mmap_written -= frames;
+        rewind_nbytes = frames * frame_size;
+        goto done;
+    }
+
+    /* the flush of the previous rewind has not reached the DSP yet, what it
+     * reported as queued is already gone */
+    if (pa_atomic_load(&pal_sdata->flush_pending))
+        goto done;
+
+    if (!pal_sdata->stream_handle || pa_pal_sink_get_bytes_rendered(sdata, &rendered))
+        goto done;
+
+    /* a write still in flight is counted in the ring until it returns */
+    written = pa_pal_sink_bytes_written(pal_sdata);
+    queued = (written > rendered) ? (size_t)(written - rendered) : 0;
+    queued += pa_pal_sink_ring_pending(pal_sdata);
+    if (!queued)
+        goto done;
+
+    /* pause, flush and resume block in PAL, leave them to the PAL thread. It
+     * drops every chunk queued before this point and flushes the stream
+     * before it writes anything rendered after it. */
+    pa_atomic_inc(&pal_sdata->rewind_seq);
+    pa_atomic_store(&pal_sdata->flush_pending, 1);
+    pa_fdsem_post(pal_sdata->pal_fdsem);
+
+    rewind_nbytes = PA_MIN(queued, sink->thread_info.max_rewind);
+
+#ifdef SINK_DEBUG
+    pa_log_debug("%s: requested %zu, queued %zu, rewinding %zu", __func__, sink->thread_info.rewind_nbytes,
+                 queued, rewind_nbytes);
+#endif
+
+done:
+    pa_sink_process_rewind(sink, rewind_nbytes);
+}
+
+/* Pause and flush the session instead of closing it, the PAL thread drops
+ * whatever is still queued while close_output is set. */
+static int pa_pal_sink_standby_warm(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    int rc = -1;
+
+    pa_atomic_store(&pal_sdata->close_output, 1);
+    if (pal_sdata->pal_fdsem)
+        pa_fdsem_post(pal_sdata->pal_fdsem);
+
+    pa_mutex_lock(pal_sdata->write_mutex);
+    pa_pal_lock_acquire(pal_sdata->lock);
+    pa_atomic_inc(&pal_sdata->rewind_seq);
+    /* covers a rewind flush the PAL thread has not got to */
+    pa_atomic_store(&pal_sdata->flush_pending, 0);
+    if (pal_sdata->stream_handle &&
+            !(rc = pal_stream_pause(pal_sdata->stream_handle)) &&
+            (rc = pal_stream_flush(pal_sdata->stream_handle)))
+        pal_stream_resume(pal_sdata->stream_handle);
+    pa_pal_lock_release(pal_sdata->lock);
+    pa_mutex_unlock(pal_sdata->write_mutex);
+
+    if (rc) {
+        pa_log_info("%s: could not pause session, error %d, closing it", __func__, rc);
+        return rc;
+    }
+
+    pal_sdata->standby = true;
+    pal_sdata->standby_deadline = pa_rtclock_now() + pal_sdata->standby_hold_us;
+    pa_atomic_store(&pal_sdata->warm, 1);
+
+    pa_log_debug("%s: session kept for %" PRIu64 " us", __func__, pal_sdata->standby_hold_us);
+
+    return 0;
+}
+
+static int pa_pal_sink_resume_warm(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    uint64_t rendered;
+    int rc = -1;
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    if (pal_sdata->stream_handle && !(rc = pal_stream_resume(pal_sdata->stream_handle))) {
+        /* the flush may or may not have reset the session clock */
+        if (pa_pal_sink_get_bytes_rendered(sdata, &rendered))
+            rendered = 0;
+        pa_pal_sink_set_bytes_written(pal_sdata, rendered);
+        pa_pal_clock_dll_reset(&pal_sdata->latency_dll);
+    }
+    pa_pal_lock_release(pal_sdata->lock);
+
+    if (rc) {
+        pa_log_error("%s: pal_stream_resume failed, error %d", __func__, rc);
+        return rc;
+    }
+
+    pa_atomic_store(&pal_sdata->close_output, 0);
+    pa_atomic_store(&pal_sdata->restart_in_progress, 0);
+    pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_WARM_STARTS);
+
+    pa_log_debug("%s: resumed warm session", __func__);
+
+    return 0;
+}
+
+/* sink I/O thread, close a warm session once its hold time expired */
+static void pa_pal_sink_standby_expire(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+
+    if (!pa_atomic_load(&pal_sdata->warm))
+        return;
+
+    if (pa_rtclock_now() < pal_sdata->standby_deadline) {
+        pa_rtpoll_set_timer_absolute(sdata->pa_sdata->rtpoll, pal_sdata->standby_deadline);
+        return;
+    }
+
+    if (pa_atomic_cmpxchg(&pal_sdata->warm, 1, 0) && close_pal_sink(sdata))
+        pa_log_error("could not close sink handle after standby hold");
+}
+
+static bool pa_pal_sink_adapt_pending(pal_sink_data *pal_sdata) {
+    return pal_sdata->adaptive && pal_sdata->adapt.target_ms != pal_sdata->adapt.cur_ms;
+}
+
+/* Sink I/O thread while running. Grows the buffer size by half after a window
+ * with underruns or late writes, shrinks it by a quarter after enough clean
+ * windows. A grow right after a shrink doubles the clean windows needed for
+ * the next shrink, so a size at the edge of what the system sustains is not
+ * retried every few seconds. The new size is only set as target, the session
+ * is reopened with it at the next safe point, see pa_pal_sink_adapt_apply. */
+static void pa_pal_sink_adapt_update(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_pal_sink_adapt *adapt = &pal_sdata->adapt;
+    pa_usec_t now = pa_rtclock_now();
+    uint64_t errors;
+
+    errors = pa_pal_stats_get(&pal_sdata->stats, PA_PAL_STATS_UNDERRUNS) +
+             pa_pal_stats_get(&pal_sdata->stats, PA_PAL_STATS_LATE_WRITES);
+
+    if (!adapt->window_end) {
+        adapt->window_end = now + PA_PAL_SINK_ADAPT_WINDOW_USEC;
+        adapt->errors = errors;
+        return;
+    }
+
+    if (now < adapt->window_end)
+        return;
+
+    adapt->window_end = now + PA_PAL_SINK_ADAPT_WINDOW_USEC;
+
+    /* no decision until the last one took effect */
+    if (pa_pal_sink_adapt_pending(pal_sdata))
+        goto exit;
+
+    if (adapt->since_shrink < PA_PAL_SINK_ADAPT_MAX_SHRINK_WINDOWS)
+        adapt->since_shrink++;
+
+    if (errors > adapt->errors) {
+        adapt->clean_windows = 0;
+        if (adapt->cur_ms < adapt->max_ms) {
+            if (adapt->since_shrink <= 2)
+                adapt->shrink_windows = PA_MIN(adapt->shrink_windows * 2, PA_PAL_SINK_ADAPT_MAX_SHRINK_WINDOWS);
+            adapt->target_ms = PA_MIN(PA_MAX(adapt->cur_ms * 3 / 2, adapt->cur_ms + 1), adapt->max_ms);
+            pa_log_info("%" PRIu64 " underruns or late writes, growing buffer from %u to %u ms",
+                        errors - adapt->errors, adapt->cur_ms, adapt->target_ms);
+        }
+    } else if (++adapt->clean_windows >= adapt->shrink_windows && adapt->cur_ms > adapt->min_ms) {
+        adapt->clean_windows = 0;
+        adapt->since_shrink = 0;
+        adapt->target_ms = PA_MAX(adapt->cur_ms * 3 / 4, adapt->min_ms);
+        pa_log_info("no underruns for %u windows, shrinking buffer from %u to %u ms",
+                    adapt->shrink_windows, adapt->cur_ms, adapt->target_ms);
+    }
+
+exit:
+    adapt->errors = errors;
+}
+
+/* Sink I/O thread with the session closed, nothing is queued in the DSP so
+ * the controller's target size can be taken over for the next open. */
+static void pa_pal_sink_adapt_apply(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *s = sdata->pa_sdata->sink;
+    size_t buffer_size;
+
+    if (!pa_pal_sink_adapt_pending(pal_sdata) || pal_sdata->compressed)
+        return;
+
+    buffer_size = pa_usec_to_bytes((pa_usec_t)pal_sdata->adapt.target_ms * PA_USEC_PER_MSEC, &s->sample_spec);
+    pa_log_info("buffer size %zu -> %zu bytes (%u ms)", pal_sdata->buffer_size, buffer_size, pal_sdata->adapt.target_ms);
+
+    pal_sdata->buffer_size = buffer_size;
+    pal_sdata->adapt.cur_ms = pal_sdata->adapt.target_ms;
+    pa_pal_sink_update_buffering(pal_sdata, &s->sample_spec);
+
+    pa_sink_set_max_request_within_thread(s, pal_sdata->buffer_size);
+    pa_sink_set_max_rewind_within_thread(s, pa_pal_sink_get_max_rewind(pal_sdata));
+    pa_sink_set_fixed_latency_within_thread(s, pal_sdata->sink_latency_us);
+    pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_BUFFER_RESIZES);
+}
+
 static int pa_pal_sink_start(pa_pal_sink_data *sdata) {
     int rc = 0;
     pa_assert(sdata);
@@ -389,7 +796,23 @@ static int pa_pal_sink_start(pa_pal_sink_data *sdata) {
     pa_log_debug("%s %d", __func__, pal_sdata->standby);
 
     if (pal_sdata->standby) {
+        __atomic_store_n(&pal_sdata->start_time, pa_rtclock_now(), __ATOMIC_RELEASE);
+
+        /* idle time says nothing about the data path, start a fresh window */
+        pal_sdata->adapt.window_end = 0;
+
+        if (pa_atomic_cmpxchg(&pal_sdata->warm, 1, 0)) {
+            if (pa_pal_sink_resume_warm(sdata) == 0) {
+                pal_sdata->standby = false;
+                return 0;
+            }
+            /* fall back to a fresh session */
+            if ((rc = close_pal_sink(sdata)))
+                goto cleanup;
+        }
+
         if (!sdata->pal_sink_opened) {
+            pa_pal_sink_adapt_apply(sdata);
             rc = open_pal_sink(sdata);
             if (rc) {
                 pa_log_error("pal sink open failed, error %d", rc);
@@ -410,6 +833,15 @@ static int pa_pal_sink_start(pa_pal_sink_data *sdata) {
             pa_log_error("pal_stream_start failed, error %d\n", rc);
             goto cleanup;
         }
+
+        if (pal_sdata->mmap) {
+            /* the buffer was silenced at open, the first fill starts at the read position */
+            pal_sdata->mmap_read = 0;
+            pal_sdata->mmap_written = 0;
+            pal_sdata->mmap_position = 0;
+            if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_read, true))
+                pa_log_debug("no mmap position yet, counting from zero");
+        }
         pa_atomic_store(&sdata->pal_sdata->restart_in_progress, 0);
     } else {
         pa_log_debug("pal_stream already started");
@@ -425,14 +857,21 @@ cleanup:
     return rc;
 }
 
-static int pa_pal_sink_standby(pa_pal_sink_data *sdata) {
+static int pa_pal_sink_standby(pa_pal_sink_data *sdata, bool hold) {
     int rc = 0;
 
     pa_assert(sdata);
 
     pa_log_debug("%s",__func__);
 
+    /* a pending buffer size change needs a fresh session anyway */
+    if (hold && sdata->pal_sink_opened && !pa_atomic_load(&sdata->pal_sdata->warm) &&
+            sdata->pal_sdata->standby_hold_us && !pa_pal_sink_adapt_pending(sdata->pal_sdata) &&
+            pa_pal_sink_standby_warm(sdata) == 0)
+        return 0;
+
     if (sdata->pal_sink_opened) {
+        pa_atomic_store(&sdata->pal_sdata->warm, 0);
         pa_assert(sdata->pal_sdata);
         rc = close_pal_sink(sdata);
         if (PA_UNLIKELY(rc))
@@ -444,13 +883,13 @@ static int pa_pal_sink_standby(pa_pal_sink_data *sdata) {
     return 0;
 }
 
-static int pa_pal_set_device(pal_stream_handle_t *stream_handle,
-                          pa_pal_card_port_device_data *param_device_connection) {
+static int pa_pal_set_device(pal_stream_handle_t *stream_handle, pal_device_id_t device) {
     struct pal_device device_connect;
     int no_of_devices = 1;
     int ret = 0;
 
-    device_connect.id = param_device_connection->device;
+    memset(&device_connect, 0, sizeof(device_connect));
+    device_connect.id = device;
 
     ret = pal_stream_set_device(stream_handle, no_of_devices, &device_connect);
     if(ret)
@@ -458,6 +897,49 @@ static int pa_pal_set_device(pal_stream_handle_t *stream_handle,
     return ret;
 }
 
+/* Control worker: fade the sink out, reroute the stream, fade back in. The
+ * fade is applied by the PAL thread in pa_pal_sink_switch_shape, which keeps
+ * writing silence to the old device until the switch is done. */
+static void pa_pal_sink_switch_device(void *userdata) {
+    pa_pal_sink_data *sdata = userdata;
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *sink = sdata->pa_sdata->sink;
+    pa_usec_t timeout, waited = 0, start;
+    bool fade;
+    int rc = 0;
+
+    /* only a running PCM session has a PAL thread to step the fade. Open and
+     * standby change under the lock on the I/O thread, as does the device */
+    pa_pal_lock_acquire(pal_sdata->lock);
+    fade = !pal_sdata->compressed && sdata->pal_sink_opened && !pal_sdata->standby;
+    pa_pal_lock_release(pal_sdata->lock);
+
+    if (fade) {
+        /* the ramp is one buffer long, allow for a full ring ahead of it */
+        timeout = pa_bytes_to_usec(pal_sdata->buffer_size, &sink->sample_spec) * (PAL_SINK_RING_MAX_DEPTH + 1);
+        pa_atomic_store(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_OUT);
+        while (pa_atomic_load(&pal_sdata->switch_state) == PA_PAL_SWITCH_FADE_OUT && waited < timeout) {
+            pa_msleep(PA_PAL_SINK_SWITCH_POLL_MS);
+            waited += PA_PAL_SINK_SWITCH_POLL_MS * PA_USEC_PER_MSEC;
+        }
+    }
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    if (pal_sdata->stream_handle) {
+        start = pa_rtclock_now();
+        rc = pa_pal_set_device(pal_sdata->stream_handle, pal_sdata->pal_device->id);
+        pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_SWITCH_US, pa_rtclock_now() - start);
+    }
+    pa_pal_lock_release(pal_sdata->lock);
+
+    pa_atomic_store(&pal_sdata->switch_state, fade ? PA_PAL_SWITCH_FADE_IN : PA_PAL_SWITCH_IDLE);
+
+    if (rc)
+        pa_log_error("pal sink switch device failed %d", rc);
+    else
+        pa_log_debug("pal sink switched device after %" PRIu64 " us fade wait", waited);
+}
+
 static int pa_pal_sink_set_port_cb(pa_sink *s, pa_device_port *p) {
     pa_pal_card_port_device_data *port_device_data;
     pa_pal_card_port_device_data *active_port_device_data;
@@ -510,6 +992,8 @@ static int pa_pal_sink_set_port_cb(pa_sink *s, pa_device_port *p) {
     }
 
     param_device_connection.id = port_device_data->device;
+    /* a switch queued on the control worker reads the device under the lock */
+    pa_pal_lock_acquire(sdata->pal_sdata->lock);
     sdata->pal_sdata->pal_device->id = port_device_data->device;
     if (port_device_data->pal_devicepp_config){
         pa_strlcpy(sdata->pal_sdata->pal_device->custom_config.custom_key, port_device_data->pal_devicepp_config,
@@ -519,17 +1003,17 @@ static int pa_pal_sink_set_port_cb(pa_sink *s, pa_device_port *p) {
         pa_strlcpy(sdata->pal_sdata->pal_device->custom_config.custom_key, "",
                         sizeof(sdata->pal_sdata->pal_device->custom_config.custom_key));
     }
+    pa_pal_lock_release(sdata->pal_sdata->lock);
 
-    if (PA_SINK_IS_OPENED(s->state)) {
-        sdata->pal_sdata->sink_event_id = PA_PAL_DEVICE_SWITCH;
-        pa_mutex_lock(sdata->pal_sdata->mutex);
-        ret = pa_pal_set_device(sdata->pal_sdata->stream_handle, (pa_pal_card_port_device_data *)&param_device_connection);
-        sdata->pal_sdata->sink_event_id = PA_PAL_NO_EVENT;
-        pa_mutex_unlock(sdata->pal_sdata->mutex);
-        pa_cond_signal(sdata->pal_sdata->cond_ctrl_thread, 0);
+    /* parked sessions are routed to the old device */
+    pa_pal_stream_cache_clear(sdata->pal_sdata->stream_cache);
 
-        if (ret != 0)
-            pa_log_error("pal sink switch device failed %d", ret);
+    /* the render loop keeps running, the worker fades around the switch */
+    if (PA_SINK_IS_OPENED(s->state) &&
+            !pa_pal_worker_post(sdata->pal_sdata->ctrl_worker, &sdata->pal_sdata->switch_state,
+                                pa_pal_sink_switch_device, sdata)) {
+        pa_log_info("pal sink has no control worker, switching device synchronously");
+        pa_pal_sink_switch_device(sdata);
     }
 
     return ret;
@@ -553,10 +1037,14 @@ static int pa_pal_sink_set_state_in_io_thread_cb(pa_sink *s, pa_sink_state_t new
         /* do nothing */
         r = 0;
     }
-    else if (PA_SINK_IS_OPENED(new_state))
+    else if (PA_SINK_IS_OPENED(new_state)) {
+        /* the last input left, reopen with the adapted buffer size before the next one arrives */
+        if (new_state == PA_SINK_IDLE && s->thread_info.state == PA_SINK_RUNNING && sdata->pal_sink_opened &&
+                pa_pal_sink_adapt_pending(sdata->pal_sdata) && close_pal_sink(sdata))
+            pa_log_error("could not close sink handle %p for buffer resize", sdata->pal_sdata->stream_handle);
         r = pa_pal_sink_start(sdata);
-    else if (new_state == PA_SINK_SUSPENDED || (new_state == PA_SINK_UNLINKED && sdata->pal_sink_opened))
-        r = pa_pal_sink_standby(sdata);
+    } else if (new_state == PA_SINK_SUSPENDED || (new_state == PA_SINK_UNLINKED && sdata->pal_sink_opened))
+        r = pa_pal_sink_standby(sdata, new_state == PA_SINK_SUSPENDED);
 
     return r;
 }
@@ -649,8 +1137,8 @@ static void pa_pal_sink_reconfigure_cb(pa_sink *s, pa_sample_spec *spec, bool pa
             tmp_spec.channels = pa_sdata->sink->sample_spec.channels;
         }
 
-        /* find nearest suitable format */
-        if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH)
+        /* find nearest suitable format, a converting sink always packs its own */
+        if (!pal_sdata->convert && (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH))
             tmp_spec.format = pa_pal_sink_find_nearest_supported_pa_format(spec->format);
         else
             tmp_spec.format = pa_sdata->sink->sample_spec.format;
@@ -664,6 +1152,12 @@ static void pa_pal_sink_reconfigure_cb(pa_sink *s, pa_sample_spec *spec, bool pa
         if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_ALL)
             pal_sdata->buffer_size = sink_get_buffer_size(tmp_spec, stream_type);
 
+        /* keep the adapted buffer duration across format changes */
+        if (pal_sdata->adaptive) {
+            pal_sdata->buffer_size = pa_usec_to_bytes((pa_usec_t)pal_sdata->adapt.target_ms * PA_USEC_PER_MSEC, &tmp_spec);
+            pal_sdata->adapt.cur_ms = pal_sdata->adapt.target_ms;
+        }
+
         port_device_data = PA_DEVICE_PORT_DATA(pa_sdata->sink->active_port);
         pa_cvolume_set(&s->reference_volume, s->reference_volume.channels, volume);
         rc = restart_pal_sink(s, PA_ENCODING_PCM, &tmp_spec, &new_map, port_device_data,
@@ -677,8 +1171,9 @@ static void pa_pal_sink_reconfigure_cb(pa_sink *s, pa_sample_spec *spec, bool pa
 
         pa_sdata->sink->sample_spec = tmp_spec;
         pa_sdata->sink->channel_map = new_map;
+        pa_pal_sink_update_buffering(pal_sdata, &tmp_spec);
         pa_sink_set_max_request(pa_sdata->sink, pal_sdata->buffer_size);
-        pa_sink_set_max_rewind(pa_sdata->sink, 0);
+        pa_sink_set_max_rewind(pa_sdata->sink, pa_pal_sink_get_max_rewind(pal_sdata));
         pa_sink_set_fixed_latency(pa_sdata->sink, pal_sdata->sink_latency_us);
     }
 
@@ -699,6 +1194,46 @@ static pa_idxset* pa_pal_sink_get_formats(pa_sink *s) {
 }
 
 #ifndef PAL_DISABLE_COMPRESS_AUDIO_SUPPORT
+/* Gapless offload: a new track in the format the open compressed session was
+ * configured with only brings its own encoder delay and padding. Queue them
+ * for the PAL thread, which applies them once it reaches the first buffer of
+ * the new track, instead of closing and reopening the session. */
+static bool pa_pal_sink_gapless_queue_track(pa_pal_sink_data *sdata, const pa_format_info *format, pa_encoding_t encoding,
+                                            pa_sample_spec *ss) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    struct pal_stream_attributes *attr = pal_sdata->stream_attributes;
+    pal_snd_dec_t snd_dec;
+    int delay = 0, padding = 0;
+
+    if (!pal_sdata->gapless || !pal_sdata->compressed || !sdata->pal_sink_opened || !pal_sdata->stream_handle)
+        return false;
+
+    memset(&snd_dec, 0, sizeof(snd_dec));
+    if (encoding != pal_sdata->encoding ||
+            pa_pal_util_get_pal_format_from_pa_encoding(encoding, &snd_dec) != attr->out_media_config.aud_fmt_id ||
+            ss->rate != attr->out_media_config.sample_rate ||
+            ss->channels != attr->out_media_config.ch_info.channels) {
+        pa_log_info("%s: next track needs a new session", __func__);
+        return false;
+    }
+
+    /* optional, left at 0 when the player does not know them */
+    pa_format_info_get_prop_int(format, PA_PAL_SINK_PROP_ENCODER_DELAY, &delay);
+    pa_format_info_get_prop_int(format, PA_PAL_SINK_PROP_ENCODER_PADDING, &padding);
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    pal_sdata->next_gapless_mdata.encoderDelay = (uint32_t)PA_MAX(delay, 0);
+    pal_sdata->next_gapless_mdata.encoderPadding = (uint32_t)PA_MAX(padding, 0);
+    pa_pal_lock_release(pal_sdata->lock);
+
+    /* buffers rendered from now on belong to the next track */
+    pa_atomic_inc(&pal_sdata->track);
+
+    pa_log_debug("%s: encoder delay %d padding %d", __func__, delay, padding);
+
+    return true;
+}
+
 static bool pa_pal_sink_set_format_cb(pa_sink *s, const pa_format_info *format) {
     pal_sink_data *pal_sdata;
     pa_sink_data *pa_sdata;
@@ -759,6 +1294,12 @@ static bool pa_pal_sink_set_format_cb(pa_sink *s, const pa_format_info *format)
               pa_sample_spec_snprint(ss_buf, sizeof(ss_buf), &ss),
               pa_channel_map_snprint(ch_map_buf, sizeof(ch_map_buf), &map));
 
+       if (pa_pal_sink_gapless_queue_track(sdata, format, encoding, &ss)) {
+           pa_log_info("%s: continuing pal_sink gapless with next track", __func__);
+           ret = true;
+           goto exit;
+       }
+
        port_device_data = PA_DEVICE_PORT_DATA(pa_sdata->sink->active_port);
 
        if (restart_pal_sink(s, encoding, &pa_sdata->sink->sample_spec, &map, port_device_data,
@@ -770,6 +1311,10 @@ static bool pa_pal_sink_set_format_cb(pa_sink *s, const pa_format_info *format)
            pa_log_info("%s: Started pal_sink with %s encoding", __func__, format == NULL ? "default" : "requested");
            ret = true;
        }
+   } else if (pal_sdata->gapless && sdata->pal_sink_opened) {
+       /* the partially drained track plays out, the next one may continue the session */
+       pa_log_debug("%s: keeping compress session open for the next track", __func__);
+       ret = true;
    } else {
        if (sdata->pal_sdata->stream_handle != NULL) {
            pa_atomic_store(&sdata->pal_sdata->close_output, 1);
@@ -803,7 +1348,12 @@ static int pa_pal_sink_drain_cb(pa_sink *s) {
 
     pa_log_info("Func:%s", __func__);
 
-    return pal_stream_drain(sdata->pal_sdata->stream_handle, PAL_DRAIN_PARTIAL);
+    /* buffers still queued in the ring must reach PAL first, the PAL thread
+     * issues the drain once it has written them out */
+    pa_atomic_store(&sdata->pal_sdata->drain_pending, 1);
+    pa_fdsem_post(sdata->pal_sdata->pal_fdsem);
+
+    return rc;
 }
 
 static int pa_pal_sink_flush_cb(pa_sink *s) {
@@ -819,98 +1369,257 @@ static int pa_pal_sink_flush_cb(pa_sink *s) {
 
     pa_log_info("Func:%s", __func__);
 
+    pa_mutex_lock(sdata->pal_sdata->write_mutex);
+    pa_pal_lock_acquire(sdata->pal_sdata->lock);
+
+    /* PAL thread drops the buffers still queued in the ring */
+    pa_atomic_inc(&sdata->pal_sdata->rewind_seq);
+    pa_atomic_store(&sdata->pal_sdata->drain_pending, 0);
+
     /* stream should be in paused state during flush */
     pal_stream_pause(sdata->pal_sdata->stream_handle);
+    rc = pal_stream_flush(sdata->pal_sdata->stream_handle);
+
+    pa_pal_lock_release(sdata->pal_sdata->lock);
+    pa_mutex_unlock(sdata->pal_sdata->write_mutex);
 
-    return pal_stream_flush(sdata->pal_sdata->stream_handle);
+    /* wake the PAL thread in case it waits for a WRITE_READY that will not come */
+    pa_fdsem_post(sdata->pal_sdata->pal_fdsem);
+
+    return rc;
 }
 #endif
 
-static void write_chunk(pa_pal_sink_data *sdata, pa_memchunk *chunk) {
+/* PAL thread: step the device switch fade over this chunk. Rendered blocks
+ * may be shared with sink inputs, the faded audio goes to a private copy. */
+static void *pa_pal_sink_switch_shape(pa_pal_sink_data *sdata, void *data, size_t length) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sample_spec *ss = &sdata->pa_sdata->sink->sample_spec;
+    int state = pa_atomic_load(&pal_sdata->switch_state);
+
+    if (PA_LIKELY(state == PA_PAL_SWITCH_IDLE))
+        return data;
+
+    if (pal_sdata->switch_buf_size < length) {
+        pal_sdata->switch_buf = pa_xrealloc(pal_sdata->switch_buf, length);
+        pal_sdata->switch_buf_size = length;
+    }
+
+    switch (state) {
+        case PA_PAL_SWITCH_FADE_OUT:
+            if (!pa_pal_util_ramp(pal_sdata->switch_buf, data, length, ss, false))
+                pa_silence_memory(pal_sdata->switch_buf, length, ss);
+            pa_atomic_cmpxchg(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_OUT, PA_PAL_SWITCH_MUTED);
+            break;
+        case PA_PAL_SWITCH_MUTED:
+            pa_silence_memory(pal_sdata->switch_buf, length, ss);
+            break;
+        case PA_PAL_SWITCH_FADE_IN:
+            if (!pa_pal_util_ramp(pal_sdata->switch_buf, data, length, ss, true))
+                memcpy(pal_sdata->switch_buf, data, length);
+            pa_atomic_cmpxchg(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_IN, PA_PAL_SWITCH_IDLE);
+            break;
+        default:
+            return data;
+    }
+
+    return pal_sdata->switch_buf;
+}
+
+/* rendered bytes to what PAL is handed, and back */
+static size_t pa_pal_sink_pal_bytes(pal_sink_data *pal_sdata, size_t bytes) {
+    if (!pal_sdata->convert || pal_sdata->compressed)
+        return bytes;
+
+    return bytes / PA_PAL_PCM_CONVERT_HOST_BYTES * PA_PAL_PCM_CONVERT_PACKED_BYTES;
+}
+
+static size_t pa_pal_sink_host_bytes(pal_sink_data *pal_sdata, size_t bytes) {
+    if (!pal_sdata->convert || pal_sdata->compressed)
+        return bytes;
+
+    return bytes / PA_PAL_PCM_CONVERT_PACKED_BYTES * PA_PAL_PCM_CONVERT_HOST_BYTES;
+}
+
+/* PAL thread: pack a chunk to 24 bit, returns data if there is nothing to convert */
+static void *pa_pal_sink_convert(pal_sink_data *pal_sdata, void *data, size_t length) {
+    size_t size;
+
+    if (!pal_sdata->convert || pal_sdata->compressed)
+        return data;
+
+    size = pa_pal_sink_pal_bytes(pal_sdata, length);
+    if (pal_sdata->convert_buf_size < size) {
+        pal_sdata->convert_buf = pa_xrealloc(pal_sdata->convert_buf, size);
+        pal_sdata->convert_buf_size = size;
+    }
+
+    pal_sdata->convert(pal_sdata->convert_buf, data, length / PA_PAL_PCM_CONVERT_HOST_BYTES);
+
+    return pal_sdata->convert_buf;
+}
+
+/* PAL thread, write_mutex held: flush what a rewind took back before
+ * anything rendered after it is written */
+static void pa_pal_sink_flush_rewound(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    uint64_t session_time_stamp = 0, cur_session_time = 0;
+    int rc, resume_rc;
+
+    if (!pa_atomic_cmpxchg(&pal_sdata->flush_pending, 1, 0))
+        return;
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+
+    if (!pal_sdata->stream_handle)
+        goto exit;
+
+    if (!(rc = pal_stream_pause(pal_sdata->stream_handle))) {
+        rc = pal_stream_flush(pal_sdata->stream_handle);
+        if ((resume_rc = pal_stream_resume(pal_sdata->stream_handle)) && !rc)
+            rc = resume_rc;
+    }
+    if (rc)
+        pa_log_error("%s: flush failed, error %d, rewound data may play twice", __func__, rc);
+
+    /* the DSP may or may not keep its session clock across a flush, rebase on whatever it reports now */
+    if (pa_pal_util_get_session_time(pal_sdata->stream_handle, &session_time_stamp, &cur_session_time))
+        cur_session_time = 0;
+    pa_pal_sink_set_bytes_written(pal_sdata, pa_usec_to_bytes(cur_session_time, &sdata->pa_sdata->sink->sample_spec));
+    pa_atomic_store(&pal_sdata->dll_reset, 1);
+
+exit:
+    pa_pal_lock_release(pal_sdata->lock);
+}
+
+/* seq is the rewind sequence a ring chunk was rendered in, -1 to write unconditionally */
+static void write_chunk(pa_pal_sink_data *sdata, pa_memchunk *chunk, int seq) {
     int rc = 0;
     void *data = NULL;
+    char *host;
     struct pal_buffer out_buf;
-    pa_sink_data *pa_sdata =  sdata->pa_sdata;
     pal_sink_data *pal_sdata = sdata->pal_sdata;
-    size_t sink_buffer_size = pal_sdata->buffer_size;
+    pal_stream_handle_t *handle;
+    size_t remaining, host_rc;
+    pa_usec_t start;
 
     memset(&out_buf, 0, sizeof(struct pal_buffer));
     data = pa_memblock_acquire(chunk->memblock);
-    out_buf.buffer = (char*)data + chunk->index;
-    out_buf.size = chunk->length;
-    sink_buffer_size = chunk->length;
-
-    while(out_buf.buffer && !pa_atomic_load(&sdata->pal_sdata->close_output)) {
-        pa_mutex_lock(pal_sdata->mutex);
-        if (pal_sdata->sink_event_id != PA_PAL_NO_EVENT) {
-            /* wait for response from ctrl thread */
-            pa_cond_wait(pal_sdata->cond_ctrl_thread, pal_sdata->mutex);
-        }
-        if (pal_sdata->stream_handle) {
-            if ((rc = pal_stream_write(pal_sdata->stream_handle, &out_buf)) < 0) {
-                pa_log_error("Could not write data: %d %d", rc, __LINE__);
-                break;
-            }
+    host = (char*)data + chunk->index;
+    if (!pal_sdata->compressed)
+        host = pa_pal_sink_switch_shape(sdata, host, chunk->length);
+    /* remaining and rc count what PAL is handed, everything else rendered bytes */
+    out_buf.buffer = pa_pal_sink_convert(pal_sdata, host, chunk->length);
+    remaining = pa_pal_sink_pal_bytes(pal_sdata, chunk->length);
+    /* PCM chunks queued in timer scheduling mode may span several PAL buffers */
+    out_buf.size = pal_sdata->compressed ? remaining :
+                   PA_MIN(remaining, pa_pal_sink_pal_bytes(pal_sdata, pal_sdata->buffer_size));
+
+    while (remaining && !pa_atomic_load(&sdata->pal_sdata->close_output)) {
+        /* write_mutex, not lock, is held across the write, so control calls
+         * and the sink I/O thread never wait for a blocking pal_stream_write */
+        pa_mutex_lock(pal_sdata->write_mutex);
+        pa_pal_sink_flush_rewound(sdata);
+        if (seq >= 0 && seq != pa_atomic_load(&pal_sdata->rewind_seq)) {
+            /* rewound after this chunk was rendered */
+            pa_mutex_unlock(pal_sdata->write_mutex);
+            break;
         }
-        else
+
+        /* the handle is only replaced under write_mutex or while close_output
+         * is set, so the writer never waits for lock behind a control call */
+        handle = pal_sdata->stream_handle;
+        /* a WRITE_READY from before this write says nothing about the room after it */
+        if (handle && pal_sdata->compressed)
+            pa_atomic_store(&pal_sdata->write_ready, 0);
+
+        host_rc = 0;
+        if (handle) {
+            start = pa_rtclock_now();
+            rc = pal_stream_write(handle, &out_buf);
+            pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_WRITE_US, pa_rtclock_now() - start);
+        } else {
             rc = -1;
-        pa_mutex_unlock(pal_sdata->mutex);
+        }
+
+        if (rc > 0) {
+            /* accounted before write_mutex is dropped so rewinds see a consistent queue */
+            host_rc = pa_pal_sink_host_bytes(pal_sdata, (size_t)rc);
+            pa_pal_sink_set_bytes_written(pal_sdata, pa_pal_sink_bytes_written(pal_sdata) + host_rc);
+            if (seq >= 0)
+                pa_atomic_sub(&pal_sdata->ring_bytes, (int)host_rc);
 
-        /* Update buffer attributes and bytes written */
-        if ((pal_sdata->compressed) && (rc >= 0) && (rc < (int)out_buf.size)) {
+            if ((start = __atomic_exchange_n(&pal_sdata->start_time, 0, __ATOMIC_ACQ_REL)))
+                pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_START_US, pa_rtclock_now() - start);
+            pa_pal_dump_slot_write(&pal_sdata->dump, host, host_rc);
+        }
+        pa_mutex_unlock(pal_sdata->write_mutex);
+
+        if (rc < 0 || (rc == 0 && !pal_sdata->compressed)) {
+            pa_log_error("Could not write data: %d %d", rc, __LINE__);
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_WRITE_ERRORS);
+            break;
+        }
+
+        pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_WRITES);
+
+        if ((pal_sdata->compressed) && (rc < (int)out_buf.size)) {
 #ifdef SINK_DEBUG
             pa_log_debug("[%d]Func:%s Waiting for write done event, size %d written %d",
                     __LINE__, __func__, (int)out_buf.size, rc);
 #endif
-            pa_fdsem_wait(pal_sdata->pal_fdsem);
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_PARTIAL_WRITES);
+            start = pa_rtclock_now();
+            /* ring pushes post pal_fdsem as well, only WRITE_READY means PAL has room */
+            while (!pa_atomic_cmpxchg(&pal_sdata->write_ready, 1, 0) &&
+                    !pa_atomic_load(&pal_sdata->close_output) &&
+                    (seq < 0 || seq == pa_atomic_load(&pal_sdata->rewind_seq)))
+                pa_fdsem_wait(pal_sdata->pal_fdsem);
+            pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_WAIT_US, pa_rtclock_now() - start);
 #ifdef SINK_DEBUG
             pa_log_debug("[%d]Func:%s Async wake", __LINE__, __func__);
 #endif
-            /* Store pending bytes to be written, write done event comes */
-            out_buf.size = out_buf.size - rc;
-            /* Update buffer offset and size based on last write size */
-            out_buf.buffer = (char *)out_buf.buffer + sink_buffer_size - out_buf.size;
-        } else {
-            pal_sdata->bytes_written += rc;
+        }
+
 #ifdef SINK_DEBUG
-            pa_log_debug("[%d]Func:%s Write data: size %d total %d", __LINE__, __func__,
-                    rc, pal_sdata->bytes_written);
-#endif
-#ifdef SINK_DUMP_ENABLED
-            if ((rc = write(pal_sdata->write_fd, out_buf.buffer, out_buf.size)) < 0)
-                pa_log_error("write to fd failed %d", rc);
+        pa_log_debug("[%d]Func:%s Write data: size %d total %" PRIu64, __LINE__, __func__,
+                rc, pa_pal_sink_bytes_written(pal_sdata));
 #endif
-            /* Mark buffer as NULL, to indicate buffer has been consumed */
-            out_buf.size = out_buf.size - rc;
-            out_buf.buffer = NULL;
-        }
+        /* Update buffer offset and size based on last write size */
+        remaining -= rc;
+        out_buf.buffer = (char *)out_buf.buffer + rc;
+        host += host_rc;
+        out_buf.size = pal_sdata->compressed ? remaining :
+                       PA_MIN(remaining, pa_pal_sink_pal_bytes(pal_sdata, pal_sdata->buffer_size));
     }
 
+    /* whatever was not written is dropped */
+    if (seq >= 0 && remaining)
+        pa_atomic_sub(&pal_sdata->ring_bytes, (int)pa_pal_sink_host_bytes(pal_sdata, remaining));
+
     pa_memblock_release(chunk->memblock);
     pa_memblock_unref(chunk->memblock);
 }
 
-static int pal_sink_process_msg(pa_msgobject *o, int code, void *data, int64_t offset, pa_memchunk *chunk) {
-    int rc = -1;
-    pa_pal_sink_data *sdata = (pa_pal_sink_data *)(PAL_MSG_OBJ(o)->userdata);
+/* PAL thread, the first buffer of a gapless track is next: hand PAL the
+ * metadata of the new one. The previous track was partially drained once
+ * the ring ran empty, before the sink rendered anything of this one. */
+static void pa_pal_sink_gapless_next_track(pa_pal_sink_data *sdata, int track) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pal_param_payload *param_payload = pal_sdata->gapless_payload;
+    int rc;
 
-    pa_assert(sdata);
-    pa_assert(chunk);
+    pa_pal_lock_acquire(pal_sdata->lock);
 
-    switch (code) {
-        case PAL_SINK_MESSAGE_WRITE_READY:
-            write_chunk(sdata, chunk);
-            pa_atomic_store(&sdata->pal_sdata->write_done, 1);
-            rc = 0;
-            /* Wake up sink thread */
-            pa_fdsem_post(sdata->fdsem);
-            break;
-        default:
-            pa_log_info("%s: Unknown code", __func__);
-            break;
+    if (pal_sdata->stream_handle && param_payload) {
+        memcpy(param_payload->payload, &pal_sdata->next_gapless_mdata, sizeof(struct pal_compr_gapless_mdata));
+        if ((rc = pal_stream_set_param(pal_sdata->stream_handle, PAL_PARAM_ID_GAPLESS_MDATA, param_payload)))
+            pa_log_error("%s: setting gapless metadata failed, error %d", __func__, rc);
     }
 
-    return rc;
+    pal_sdata->written_track = track;
+
+    pa_pal_lock_release(pal_sdata->lock);
 }
 
 static void pal_sink_thread_func(void *userdata) {
@@ -918,25 +1627,62 @@ static void pal_sink_thread_func(void *userdata) {
     pa_sink_data *pa_sdata = sink_data->pa_sdata;
     pal_sink_data *pal_sdata = sink_data->pal_sdata;
 
-    if ((pa_sdata->sink->core->realtime_scheduling)) {
-        pa_log_info("%s:: Making io thread for %s as realtime with prio %d", __func__,
-                pa_pal_sink_get_name_from_type(pal_sdata->stream_attributes->type),
-                pa_sdata->sink->core->realtime_priority);
-        pa_thread_make_realtime(pa_sdata->sink->core->realtime_priority);
-    }
+    pa_pal_sched_apply(&pal_sdata->sched, pa_sdata->sink->core, pa_thread_get_name(pa_thread_self()));
 
     pa_log_debug("Sink Write Thread starting up");
 
     pa_thread_mq_install(&pal_sdata->pal_thread_mq);
 
     for (;;) {
+        pa_memchunk *chunk;
+        pa_usec_t wait_start;
         int ret = 0;
 
+        /* drain buffers queued by the sink I/O thread, waking it for every freed
+         * slot unless it paces itself from the DSP timestamps. A compressed
+         * write only completes once PAL has room, so the wakeup doubles as the
+         * refill on WRITE_READY. */
+        while ((chunk = pa_pal_sink_ring_peek(pal_sdata))) {
+            pa_usec_t lag;
+
+            if (pal_sdata->ring_track[pal_sdata->ring_read_index] != pal_sdata->written_track)
+                pa_pal_sink_gapless_next_track(sink_data, pal_sdata->ring_track[pal_sdata->ring_read_index]);
+
+            lag = pa_rtclock_now() - pal_sdata->ring_time[pal_sdata->ring_read_index];
+            pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_RENDER_LAG_US, lag);
+            /* waited longer than everything queued ahead of it could play */
+            if (!pal_sdata->compressed && sink_data->pal_sink_opened && lag > pal_sdata->late_write_us)
+                pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_LATE_WRITES);
+            write_chunk(sink_data, chunk, pal_sdata->ring_seq[pal_sdata->ring_read_index]);
+            pa_pal_sink_ring_pop(pal_sdata);
+            if (!pal_sdata->tsched || pal_sdata->compressed)
+                pa_fdsem_post(sink_data->fdsem);
+        }
+
+        /* a rewind that only took back what the DSP had queued */
+        if (pa_atomic_load(&pal_sdata->flush_pending)) {
+            pa_mutex_lock(pal_sdata->write_mutex);
+            pa_pal_sink_flush_rewound(sink_data);
+            pa_mutex_unlock(pal_sdata->write_mutex);
+        }
+
+        if (pa_atomic_cmpxchg(&pal_sdata->drain_pending, 1, 0)) {
+            pa_pal_lock_acquire(pal_sdata->lock);
+            if (pal_sdata->stream_handle && pal_stream_drain(pal_sdata->stream_handle, PAL_DRAIN_PARTIAL))
+                pa_log_error("pal_stream_drain failed");
+            pa_pal_lock_release(pal_sdata->lock);
+        }
+
         /* nothing to do. Let's sleep */
         pa_rtpoll_set_timer_disabled(pal_sdata->pal_thread_rtpoll);
+        wait_start = pa_rtclock_now();
         if ((ret = pa_rtpoll_run(pal_sdata->pal_thread_rtpoll)) < 0)
             goto fail;
 
+        /* idle time while the sink is suspended says nothing about the data path */
+        if (sink_data->pal_sink_opened && !pal_sdata->compressed)
+            pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_WAIT_US, pa_rtclock_now() - wait_start);
+
         if (ret == 0)
             goto finish;
     }
@@ -963,15 +1709,10 @@ static int create_pal_sink_thread(pa_pal_sink_data *sdata) {
     pa_assert(pa_sdata);
     pa_assert(pal_sdata);
 
-    pa_atomic_store(&pal_sdata->write_done, 1);
-
     pal_sdata->pal_thread_rtpoll = pa_rtpoll_new();
     pa_thread_mq_init(&pal_sdata->pal_thread_mq, pa_sdata->sink->core->mainloop,
             pal_sdata->pal_thread_rtpoll);
 
-    pal_sdata->pal_msg = pa_msgobject_new(pal_msg_obj);
-    pal_sdata->pal_msg->parent.process_msg = pal_sink_process_msg;
-    pal_sdata->pal_msg->userdata = (void *)sdata;
     pal_sdata->pal_fdsem = pa_fdsem_new();
     if (!pal_sdata->pal_fdsem) {
         pa_log_error("Could not create pal fdsem");
@@ -1004,15 +1745,115 @@ fail:
     return ret;
 }
 
+/* Timer scheduling: top the DSP queue up to buffer_size * buffer_count in one
+ * render, then sleep until the queued audio drains down to the watermark. */
+static void pa_pal_sink_tsched_fill(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *sink = sdata->pa_sdata->sink;
+    size_t capacity, queued, room;
+    pa_usec_t latency, sleep_usec, buffer_usec;
+
+    capacity = pal_sdata->buffer_size * PA_MAX(pal_sdata->buffer_count, (size_t)1);
+    buffer_usec = pa_bytes_to_usec(pal_sdata->buffer_size, &sink->sample_spec);
+
+    latency = pa_pal_sink_get_latency(sdata);
+    queued = pa_usec_to_bytes(latency, &sink->sample_spec);
+    room = (queued < capacity) ? capacity - queued : 0;
+    room -= room % pal_sdata->buffer_size;
+
+    if (room > 0 && pa_pal_sink_ring_push(sdata, room)) {
+        pa_fdsem_post(pal_sdata->pal_fdsem);
+        latency += pa_bytes_to_usec(room, &sink->sample_spec);
+    }
+
+    sleep_usec = (latency > pal_sdata->tsched_watermark_us) ? latency - pal_sdata->tsched_watermark_us : 0;
+    sleep_usec = PA_MAX(sleep_usec, buffer_usec / 2);
+
+#ifdef SINK_DEBUG
+    pa_log_debug("%s: latency %" PRIu64 " us, rendered %zu bytes, sleeping %" PRIu64 " us", __func__,
+                 latency, room, sleep_usec);
+#endif
+
+    pa_rtpoll_set_timer_relative(sdata->pa_sdata->rtpoll, sleep_usec);
+}
+
+/* render length bytes straight into the MMAP buffer at dst */
+static void pa_pal_sink_mmap_render(pa_pal_sink_data *sdata, void *dst, size_t length) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *sink = sdata->pa_sdata->sink;
+    pa_memchunk chunk;
+    void *shaped;
+
+    chunk.memblock = pa_memblock_new_fixed(sink->core->mempool, dst, length, false);
+    chunk.index = 0;
+    chunk.length = length;
+    pa_sink_render_into_full(sink, &chunk);
+    pa_memblock_unref_fixed(chunk.memblock);
+
+    /* no PAL thread in between, device switch fades are applied here */
+    if ((shaped = pa_pal_sink_switch_shape(sdata, dst, length)) != dst)
+        memcpy(dst, shaped, length);
+
+    pa_pal_dump_slot_write(&pal_sdata->dump, dst, length);
+}
+
+/* Ultra low latency: keep buffer_size, at least two bursts, rendered ahead
+ * of the DSP read position and wake up when one burst is left. The DSP keeps
+ * looping over the buffer, after an underrun it plays stale frames until the
+ * writer catches up behind its read position. */
+static void pa_pal_sink_mmap_fill(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    pa_sink *sink = sdata->pa_sdata->sink;
+    struct pal_mmap_buffer *mmap_buffer = &pal_sdata->mmap_buffer;
+    size_t frame_size = pa_frame_size(&sink->sample_spec);
+    uint64_t size, burst, target, queued, offset, frames;
+    pa_usec_t sleep_usec;
+
+    size = mmap_buffer->buffer_size_frames;
+    burst = PA_MAX(mmap_buffer->burst_size_frames, 1U);
+    target = PA_MIN(size, PA_MAX(pal_sdata->buffer_size / frame_size, 2 * burst));
+
+    if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_read, false)) {
+        pa_log_debug("%s: mmap position unavailable", __func__);
+        goto sleep;
+    }
+
+    if (pal_sdata->mmap_read > pal_sdata->mmap_written) {
+        if (!pal_sdata->underrun)
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_UNDERRUNS);
+        pal_sdata->underrun = true;
+        pal_sdata->mmap_written = pal_sdata->mmap_read;
+    } else if (pal_sdata->mmap_read < pal_sdata->mmap_written) {
+        pal_sdata->underrun = false;
+    }
+
+    queued = pal_sdata->mmap_written - pal_sdata->mmap_read;
+    while (queued < target) {
+        offset = pal_sdata->mmap_written % size;
+        frames = PA_MIN(target - queued, size - offset);
+        pa_pal_sink_mmap_render(sdata, (uint8_t *)mmap_buffer->buffer + offset * frame_size, frames * frame_size);
+        pal_sdata->mmap_written += frames;
+        queued += frames;
+    }
+
+sleep:
+    sleep_usec = pa_bytes_to_usec((target > burst ? target - burst : burst / 2) * frame_size, &sink->sample_spec);
+
+#ifdef SINK_DEBUG
+    pa_log_debug("%s: read %" PRIu64 " written %" PRIu64 " frames, sleeping %" PRIu64 " us", __func__,
+                 pal_sdata->mmap_read, pal_sdata->mmap_written, sleep_usec);
+#endif
+
+    pa_rtpoll_set_timer_relative(sdata->pa_sdata->rtpoll, sleep_usec);
+}
+
 static void pa_pal_sink_thread_func(void *userdata) {
     pa_pal_sink_data *sdata;
     pa_sink_data *pa_sdata;
     pal_sink_data *pal_sdata;
     uint32_t sink_buffer_size;
     bool render = false;
-    pa_memchunk chunk;
     struct pal_buffer out_buf;
-    memset(&chunk, 0, sizeof(pa_memchunk));
 
     void *data;
     int rc;
@@ -1026,12 +1867,7 @@ static void pa_pal_sink_thread_func(void *userdata) {
 
     pa_log_debug("%s:\n", __func__);
 
-    if ((pa_sdata->sink->core->realtime_scheduling)) {
-        pa_log_info("%s:: Making io thread for %s as realtime with prio %d", __func__,
-                pa_pal_sink_get_name_from_type(pal_sdata->stream_attributes->type),
-                pa_sdata->sink->core->realtime_priority);
-        pa_thread_make_realtime(pa_sdata->sink->core->realtime_priority);
-    }
+    pa_pal_sched_apply(&pal_sdata->sched, pa_sdata->sink->core, pa_sdata->sink->name);
     pa_thread_mq_install(&pa_sdata->thread_mq);
 
     memset(&out_buf, 0, sizeof(struct pal_buffer));
@@ -1040,7 +1876,7 @@ static void pa_pal_sink_thread_func(void *userdata) {
         pa_rtpoll_set_timer_disabled(pa_sdata->rtpoll);
 
         if (pa_sdata->sink->thread_info.rewind_requested)
-            pa_sink_process_rewind(pa_sdata->sink, 0);
+            pa_pal_sink_process_rewind(sdata);
 
         /* A compressed sink only renders in RUNNING, not in IDLE */
         render = (!pal_sdata->compressed && !pal_sdata->dynamic_usecase &&
@@ -1048,23 +1884,25 @@ static void pa_pal_sink_thread_func(void *userdata) {
                    PA_SINK_IS_RUNNING(pa_sdata->sink->thread_info.state);
 
         if (render && !pa_atomic_load(&pal_sdata->restart_in_progress)) {
-            if (!pal_sdata->compressed) {
-                pa_sink_render_full(pa_sdata->sink, pal_sdata->buffer_size, &chunk);
-                pa_assert(chunk.length == pal_sdata->buffer_size);
-                write_chunk(sdata, &chunk);
-                pa_rtpoll_set_timer_absolute(pa_sdata->rtpoll, pa_rtclock_now());
-            } else if (pa_atomic_load(&pal_sdata->write_done)) {
-                pa_sink_render(pa_sdata->sink, pal_sdata->buffer_size, &chunk);
-                pa_assert(chunk.length > 0);
-                pa_atomic_store(&pal_sdata->write_done, 0);
-                pa_asyncmsgq_post(pal_sdata->pal_thread_mq.inq, PA_MSGOBJECT(pal_sdata->pal_msg),
-                        PAL_SINK_MESSAGE_WRITE_READY, NULL, 0, &chunk, NULL);
+            if (pal_sdata->mmap) {
+                if (sdata->pal_sink_opened && !pal_sdata->standby)
+                    pa_pal_sink_mmap_fill(sdata);
+            } else if (pal_sdata->tsched && !pal_sdata->compressed && sdata->pal_sink_opened) {
+                pa_pal_sink_tsched_fill(sdata);
+            } else if (pa_pal_sink_ring_push(sdata, pal_sdata->buffer_size)) {
+                /* fill every free ring slot, PAL thread posts fdsem once it consumed one */
+                while (pa_pal_sink_ring_push(sdata, pal_sdata->buffer_size));
+                pa_fdsem_post(pal_sdata->pal_fdsem);
             }
+
+            if (pal_sdata->adaptive && sdata->pal_sink_opened && PA_SINK_IS_RUNNING(pa_sdata->sink->thread_info.state))
+                pa_pal_sink_adapt_update(sdata);
         } else if (pa_sdata->sink->thread_info.state == PA_SINK_SUSPENDED) {
             /* if sink is suspended state then reset buffer otherwise
              * it might end up sending incorrect buffer to pal_write */
             pa_log_debug("%d sink in suspended state. sending empty buffer \n", __LINE__);
             memset(&out_buf, 0, sizeof(struct pal_buffer));
+            pa_pal_sink_standby_expire(sdata);
         }
 
         rc = pa_rtpoll_run(pa_sdata->rtpoll);
@@ -1110,8 +1948,10 @@ static int32_t pa_pal_out_cb(pal_stream_handle_t *stream_handle,
                     __LINE__, __func__, pal_sdata->stream_handle);
 #endif
             /* Wake up PAL thread */
-            if (pal_sdata->compressed)
+            if (pal_sdata->compressed) {
+                pa_atomic_store(&pal_sdata->write_ready, 1);
                 pa_fdsem_post(pal_sdata->pal_fdsem);
+            }
 
             break;
 
@@ -1205,20 +2045,41 @@ pa_idxset* pa_pal_sink_get_config(pa_pal_sink_handle_t *handle) {
     return pa_pal_sink_get_formats(sdata->pa_sdata->sink);
 }
 
+/* map the DSP buffer of a freshly opened ultra low latency session */
+static int pa_pal_sink_mmap_open(pa_pal_sink_data *sdata) {
+    pal_sink_data *pal_sdata = sdata->pal_sdata;
+    struct pal_media_config *config = &pal_sdata->stream_attributes->out_media_config;
+    /* taken from the media config, a reconfigure opens before the sink spec changes */
+    size_t frame_size = (config->bit_width / PA_BITS_PER_BYTE) * config->ch_info.channels;
+    int rc;
+
+    memset(&pal_sdata->mmap_buffer, 0, sizeof(pal_sdata->mmap_buffer));
+    rc = pal_stream_create_mmap_buffer(pal_sdata->stream_handle, (int32_t)(pal_sdata->buffer_size / frame_size),
+                                       &pal_sdata->mmap_buffer);
+    if (rc || !pal_sdata->mmap_buffer.buffer || !pal_sdata->mmap_buffer.buffer_size_frames) {
+        pa_log_error("pal_stream_create_mmap_buffer failed, error %d", rc);
+        return rc ? rc : -1;
+    }
+
+    /* signed PCM only, zero is silence */
+    memset(pal_sdata->mmap_buffer.buffer, 0, pal_sdata->mmap_buffer.buffer_size_frames * frame_size);
+    pa_log_info("pal sink mmap buffer of %d frames, burst %d frames", (int)pal_sdata->mmap_buffer.buffer_size_frames,
+                (int)pal_sdata->mmap_buffer.burst_size_frames);
+
+    return 0;
+}
+
 static int open_pal_sink(pa_pal_sink_data *sdata) {
     int rc = 0;
     pal_buffer_config_t out_buf_cfg, in_buf_cfg;
     pal_sink_data *pal_sdata;
+    pa_pal_stream_key key;
 
     pa_assert(sdata);
     pa_assert(sdata->pal_sdata);
 
     pal_sdata = sdata->pal_sdata;
 
-#ifdef SINK_DUMP_ENABLED
-    char *file_name;
-#endif
-
     pa_assert(pal_sdata);
 
     pa_log_debug("opening sink with configuration type = 0x%x, format %d, sample_rate %d, channels: %d",
@@ -1226,6 +2087,18 @@ static int open_pal_sink(pa_pal_sink_data *sdata) {
                  pal_sdata->stream_attributes->out_media_config.sample_rate,
                  pal_sdata->stream_attributes->out_media_config.ch_info.channels);
 
+    if (pal_sdata->stream_cache && !pal_sdata->mmap) {
+        pa_pal_stream_key_init(&key, pal_sdata->stream_attributes, true, pal_sdata->pal_device,
+                               pal_sdata->buffer_size, pal_sdata->buffer_count);
+        if ((pal_sdata->stream_handle = pa_pal_stream_cache_take(pal_sdata->stream_cache, &key))) {
+            /* opened with this exact config and callback before, buffers are already set up */
+            pa_log_debug("pal sink reusing cached stream %p", pal_sdata->stream_handle);
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_CACHE_HITS);
+            goto opened;
+        }
+        pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_CACHE_MISSES);
+    }
+
     rc = pal_stream_open(pal_sdata->stream_attributes, 1, pal_sdata->pal_device, 0, NULL, pa_pal_out_cb, (uint64_t)sdata,
                              &pal_sdata->stream_handle);
 
@@ -1237,10 +2110,21 @@ static int open_pal_sink(pa_pal_sink_data *sdata) {
 
     pa_log_debug("pal sink opened %p", pal_sdata->stream_handle);
 
+    if (pal_sdata->mmap) {
+        rc = pa_pal_sink_mmap_open(sdata);
+        if (rc) {
+            /* not started and not cached yet, nothing else will close it */
+            pal_stream_close(pal_sdata->stream_handle);
+            pal_sdata->stream_handle = NULL;
+            goto exit;
+        }
+        goto opened;
+    }
+
     /* FIXME: Update it by calling pal_stream_get_buffer_size */
     in_buf_cfg.buf_size = 0;
     in_buf_cfg.buf_count = 0;
-    out_buf_cfg.buf_size = pal_sdata->buffer_size;
+    out_buf_cfg.buf_size = pa_pal_sink_pal_bytes(pal_sdata, pal_sdata->buffer_size);
     out_buf_cfg.buf_count = pal_sdata->buffer_count;
     rc = pal_stream_set_buffer_size(pal_sdata->stream_handle, &in_buf_cfg, &out_buf_cfg);
     if(rc) {
@@ -1248,26 +2132,34 @@ static int open_pal_sink(pa_pal_sink_data *sdata) {
         goto exit;
     }
 
+opened:
+    /* cached or new, the session may not have the volume ramp yet */
+    pa_pal_volume_reset(pal_sdata->volume);
     sdata->pal_sink_opened = true;
     pa_atomic_store(&pal_sdata->close_output, 0);
+    pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_OPENS);
+    pal_sdata->written_track = pa_atomic_load(&pal_sdata->track);
 
-#ifdef SINK_DUMP_ENABLED
-    file_name = pa_sprintf_malloc("/data/pcmdump_sink_%d", pal_sdata->index);
-
-    pal_sdata->write_fd = open(file_name, O_RDWR | O_TRUNC | O_CREAT, S_IRWXU);
-    if(pal_sdata->write_fd < 0)
-        pa_log_error("Could not open write fd %d for sink index %d", pal_sdata->write_fd, pal_sdata->index);
-
-    pa_xfree(file_name);
-#endif
+    /* set on every track switch, not allocated on the PAL thread each time */
+    if (pal_sdata->gapless && pal_sdata->compressed && !pal_sdata->gapless_payload) {
+        pal_sdata->gapless_payload = pa_xmalloc0(sizeof(pal_param_payload) + sizeof(struct pal_compr_gapless_mdata));
+        pal_sdata->gapless_payload->payload_size = sizeof(struct pal_compr_gapless_mdata);
+    }
 
 exit:
     return rc;
 }
 
 static int close_pal_sink(pa_pal_sink_data *sdata) {
+    return release_pal_sink(sdata, false);
+}
+
+/* Stop the session and close it, or with park keep the stopped stream in
+ * the stream cache for a later open with the same media config. */
+static int release_pal_sink(pa_pal_sink_data *sdata, bool park) {
     pal_sink_data *pal_sdata;
     pa_sink_data *pa_sdata;
+    pa_pal_stream_key key;
     int rc = -1;
 
     pa_assert(sdata);
@@ -1279,9 +2171,16 @@ static int close_pal_sink(pa_pal_sink_data *sdata) {
 
     pa_assert(pal_sdata->stream_handle);
     pa_atomic_store(&sdata->pal_sdata->close_output, 1);
-    pa_mutex_lock(pal_sdata->mutex);
+    /* a compressed write waiting for WRITE_READY gives up */
+    if (pal_sdata->pal_fdsem)
+        pa_fdsem_post(pal_sdata->pal_fdsem);
+    /* the PAL thread finishes the write it is in, close_output stops the next one */
+    pa_mutex_lock(pal_sdata->write_mutex);
+    pa_pal_lock_acquire(pal_sdata->lock);
+    /* nothing left to flush once the session is stopped */
+    pa_atomic_store(&pal_sdata->flush_pending, 0);
 
-    pa_log_debug("closing pal sink %p", pal_sdata->stream_handle);
+    pa_log_debug("%s pal sink %p", park ? "parking" : "closing", pal_sdata->stream_handle);
 
     if (PA_UNLIKELY(pal_sdata->stream_handle == NULL)) {
         pa_log_error("Invalid sink handle %p", pal_sdata->stream_handle);
@@ -1291,23 +2190,35 @@ static int close_pal_sink(pa_pal_sink_data *sdata) {
         if (PA_UNLIKELY(rc))
             pa_log_error("pal_stream_stop failed for %p error %d", pal_sdata->stream_handle, rc);
 
-        rc = pal_stream_close(pal_sdata->stream_handle);
-        if (PA_UNLIKELY(rc))
+        /* compressed sessions carry codec state, never reuse them */
+        if (park && !rc && !pal_sdata->compressed) {
+            pa_pal_stream_key_init(&key, pal_sdata->stream_attributes, true, pal_sdata->pal_device,
+                                   pal_sdata->buffer_size, pal_sdata->buffer_count);
+            park = pa_pal_stream_cache_put(pal_sdata->stream_cache, &key, pal_sdata->stream_handle);
+        } else {
+            park = false;
+        }
+
+        if (!park && (rc = pal_stream_close(pal_sdata->stream_handle)))
             pa_log_error("could not close sink handle %p, error %d", pal_sdata->stream_handle, rc);
 
         pal_sdata->stream_handle = NULL;
-        pal_sdata->bytes_written = 0;
+        pa_pal_sink_set_bytes_written(pal_sdata, 0);
+        pa_xfree(pal_sdata->gapless_payload);
+        pal_sdata->gapless_payload = NULL;
+        /* unmapped with the session */
+        memset(&pal_sdata->mmap_buffer, 0, sizeof(pal_sdata->mmap_buffer));
+        pa_pal_clock_dll_reset(&pal_sdata->latency_dll);
         pal_sdata->standby = true;
+        pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_CLOSES);
 #ifndef PAL_DISABLE_COMPRESS_AUDIO_SUPPORT
         pa_sdata->sink->sess_time = 0;
 #endif
         sdata->pal_sink_opened = false;
     }
 
-    pa_mutex_unlock(pal_sdata->mutex);
-#ifdef SINK_DUMP_ENABLED
-    close(pal_sdata->write_fd);
-#endif
+    pa_pal_lock_release(pal_sdata->lock);
+    pa_mutex_unlock(pal_sdata->write_mutex);
 
     return rc;
 }
@@ -1316,14 +2227,17 @@ static int restart_pal_sink(pa_sink *s, pa_encoding_t encoding, pa_sample_spec *
                             int sink_id, pa_pal_sink_data *sdata,uint32_t buffer_size, uint32_t buffer_count) {
     int rc;
     pal_audio_fmt_t pal_format;
+    pa_usec_t start = pa_rtclock_now();
 
     pa_assert(s);
     pa_assert(sdata->pal_sdata);
     pa_assert(sdata->pa_sdata);
 
     pa_atomic_store(&sdata->pal_sdata->restart_in_progress, 1);
-    if (sdata->pal_sink_opened && PA_SINK_IS_OPENED(s->thread_info.state)) {
-        rc = close_pal_sink(sdata);
+    if (sdata->pal_sink_opened &&
+            (PA_SINK_IS_OPENED(s->thread_info.state) || pa_atomic_cmpxchg(&sdata->pal_sdata->warm, 1, 0))) {
+        /* parked, switching back to this config later is a handle swap */
+        rc = release_pal_sink(sdata, true);
         if (rc) {
             pa_log_error("close_pal_sink failed, error %d", rc);
             goto exit;
@@ -1336,7 +2250,11 @@ static int restart_pal_sink(pa_sink *s, pa_encoding_t encoding, pa_sample_spec *
         return -1;
     }
 
-    if (!sdata->pal_sdata->compressed && (sdata->pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH)) {
+    if (sdata->pal_sdata->convert && pal_format == PAL_AUDIO_FMT_PCM_S16_LE) {
+        /* ss is what PulseAudio renders, PAL always gets it packed */
+        sdata->pal_sdata->stream_attributes->out_media_config.bit_width = 24;
+        sdata->pal_sdata->stream_attributes->out_media_config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S24_3LE;
+    } else if (!sdata->pal_sdata->compressed && (sdata->pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH)) {
 
         sdata->pal_sdata->stream_attributes->out_media_config.bit_width = pa_sample_size_of_format(ss->format) * PA_BITS_PER_BYTE;
         switch (sdata->pal_sdata->stream_attributes->out_media_config.bit_width) {
@@ -1371,6 +2289,8 @@ static int restart_pal_sink(pa_sink *s, pa_encoding_t encoding, pa_sample_spec *
     rc = open_pal_sink(sdata);
     if (rc) {
         pa_log_error("open_pal_sink failed during recreation, error %d", rc);
+    } else {
+        pa_pal_stats_record(&sdata->pal_sdata->stats, PA_PAL_STATS_RECONFIG_US, pa_rtclock_now() - start);
     }
 
 exit:
@@ -1388,19 +2308,28 @@ static void free_pal_sink_thread_resources(pal_sink_data *pal_sdata){
         pal_sdata->pal_thread = NULL;
     }
 
-    if (pal_sdata->pal_rtpoll_item)
+    if (pal_sdata->pal_rtpoll_item) {
         pa_rtpoll_item_free(pal_sdata->pal_rtpoll_item);
+        pal_sdata->pal_rtpoll_item = NULL;
+    }
 
-    if (pal_sdata->pal_thread_rtpoll)
+    if (pal_sdata->pal_thread_rtpoll) {
+        pa_thread_mq_done(&pal_sdata->pal_thread_mq);
         pa_rtpoll_free(pal_sdata->pal_thread_rtpoll);
+        pal_sdata->pal_thread_rtpoll = NULL;
+    }
 
-    if (pal_sdata->pal_fdsem)
+    if (pal_sdata->pal_fdsem) {
         pa_fdsem_free(pal_sdata->pal_fdsem);
+        pal_sdata->pal_fdsem = NULL;
+    }
 
-    pa_thread_mq_done(&pal_sdata->pal_thread_mq);
-
-    if (pal_sdata->pal_msg)
-        pa_xfree(pal_sdata->pal_msg);
+    /* drop chunks rendered after the PAL thread exited */
+    while (pa_atomic_load(&pal_sdata->ring_fill) > 0) {
+        pa_atomic_sub(&pal_sdata->ring_bytes, (int)pal_sdata->ring[pal_sdata->ring_read_index].length);
+        pa_memblock_unref(pal_sdata->ring[pal_sdata->ring_read_index].memblock);
+        pa_pal_sink_ring_pop(pal_sdata);
+    }
 }
 
 static int free_pal_sink(pa_pal_sink_data *sdata) {
@@ -1409,18 +2338,25 @@ static int free_pal_sink(pa_pal_sink_data *sdata) {
     pa_assert(sdata);
     pa_assert(sdata->pal_sdata);
 
-    if (!sdata->pal_sdata->standby) {
+    /* a queued switch must not run against a freed sink */
+    pa_pal_worker_free(sdata->pal_sdata->ctrl_worker);
+
+    if (sdata->pal_sink_opened) {
         rc = close_pal_sink(sdata);
         if (rc) {
             pa_log_error("close_pal_sink failed, error %d", rc);
         }
     }
 
-    if (sdata->pal_sdata->compressed) {
-        free_pal_sink_thread_resources(sdata->pal_sdata);
-    }
-    pa_mutex_free(sdata->pal_sdata->mutex);
-    pa_cond_free(sdata->pal_sdata->cond_ctrl_thread);
+    free_pal_sink_thread_resources(sdata->pal_sdata);
+    pa_xfree(sdata->pal_sdata->switch_buf);
+    pa_xfree(sdata->pal_sdata->convert_buf);
+    pa_xfree(sdata->pal_sdata->gapless_payload);
+    pa_pal_volume_free(sdata->pal_sdata->volume);
+    pa_pal_stream_cache_free(sdata->pal_sdata->stream_cache);
+    pa_pal_dump_slot_set(&sdata->pal_sdata->dump, NULL);
+    pa_pal_lock_free(sdata->pal_sdata->lock);
+    pa_mutex_free(sdata->pal_sdata->write_mutex);
     pa_xfree(sdata->pal_sdata->stream_attributes);
     pa_xfree(sdata->pal_sdata->pal_snd_dec);
     pa_xfree(sdata->pal_sdata->pal_device);
@@ -1434,7 +2370,6 @@ static int create_pal_sink(pa_pal_sink_config *sink, pa_pal_card_port_device_dat
     int rc = 0;
 
     sdata->pal_sdata = pa_xnew0(pal_sink_data, 1);
-    sdata->pal_sdata->mutex = pa_mutex_new(false /* recursive  */, false /* inherit_priority */);
 
     rc = pa_pal_sink_fill_info(sink, sdata->pal_sdata, port_device_data, PAL_AUDIO_FMT_DEFAULT_PCM);
     if (rc) {
@@ -1444,6 +2379,16 @@ static int create_pal_sink(pa_pal_sink_config *sink, pa_pal_card_port_device_dat
         return rc;
     }
 
+    /* created once nothing can fail, the error path above only frees pal_sdata */
+    sdata->pal_sdata->lock = pa_pal_lock_new(&sdata->pal_sdata->stats);
+    /* an MMAP session owns its mapping, it is never parked */
+    if (!sdata->pal_sdata->mmap)
+        sdata->pal_sdata->stream_cache = pa_pal_stream_cache_new(sink->stream_cache_size);
+    sdata->pal_sdata->write_mutex = pa_mutex_new(false /* recursive */, true /* inherit_priority */);
+    sdata->pal_sdata->ctrl_worker = pa_pal_worker_new("pal-sink-ctrl");
+    sdata->pal_sdata->volume = pa_pal_volume_new(sink->volume_ramp_ms);
+    pa_atomic_store(&sdata->pal_sdata->switch_state, PA_PAL_SWITCH_IDLE);
+
     return rc;
 }
 
@@ -1541,17 +2486,15 @@ static int create_pa_sink(pa_module *m, char *sink_name, char *description, pa_i
 
     pa_log_debug("pa sink opened %p", pa_sdata->sink);
 
-    /* Creating PAL sink_write thread for compress offload stream type */
-    if (sdata->pal_sdata->compressed) {
-        pa_sdata->rtpoll_item = pa_rtpoll_item_new_fdsem(pa_sdata->rtpoll, PA_RTPOLL_NORMAL, sdata->fdsem);
-        if (!pa_sdata->rtpoll_item) {
-            pa_log_error("Could not create rpoll item");
-            goto fail;
-        }
-        if (create_pal_sink_thread(sdata)) {
-            pa_log_error("Failed to create pal sink thread");
-            goto fail;
-        }
+    /* Creating PAL sink_write thread, PAL writes never run on the sink I/O thread */
+    pa_sdata->rtpoll_item = pa_rtpoll_item_new_fdsem(pa_sdata->rtpoll, PA_RTPOLL_NORMAL, sdata->fdsem);
+    if (!pa_sdata->rtpoll_item) {
+        pa_log_error("Could not create rpoll item");
+        goto fail;
+    }
+    if (create_pal_sink_thread(sdata)) {
+        pa_log_error("Failed to create pal sink thread");
+        goto fail;
     }
 
     pa_sdata->sink->userdata = (void *)sdata;
@@ -1582,7 +2525,7 @@ static int create_pa_sink(pa_module *m, char *sink_name, char *description, pa_i
     pa_sink_set_asyncmsgq(pa_sdata->sink, pa_sdata->thread_mq.inq);
     pa_sink_set_rtpoll(pa_sdata->sink, pa_sdata->rtpoll);
     pa_sink_set_max_request(pa_sdata->sink, sdata->pal_sdata->buffer_size);
-    pa_sink_set_max_rewind(pa_sdata->sink, 0);
+    pa_sink_set_max_rewind(pa_sdata->sink, pa_pal_sink_get_max_rewind(sdata->pal_sdata));
     pa_sink_set_fixed_latency(pa_sdata->sink, sdata->pal_sdata->sink_latency_us);
 
     if (use_hw_volume) {
@@ -1635,12 +2578,12 @@ static int free_pa_sink(pa_pal_sink_data *sdata) {
     if (pa_sdata->formats)
         pa_idxset_free(pa_sdata->formats, (pa_free_cb_t) pa_format_info_free);
 
-    if (pa_sdata->rtpoll)
-        pa_rtpoll_free(pa_sdata->rtpoll);
-
     if (pa_sdata->rtpoll_item)
         pa_rtpoll_item_free(pa_sdata->rtpoll_item);
 
+    if (pa_sdata->rtpoll)
+        pa_rtpoll_free(pa_sdata->rtpoll);
+
     pa_xfree(pa_sdata);
 
     return 0;
@@ -1669,6 +2612,7 @@ int pa_pal_sink_create(pa_module *m, pa_card *card, const char *driver, const ch
     pa_pal_card_port_device_data *port_device_data;
 
     char ss_buf[PA_SAMPLE_SPEC_SNPRINT_MAX];
+    pa_sample_spec ss;
 
     void *state;
 
@@ -1721,7 +2665,12 @@ int pa_pal_sink_create(pa_module *m, pa_card *card, const char *driver, const ch
         goto exit;
     }
 
-    rc = create_pa_sink(m, sink->name, sink->description, sink->formats, &sink->default_spec, &sink->default_map, sink->use_hw_volume, sink->alternate_sample_rate, card, sink->avoid_config_processing, ports, driver, sdata);
+    /* a converting sink renders in its convert format */
+    ss = sink->default_spec;
+    if (sdata->pal_sdata->convert)
+        ss.format = sink->convert_format;
+
+    rc = create_pa_sink(m, sink->name, sink->description, sink->formats, &ss, &sink->default_map, sink->use_hw_volume, sink->alternate_sample_rate, card, sink->avoid_config_processing, ports, driver, sdata);
     pa_hashmap_free(ports);
     if (PA_UNLIKELY(rc)) {
         pa_log_error("Could not create pa sink for sink %s, error %d", sink->name, rc);
@@ -1753,6 +2702,56 @@ void pa_pal_sink_close(pa_pal_sink_handle_t *handle) {
     pa_xfree(sdata);
 }
 
+/* main thread, s must belong to the pal card */
+char *pa_pal_sink_get_stats(pa_sink *s) {
+    pa_pal_sink_data *sdata;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_sink_data *)s->userdata);
+
+    if (!sdata->pal_sdata)
+        return NULL;
+
+    return pa_pal_stats_to_string(&sdata->pal_sdata->stats);
+}
+
+void pa_pal_sink_update_stats_proplist(pa_sink *s) {
+    pa_pal_sink_data *sdata;
+    pa_proplist *p;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_sink_data *)s->userdata);
+
+    if (!sdata->pal_sdata)
+        return;
+
+    p = pa_proplist_copy(s->proplist);
+    if (pa_pal_stats_to_proplist(&sdata->pal_sdata->stats, p))
+        pa_sink_update_proplist(s, PA_UPDATE_REPLACE, p);
+    pa_proplist_free(p);
+}
+
+/* main thread, starts a PCM tap on s or stops it when path is NULL or empty */
+int pa_pal_sink_set_dump(pa_sink *s, const char *path) {
+    pa_pal_sink_data *sdata;
+    pal_sink_data *pal_sdata;
+    pa_pal_dump *dump = NULL;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_sink_data *)s->userdata);
+
+    if (!(pal_sdata = sdata->pal_sdata))
+        return -1;
+
+    /* compressed data is tapped raw */
+    if (path && *path && !(dump = pa_pal_dump_new(path, &s->sample_spec, !pal_sdata->compressed)))
+        return -1;
+
+    pa_pal_dump_slot_set(&pal_sdata->dump, dump);
+
+    return 0;
+}
+
 void pa_pal_sink_module_deinit() {
 
     pa_assert(mdata);
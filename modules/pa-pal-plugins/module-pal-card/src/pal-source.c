@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <unistd.h>
 
 #include <pulse/rtclock.h>
@@ -22,6 +23,7 @@
 #include <pulsecore/rtpoll.h>
 #include <pulsecore/source.h>
 #include <pulsecore/memchunk.h>
+#include <pulsecore/sample-util.h>
 #include <pulsecore/core-format.h>
 #include <pulsecore/core-util.h>
 #include <pulse/util.h>
@@ -44,11 +46,15 @@
 #define PA_BITS_PER_BYTE 8
 #define PA_DEFAULT_BUFFER_DURATION_MS 25
 #define PA_LOW_LATENCY_DURATION_MS 5
+#define PA_ULTRA_LOW_LATENCY_DURATION_MS 2
 #define PA_DEEP_BUFFER_DURATION_MS 20
+/* control worker polls the source thread for the end of the fade out */
+#define PA_PAL_SOURCE_SWITCH_POLL_MS 2
 
 static int restart_pal_source(pa_pal_source_data *sdata, pa_encoding_t encoding, pa_sample_spec *ss, pa_channel_map *map);
 static int create_pal_source(pa_pal_source_config *source, pa_pal_card_port_device_data *port_device_data, pa_pal_source_data *sdata);
 static int close_pal_source(pa_pal_source_data *sdata);
+static int release_pal_source(pa_pal_source_data *sdata, bool park);
 static int open_pal_source(pa_pal_source_data *sdata);
 
 static const uint32_t supported_source_rates[] =
@@ -67,6 +73,10 @@ static size_t source_get_buffer_size (pa_sample_spec spec,pal_stream_type_t type
             break;
         case PAL_STREAM_LOW_LATENCY:
             buffer_duration = PA_LOW_LATENCY_DURATION_MS;
+            break;
+        case PAL_STREAM_ULTRA_LOW_LATENCY:
+            buffer_duration = PA_ULTRA_LOW_LATENCY_DURATION_MS;
+            break;
         default:
             break;
     }
@@ -109,6 +119,8 @@ static const char *pa_pal_source_get_name_from_type(pal_stream_type_t type) {
         name = "regular";
     else if (type == PAL_STREAM_LOW_LATENCY)
         name = "low-latency";
+    else if (type == PAL_STREAM_ULTRA_LOW_LATENCY)
+        name = "ultra-low-latency";
     else if (type == PAL_STREAM_COMPRESSED)
         name = "compress";
     else if (type == PAL_STREAM_VOIP_TX)
@@ -121,13 +133,20 @@ static const char *pa_pal_source_get_name_from_type(pal_stream_type_t type) {
     return name;
 }
 
+static void pa_pal_source_apply_volume(void *userdata) {
+    pal_source_data *pal_sdata = userdata;
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    if (pal_sdata->stream_handle)
+        pa_pal_volume_apply(pal_sdata->volume, pal_sdata->stream_handle);
+    pa_pal_lock_release(pal_sdata->lock);
+}
+
 static void pa_pal_source_set_volume_cb(pa_source *s) {
     pa_pal_source_data *sdata = NULL;
     float gain;
-    int rc;
     pa_volume_t volume;
     pal_source_data *pal_sdata = NULL;
-    struct pal_volume_data *volume_data = NULL;
     uint32_t i,no_vol_pair;
     uint32_t channel_mask = 1;
 
@@ -148,43 +167,24 @@ static void pa_pal_source_set_volume_cb(pa_source *s) {
     gain = ((float) pa_cvolume_max(&s->real_volume) * (float)PAL_MAX_GAIN) / (float)PA_VOLUME_NORM;
     volume = (pa_volume_t) roundf((float) gain * PA_VOLUME_NORM / PAL_MAX_GAIN);
 
-    volume_data = (struct pal_volume_data *)malloc(sizeof(uint32_t) +
-                                                 (sizeof(struct pal_channel_vol_kv) * (no_vol_pair)));
-    if (!volume_data) {
-        pa_log_error("malloc failed for size %zu", sizeof(uint32_t) +
-                 (sizeof(struct pal_channel_vol_kv) * (no_vol_pair)));
-        return;
-    }
-
-    volume_data->no_of_volpair = no_vol_pair;
-
     for (i = 0; i < no_vol_pair; i++) {
         channel_mask = (channel_mask | pal_sdata->stream_attributes->out_media_config.ch_info.ch_map[i]);
     }
 
     channel_mask = (channel_mask << 1);
 
-    for (i = 0; i < no_vol_pair; i++) {
-        volume_data->volume_pair[i].channel_mask = channel_mask;
-        volume_data->volume_pair[i].vol = gain;
+    /* the capture thread never waits on this, the worker sends only the last update */
+    pa_pal_volume_set(pal_sdata->volume, gain, no_vol_pair, channel_mask);
+    if (!pa_pal_worker_post(pal_sdata->ctrl_worker, pal_sdata->volume, pa_pal_source_apply_volume, pal_sdata)) {
+        pa_log_info("pal source has no control worker, setting volume synchronously");
+        pa_pal_source_apply_volume(pal_sdata);
     }
-
-    pal_sdata->source_event_id = PA_PAL_VOLUME_APPLY;
-    pa_mutex_lock(pal_sdata->mutex);
-    rc = pal_stream_set_volume(pal_sdata->stream_handle, volume_data);
-    pal_sdata->source_event_id = PA_PAL_NO_EVENT;
-    pa_mutex_unlock(pal_sdata->mutex);
-    pa_cond_signal(pal_sdata->cond_ctrl_thread, 0);
-    if (rc)
-        pa_log_error("pal stream : unable to set volume error %d\n", rc);
-    else
-        pa_cvolume_set(&s->real_volume, s->real_volume.channels, volume); /* TODO: Is this correct?  */
-
-    pa_xfree(volume_data);
-    return;
+    pa_cvolume_set(&s->real_volume, s->real_volume.channels, volume); /* TODO: Is this correct?  */
 }
 
 static int pa_pal_source_fill_info(pa_pal_source_config *source, pal_source_data *pal_sdata, pa_pal_card_port_device_data *port_device_data) {
+    pa_pal_pcm_convert_impl_t impl;
+
     pa_assert(pal_sdata);
 
     pal_sdata->stream_attributes = pa_xnew0(struct pal_stream_attributes, 1);
@@ -198,6 +198,12 @@ static int pa_pal_source_fill_info(pa_pal_source_config *source, pal_source_data
     pal_sdata->stream_attributes->flags = 0;
     pal_sdata->stream_attributes->direction = PAL_AUDIO_INPUT;
 
+    if (pal_sdata->stream_attributes->type == PAL_STREAM_ULTRA_LOW_LATENCY) {
+        /* no IRQ, nothing reports captured buffers, the I/O thread polls the DSP position */
+        pal_sdata->stream_attributes->flags = PAL_STREAM_FLAG_MMAP_NO_IRQ_MASK;
+        pal_sdata->mmap = true;
+    }
+
     pal_sdata->stream_attributes->in_media_config.sample_rate = source->default_spec.rate;
     pal_sdata->stream_attributes->in_media_config.bit_width = pa_sample_size_of_format(source->default_spec.format) * PA_BITS_PER_BYTE;
 
@@ -213,6 +219,15 @@ static int pa_pal_source_fill_info(pa_pal_source_config *source, pal_source_data
             break;
     }
 
+    /* PulseAudio gets convert_format, the source I/O thread unpacks to it */
+    if (source->default_spec.format == PA_SAMPLE_S24LE && pa_pal_pcm_convert_supported(source->convert_format) &&
+            !pal_sdata->mmap) {
+        impl = pa_pal_pcm_convert_best();
+        if ((pal_sdata->convert = pa_pal_pcm_convert_get_unpack(impl, source->convert_format)))
+            pa_log_info("%s: unpacking s24le to %s, %s", source->name, pa_sample_format_to_string(source->convert_format),
+                        pa_pal_pcm_convert_impl_to_string(impl));
+    }
+
     if (!pa_pal_channel_map_to_pal(&source->default_map, &pal_sdata->stream_attributes->in_media_config.ch_info)) {
         pa_log_error("%s: unsupported channel map", __func__);
         pa_xfree(&pal_sdata->stream_attributes->in_media_config.ch_info);
@@ -240,10 +255,12 @@ static int pa_pal_source_fill_info(pa_pal_source_config *source, pal_source_data
 
     pal_sdata->device_url = NULL; /* TODO: useful for BT devices */
     pal_sdata->index = source->id;
-    pal_sdata->buffer_size = (size_t)(source->buffer_size);
+    /* configured in packed bytes, kept in posted bytes */
+    pal_sdata->buffer_size = pal_sdata->convert ?
+        (size_t)(source->buffer_size) / PA_PAL_PCM_CONVERT_PACKED_BYTES * PA_PAL_PCM_CONVERT_HOST_BYTES :
+        (size_t)(source->buffer_size);
     pal_sdata->buffer_count = (size_t)(source->buffer_count);
-    pal_sdata->source_event_id = PA_PAL_NO_EVENT;
-    pal_sdata->cond_ctrl_thread = pa_cond_new();
+    pal_sdata->sched = source->sched;
 
     pal_sdata->standby = true;
 
@@ -269,6 +286,16 @@ static int pa_pal_source_start(pa_pal_source_data *sdata) {
         }
         rc = pal_stream_start(pal_sdata->stream_handle);
         pa_log_debug("pal_stream_start returned %d", rc);
+        /* session time restarts from zero with the stream */
+        pal_sdata->bytes_read = 0;
+        pa_pal_clock_dll_reset(&pal_sdata->latency_dll);
+        if (pal_sdata->mmap && !rc) {
+            pal_sdata->mmap_read = 0;
+            pal_sdata->mmap_written = 0;
+            pal_sdata->mmap_position = 0;
+            if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_written, true))
+                pa_log_debug("no mmap position yet, counting from zero");
+        }
         pal_sdata->standby = false;
     } else {
         pa_log_debug("pal_stream already started");
@@ -289,6 +316,9 @@ static int pa_pal_source_standby(pa_pal_source_data *sdata) {
         if (PA_UNLIKELY(rc)) {
             pa_log_error("Could not close source handle %p, error  %d", sdata->pal_sdata->stream_handle, rc);
         }
+        pa_log_info("source %d capture pool: %" PRIu64 " reads, %" PRIu64 " block allocations", sdata->pal_sdata->index,
+                    pa_pal_stats_get(&sdata->pal_sdata->stats, PA_PAL_STATS_READS),
+                    pa_pal_stats_get(&sdata->pal_sdata->stats, PA_PAL_STATS_POOL_ALLOCS));
     } else {
         pa_log_debug("pal_stream already in standby");
     }
@@ -296,12 +326,12 @@ static int pa_pal_source_standby(pa_pal_source_data *sdata) {
     return 0;
 }
 
-static int pa_pal_set_device(pal_stream_handle_t *stream_handle,
-                          pa_pal_card_port_device_data *param_device_connection) {
+static int pa_pal_set_device(pal_stream_handle_t *stream_handle, pal_device_id_t device) {
     struct pal_device device_connect;
     int ret = 0;
 
-    device_connect.id = param_device_connection->device;
+    memset(&device_connect, 0, sizeof(device_connect));
+    device_connect.id = device;
 
     ret = pal_stream_set_device(stream_handle, PA_NUM_DEVICES, &device_connect);
     if(ret)
@@ -310,6 +340,68 @@ static int pa_pal_set_device(pal_stream_handle_t *stream_handle,
     return ret;
 }
 
+/* Control worker: fade the capture out, reroute the stream, fade back in.
+ * While muted the source thread posts silence instead of waiting for PAL. */
+static void pa_pal_source_switch_device(void *userdata) {
+    pa_pal_source_data *sdata = userdata;
+    pal_source_data *pal_sdata = sdata->pal_sdata;
+    pa_source *source = sdata->pa_sdata->source;
+    pa_usec_t timeout, waited = 0, start;
+    bool fade;
+    int rc = 0;
+
+    /* open and standby change under the lock, as does the device */
+    pa_pal_lock_acquire(pal_sdata->lock);
+    fade = sdata->pal_source_opened && !pal_sdata->standby;
+    pa_pal_lock_release(pal_sdata->lock);
+
+    if (fade) {
+        /* the ramp is the next buffer read, a blocking read may be in flight */
+        timeout = pa_bytes_to_usec(pal_sdata->buffer_size, &source->sample_spec) * 3;
+        pa_atomic_store(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_OUT);
+        while (pa_atomic_load(&pal_sdata->switch_state) == PA_PAL_SWITCH_FADE_OUT && waited < timeout) {
+            pa_msleep(PA_PAL_SOURCE_SWITCH_POLL_MS);
+            waited += PA_PAL_SOURCE_SWITCH_POLL_MS * PA_USEC_PER_MSEC;
+        }
+        pa_atomic_store(&pal_sdata->switch_state, PA_PAL_SWITCH_MUTED);
+    }
+
+    pa_pal_lock_acquire(pal_sdata->lock);
+    if (pal_sdata->stream_handle) {
+        start = pa_rtclock_now();
+        rc = pa_pal_set_device(pal_sdata->stream_handle, pal_sdata->pal_device->id);
+        pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_SWITCH_US, pa_rtclock_now() - start);
+    }
+    pa_pal_lock_release(pal_sdata->lock);
+
+    pa_atomic_store(&pal_sdata->switch_state, fade ? PA_PAL_SWITCH_FADE_IN : PA_PAL_SWITCH_IDLE);
+
+    if (rc)
+        pa_log_error("pal source switch device failed %d", rc);
+    else
+        pa_log_debug("pal source switched device after %" PRIu64 " us fade wait", waited);
+}
+
+/* source I/O thread: step the device switch fade over a buffer just read */
+static void pa_pal_source_switch_shape(pa_pal_source_data *sdata, void *data, size_t length) {
+    pal_source_data *pal_sdata = sdata->pal_sdata;
+    pa_sample_spec *ss = &sdata->pa_sdata->source->sample_spec;
+
+    switch (pa_atomic_load(&pal_sdata->switch_state)) {
+        case PA_PAL_SWITCH_FADE_OUT:
+            if (!pa_pal_util_ramp(data, data, length, ss, false))
+                pa_silence_memory(data, length, ss);
+            pa_atomic_cmpxchg(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_OUT, PA_PAL_SWITCH_MUTED);
+            break;
+        case PA_PAL_SWITCH_FADE_IN:
+            pa_pal_util_ramp(data, data, length, ss, true);
+            pa_atomic_cmpxchg(&pal_sdata->switch_state, PA_PAL_SWITCH_FADE_IN, PA_PAL_SWITCH_IDLE);
+            break;
+        default:
+            break;
+    }
+}
+
 static int pa_pal_source_set_port_cb(pa_source *s, pa_device_port *p) {
     int ret = 0;
     pal_param_device_connection_t param_device_connection;
@@ -413,7 +505,9 @@ static int pa_pal_source_set_port_cb(pa_source *s, pa_device_port *p) {
         }
     }
 
-    /* Update required port info as per PA active port for next run */
+    /* Update required port info as per PA active port for next run, a
+     * switch queued on the control worker reads it under the lock */
+    pa_pal_lock_acquire(sdata->pal_sdata->lock);
     sdata->pal_sdata->pal_device->id = port_device_data->device;
     if (port_device_data->pal_devicepp_config) {
         pa_strlcpy(sdata->pal_sdata->pal_device->custom_config.custom_key, port_device_data->pal_devicepp_config,
@@ -423,6 +517,10 @@ static int pa_pal_source_set_port_cb(pa_source *s, pa_device_port *p) {
         pa_strlcpy(sdata->pal_sdata->pal_device->custom_config.custom_key, "",
                 sizeof(sdata->pal_sdata->pal_device->custom_config.custom_key));
     }
+    pa_pal_lock_release(sdata->pal_sdata->lock);
+
+    /* parked sessions are routed to the old device */
+    pa_pal_stream_cache_clear(sdata->pal_sdata->stream_cache);
 
     if (PA_SOURCE_IS_OPENED(s->state)) {
         pa_assert(sdata->pal_sdata->stream_handle);
@@ -431,17 +529,10 @@ static int pa_pal_source_set_port_cb(pa_source *s, pa_device_port *p) {
         return ret;
     }
 
-    param_device_connection.id = port_device_data->device;
-
-    sdata->pal_sdata->source_event_id = PA_PAL_DEVICE_SWITCH;
-    pa_mutex_lock(sdata->pal_sdata->mutex);
-    ret = pa_pal_set_device(sdata->pal_sdata->stream_handle, (pa_pal_card_port_device_data *)&param_device_connection);
-    sdata->pal_sdata->source_event_id = PA_PAL_NO_EVENT;
-    pa_mutex_unlock(sdata->pal_sdata->mutex);
-    pa_cond_signal(sdata->pal_sdata->cond_ctrl_thread, 0);
-    if (ret != 0) {
-        pa_log_error("pal source switch device failed %d", ret);
-        return ret;
+    if (!pa_pal_worker_post(sdata->pal_sdata->ctrl_worker, &sdata->pal_sdata->switch_state,
+                            pa_pal_source_switch_device, sdata)) {
+        pa_log_info("pal source has no control worker, switching device synchronously");
+        pa_pal_source_switch_device(sdata);
     }
 
     return ret;
@@ -473,6 +564,55 @@ static int pa_pal_source_set_state_in_io_thread_cb(pa_source *s, pa_source_state
     return r;
 }
 
+/* Latency of a capture stream is what the DSP has already captured but the
+ * I/O thread has not posted yet: the session time projected to now minus
+ * the bytes read so far. */
+static pa_usec_t pa_pal_source_get_latency(pa_pal_source_data *sdata) {
+    pal_source_data *pal_sdata = sdata->pal_sdata;
+    pa_source *source = sdata->pa_sdata->source;
+    uint64_t cur_session_time = 0, bytes_captured;
+
+    if (!sdata->pal_source_opened || pal_sdata->standby || !pal_sdata->stream_handle)
+        return 0;
+
+    if (pal_sdata->mmap) {
+        if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_written, false))
+            pa_log_debug("%s: mmap position unavailable, using the last one", __func__);
+        if (pal_sdata->mmap_written <= pal_sdata->mmap_read)
+            return 0;
+        return pa_bytes_to_usec((pal_sdata->mmap_written - pal_sdata->mmap_read) * pa_frame_size(&source->sample_spec),
+                                &source->sample_spec);
+    }
+
+    if (pa_pal_util_get_session_time(pal_sdata->stream_handle, NULL, &cur_session_time)) {
+        /* no timestamp, assume the buffer being captured is the only one queued */
+#ifdef SOURCE_DEBUG
+        pa_log_debug("pal_get_timestamp failed, using latency based on buffer size");
+#endif
+        return pa_bytes_to_usec(pal_sdata->buffer_size, &source->sample_spec);
+    }
+
+    cur_session_time = pa_pal_clock_dll_update(&pal_sdata->latency_dll, pa_pal_clock_now_us(), cur_session_time);
+    bytes_captured = pa_usec_to_bytes(cur_session_time, &source->sample_spec);
+    if (bytes_captured <= pal_sdata->bytes_read)
+        return 0;
+
+    /* more captured than the DSP can hold, it has started dropping data */
+    if (bytes_captured - pal_sdata->bytes_read > pal_sdata->buffer_size * PA_MAX(pal_sdata->buffer_count, (size_t)1)) {
+        if (!pal_sdata->overrun)
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_OVERRUNS);
+        pal_sdata->overrun = true;
+    } else {
+        pal_sdata->overrun = false;
+    }
+
+#ifdef SOURCE_DEBUG
+    pa_log_debug("%s: bytes_captured %" PRIu64 ", bytes_read %" PRIu64, __func__, bytes_captured, pal_sdata->bytes_read);
+#endif
+
+    return pa_bytes_to_usec(bytes_captured - pal_sdata->bytes_read, &source->sample_spec);
+}
+
 static int pa_pal_source_process_msg(pa_msgobject *o, int code, void *data, int64_t offset, pa_memchunk *chunk) {
     pa_pal_source_data *source_data = NULL;
 
@@ -485,7 +625,7 @@ static int pa_pal_source_process_msg(pa_msgobject *o, int code, void *data, int6
 
     switch (code) {
         case PA_SOURCE_MESSAGE_GET_LATENCY: {
-            *((pa_usec_t*) data) = 0;
+            *((pa_usec_t*) data) = pa_pal_source_get_latency(source_data);
             return 0;
         }
 
@@ -533,7 +673,8 @@ static void pa_pal_source_reconfigure_cb(pa_source *s, pa_sample_spec *spec, boo
             break;
         }
     }
-    supported_format = source_check_supported_format(spec->format);
+    /* a converting source always posts its convert format */
+    supported_format = pal_sdata->convert || source_check_supported_format(spec->format);
 
     if (!supported) {
         pa_log_info("Source does not support sample rate of %d Hz", spec->rate);
@@ -550,7 +691,8 @@ static void pa_pal_source_reconfigure_cb(pa_source *s, pa_sample_spec *spec, boo
 
         old_rate = pa_sdata->source->sample_spec.rate; /*take backup*/
         pa_sdata->source->sample_spec.rate = spec->rate;
-        pa_sdata->source->sample_spec.format = spec->format;
+        if (!pal_sdata->convert)
+            pa_sdata->source->sample_spec.format = spec->format;
 
         if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_CHANNELS) {
             s->reference_volume.channels = tmp_spec.channels;
@@ -562,7 +704,7 @@ static void pa_pal_source_reconfigure_cb(pa_source *s, pa_sample_spec *spec, boo
 
         port_device_data = PA_DEVICE_PORT_DATA(pa_sdata->source->active_port);
 
-        tmp_spec.format = spec->format;
+        tmp_spec.format = pal_sdata->convert ? pa_sdata->source->sample_spec.format : spec->format;
         /* find nearest suitable rate */
         if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_SAMPLE_RATE) {
             tmp_spec.rate = pa_pal_source_find_nearest_supported_sample_rate(spec->rate);
@@ -603,6 +745,148 @@ static pa_idxset* pa_pal_source_get_formats(pa_source *s) {
     return pa_idxset_copy(sdata->pa_sdata->formats, (pa_copy_func_t) pa_format_info_copy);
 }
 
+/* posted bytes to what PAL captures */
+static size_t pa_pal_source_pal_bytes(pal_source_data *pal_sdata, size_t bytes) {
+    if (!pal_sdata->convert)
+        return bytes;
+
+    return bytes / PA_PAL_PCM_CONVERT_HOST_BYTES * PA_PAL_PCM_CONVERT_PACKED_BYTES;
+}
+
+/* source I/O thread: where PAL reads a capture of length posted bytes into */
+static void *pa_pal_source_read_buf(pal_source_data *pal_sdata, void *data, size_t length) {
+    size_t size;
+
+    if (!pal_sdata->convert)
+        return data;
+
+    size = pa_pal_source_pal_bytes(pal_sdata, length);
+    if (pal_sdata->convert_buf_size < size) {
+        pal_sdata->convert_buf = pa_xrealloc(pal_sdata->convert_buf, size);
+        pal_sdata->convert_buf_size = size;
+    }
+
+    return pal_sdata->convert_buf;
+}
+
+/* source I/O thread: unpack length captured bytes into data, returns posted bytes */
+static size_t pa_pal_source_unpack(pal_source_data *pal_sdata, void *data, const void *captured, size_t length) {
+    if (!pal_sdata->convert)
+        return length;
+
+    pal_sdata->convert(data, captured, length / PA_PAL_PCM_CONVERT_PACKED_BYTES);
+
+    return length / PA_PAL_PCM_CONVERT_PACKED_BYTES * PA_PAL_PCM_CONVERT_HOST_BYTES;
+}
+
+/* Hand out a capture block of buffer_size from the pool. A pooled block is
+ * reused once every source output has dropped its reference to it, a new one
+ * is only allocated when all of them are still queued downstream. */
+static pa_memblock *pa_pal_source_pool_get(pa_pal_source_data *source_data) {
+    pal_source_data *pal_sdata = source_data->pal_sdata;
+    pa_memblock **slot;
+    unsigned depth, i;
+
+    /* one block per DSP buffer, so a full capture queue downstream still recycles */
+    depth = PA_CLAMP_UNLIKELY((unsigned)pal_sdata->buffer_count, 2U, PAL_SOURCE_POOL_DEPTH);
+    if (pal_sdata->pool_index >= depth)
+        pal_sdata->pool_index = 0;
+
+    for (i = 0; i < depth; i++) {
+        slot = &pal_sdata->pool[(pal_sdata->pool_index + i) % depth];
+
+        if (*slot && pa_memblock_ref_is_one(*slot) && pa_memblock_get_length(*slot) == pal_sdata->buffer_size) {
+            pal_sdata->pool_index = (pal_sdata->pool_index + i + 1) % depth;
+            return *slot;
+        }
+    }
+
+    slot = &pal_sdata->pool[pal_sdata->pool_index];
+    if (*slot)
+        pa_memblock_unref(*slot);
+
+    *slot = pa_memblock_new(source_data->pa_sdata->source->core->mempool, pal_sdata->buffer_size);
+    pal_sdata->pool_index = (pal_sdata->pool_index + 1) % depth;
+    pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_POOL_ALLOCS);
+
+    return *slot;
+}
+
+static void pa_pal_source_pool_free(pal_source_data *pal_sdata) {
+    unsigned i;
+
+    for (i = 0; i < PAL_SOURCE_POOL_DEPTH; i++) {
+        if (pal_sdata->pool[i]) {
+            pa_memblock_unref(pal_sdata->pool[i]);
+            pal_sdata->pool[i] = NULL;
+        }
+    }
+}
+
+/* Ultra low latency: post everything the DSP captured since the last wakeup,
+ * copied out of its buffer into pool blocks, then sleep for one burst. The
+ * DSP keeps looping over the buffer, frames older than all of it but the
+ * burst being captured have been overwritten and are skipped. While a device
+ * switch is muted silence is posted instead, so the position stays in sync. */
+static void pa_pal_source_mmap_capture(pa_pal_source_data *sdata) {
+    pal_source_data *pal_sdata = sdata->pal_sdata;
+    pa_source *source = sdata->pa_sdata->source;
+    struct pal_mmap_buffer *mmap_buffer = &pal_sdata->mmap_buffer;
+    size_t frame_size = pa_frame_size(&source->sample_spec);
+    uint64_t size, burst, avail, offset, frames;
+    pa_memchunk chunk;
+    void *data;
+
+    size = mmap_buffer->buffer_size_frames;
+    burst = PA_MAX(mmap_buffer->burst_size_frames, 1U);
+
+    if (pa_pal_util_get_mmap_frames(pal_sdata->stream_handle, &pal_sdata->mmap_position, &pal_sdata->mmap_written, false)) {
+        pa_log_debug("%s: mmap position unavailable", __func__);
+        goto sleep;
+    }
+
+    avail = (pal_sdata->mmap_written > pal_sdata->mmap_read) ? pal_sdata->mmap_written - pal_sdata->mmap_read : 0;
+    if (size > burst && avail > size - burst) {
+        if (!pal_sdata->overrun)
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_OVERRUNS);
+        pal_sdata->overrun = true;
+        pal_sdata->mmap_read = pal_sdata->mmap_written - (size - burst);
+        avail = size - burst;
+    } else if (avail) {
+        pal_sdata->overrun = false;
+    }
+
+    while (avail) {
+        offset = pal_sdata->mmap_read % size;
+        chunk.memblock = pa_pal_source_pool_get(sdata);
+        frames = PA_MIN(PA_MIN(avail, size - offset), pa_memblock_get_length(chunk.memblock) / frame_size);
+        if (!frames)
+            break;
+
+        chunk.index = 0;
+        chunk.length = frames * frame_size;
+        data = pa_memblock_acquire(chunk.memblock);
+        if (pa_atomic_load(&pal_sdata->switch_state) == PA_PAL_SWITCH_MUTED)
+            pa_silence_memory(data, chunk.length, &source->sample_spec);
+        else
+            memcpy(data, (uint8_t *)mmap_buffer->buffer + offset * frame_size, chunk.length);
+        pa_pal_source_switch_shape(sdata, data, chunk.length);
+
+        pa_pal_dump_slot_write(&pal_sdata->dump, data, chunk.length);
+
+        pa_memblock_release(chunk.memblock);
+        pa_source_post(source, &chunk);
+        pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_READS);
+
+        pal_sdata->mmap_read += frames;
+        pal_sdata->bytes_read += chunk.length;
+        avail -= frames;
+    }
+
+sleep:
+    pa_rtpoll_set_timer_relative(sdata->pa_sdata->rtpoll, pa_bytes_to_usec(burst * frame_size, &source->sample_spec));
+}
+
 static void pa_pal_source_thread_func(void *userdata) {
     pa_pal_source_data *source_data = (pa_pal_source_data *)userdata;
     pa_source_data *pa_sdata = NULL;
@@ -618,6 +902,8 @@ static void pa_pal_source_thread_func(void *userdata) {
 
     pa_log_debug("Source IO Thread starting up");
 
+    pa_pal_sched_apply(&pal_sdata->sched, pa_sdata->source->core, pa_sdata->source->name);
+
     pa_thread_mq_install(&pa_sdata->thread_mq);
 
     for (;;) {
@@ -631,44 +917,72 @@ static void pa_pal_source_thread_func(void *userdata) {
             void *data;
             struct pal_buffer in_buf;
 
+            if (pal_sdata->mmap) {
+                if (source_data->pal_source_opened && !pal_sdata->standby)
+                    pa_pal_source_mmap_capture(source_data);
+                goto idle;
+            }
+
             memset(&in_buf, 0, sizeof(struct pal_buffer));
 
-            chunk.memblock = pa_memblock_new(pa_sdata->source->core->mempool, pal_sdata->buffer_size);
+            chunk.memblock = pa_pal_source_pool_get(source_data);
             data = pa_memblock_acquire(chunk.memblock);
             chunk.length = pa_memblock_get_length(chunk.memblock);
             chunk.index = 0;
 
-            in_buf.buffer = data;
-            in_buf.size = chunk.length;
-
-            pa_mutex_lock(pal_sdata->mutex);
-            if (pal_sdata->source_event_id != PA_PAL_NO_EVENT) {
-                /* wait for response from ctrl thread */
-                pa_cond_wait(pal_sdata->cond_ctrl_thread, pal_sdata->mutex);
+            /* a converting source reads packed data aside and unpacks it into the block */
+            in_buf.buffer = pa_pal_source_read_buf(pal_sdata, data, chunk.length);
+            in_buf.size = pa_pal_source_pal_bytes(pal_sdata, chunk.length);
+
+            if (pa_atomic_load(&pal_sdata->switch_state) == PA_PAL_SWITCH_MUTED) {
+                /* stream is being rerouted, keep the clients fed at the capture rate without PAL */
+                pa_silence_memory(data, chunk.length, &pa_sdata->source->sample_spec);
+                pa_memblock_release(chunk.memblock);
+                pa_source_post(pa_sdata->source, &chunk);
+                pa_rtpoll_set_timer_relative(pa_sdata->rtpoll, pa_bytes_to_usec(chunk.length, &pa_sdata->source->sample_spec));
+                goto idle;
             }
+
+            pa_pal_lock_acquire(pal_sdata->lock);
             if (pal_sdata->stream_handle) {
-                if ((ret = pal_stream_read(pal_sdata->stream_handle, &in_buf)) <= 0) {
+                pa_usec_t read_start = pa_rtclock_now();
+
+                ret = pal_stream_read(pal_sdata->stream_handle, &in_buf);
+                pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_READ_US, pa_rtclock_now() - read_start);
+                pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_READS);
+
+                if (ret <= 0) {
                      pa_log_error("pal_stream_read failed, ret = %d", ret);
-                     pa_msleep(pa_bytes_to_usec(in_buf.size, &pa_sdata->source->sample_spec)/1000);
-                     ret = in_buf.size;
+                     pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_READ_ERRORS);
+                     pa_msleep(pa_bytes_to_usec(chunk.length, &pa_sdata->source->sample_spec)/1000);
+                     /* pooled blocks carry the previous capture, post silence instead */
+                     pa_silence_memory(data, chunk.length, &pa_sdata->source->sample_spec);
+                } else {
+                     chunk.length = pa_pal_source_unpack(pal_sdata, data, in_buf.buffer, (size_t)ret);
                 }
-                chunk.length = ret;
+                pal_sdata->bytes_read += chunk.length;
+                pa_pal_source_switch_shape(source_data, data, chunk.length);
+                pa_pal_dump_slot_write(&pal_sdata->dump, data, chunk.length);
+                pa_pal_lock_release(pal_sdata->lock);
+
+                pa_memblock_release(chunk.memblock);
+                /* source outputs take their own reference, the pool keeps ours */
+                pa_source_post(pa_sdata->source, &chunk);
+
+                pa_rtpoll_set_timer_absolute(pa_sdata->rtpoll, pa_rtclock_now());
+            } else {
+                pa_pal_lock_release(pal_sdata->lock);
+
+                /* no session to read from, pooled blocks carry the previous
+                 * capture: post silence at the capture rate instead */
+                pa_silence_memory(data, chunk.length, &pa_sdata->source->sample_spec);
+                pa_memblock_release(chunk.memblock);
+                pa_source_post(pa_sdata->source, &chunk);
+                pa_rtpoll_set_timer_relative(pa_sdata->rtpoll, pa_bytes_to_usec(chunk.length, &pa_sdata->source->sample_spec));
             }
-            pa_mutex_unlock(pal_sdata->mutex);
-
-#ifdef SOURCE_DUMP_ENABLED
-            pa_log_error(" chunk length %d chunk index %d in_buf.size %d ",chunk.length, chunk.index, ret);
-            if ((ret = write(pal_sdata->write_fd, in_buf.buffer, ret)) < 0)
-                    pa_log_error("write to fd failed %d", ret);
-#endif
-            /* FIXME: don't post if read fails */
-            pa_memblock_release(chunk.memblock);
-            pa_source_post(pa_sdata->source, &chunk);
-            pa_memblock_unref(chunk.memblock);
-
-            pa_rtpoll_set_timer_absolute(pa_sdata->rtpoll, pa_rtclock_now());
         }
 
+idle:
         /* nothing to do. Let's sleep */
         if ((ret = pa_rtpoll_run(pa_sdata->rtpoll)) < 0)
             goto fail;
@@ -687,33 +1001,56 @@ finish:
     pa_log_debug("Source IO Thread shutting down");
 }
 
+/* map the DSP buffer of a freshly opened ultra low latency session */
+static int pa_pal_source_mmap_open(pa_pal_source_data *sdata) {
+    pal_source_data *pal_sdata = sdata->pal_sdata;
+    struct pal_media_config *config = &pal_sdata->stream_attributes->in_media_config;
+    /* taken from the media config, a reconfigure opens before the source spec changes */
+    size_t frame_size = (config->bit_width / PA_BITS_PER_BYTE) * config->ch_info.channels;
+    int rc;
+
+    memset(&pal_sdata->mmap_buffer, 0, sizeof(pal_sdata->mmap_buffer));
+    rc = pal_stream_create_mmap_buffer(pal_sdata->stream_handle, (int32_t)(pal_sdata->buffer_size / frame_size),
+                                       &pal_sdata->mmap_buffer);
+    if (rc || !pal_sdata->mmap_buffer.buffer || !pal_sdata->mmap_buffer.buffer_size_frames) {
+        pa_log_error("pal_stream_create_mmap_buffer failed, error %d", rc);
+        return rc ? rc : -1;
+    }
+
+    pa_log_info("pal source mmap buffer of %d frames, burst %d frames", (int)pal_sdata->mmap_buffer.buffer_size_frames,
+                (int)pal_sdata->mmap_buffer.burst_size_frames);
+
+    return 0;
+}
+
 static int open_pal_source(pa_pal_source_data *sdata) {
     int rc;
-#ifdef SOURCE_DUMP_ENABLED
-    char *file_name;
-#endif
 
     pal_buffer_config_t out_buf_cfg, in_buf_cfg;
     pal_source_data *pal_sdata = NULL;
+    pa_pal_stream_key key;
 
     pa_assert(sdata);
     pa_assert(sdata->pal_sdata);
 
     pal_sdata = sdata->pal_sdata;
-#ifdef SOURCE_DUMP_ENABLED
-    file_name = pa_sprintf_malloc("/data/pcmdump_source_%d", pal_sdata->index);
-
-    pal_sdata->write_fd = open(file_name, O_RDWR | O_TRUNC | O_CREAT, S_IRWXU);
-    if(pal_sdata->write_fd < 0)
-        pa_log_error("Could not open write fd %d for source index %d", pal_sdata->write_fd, pal_sdata->index);
-
-    pa_xfree(file_name);
-#endif
 
     pa_log_debug("opening source with configuration flag = 0x%x, format %d, sample_rate %d",
                  pal_sdata->stream_attributes->type, pal_sdata->stream_attributes->in_media_config.aud_fmt_id,
                  pal_sdata->stream_attributes->in_media_config.sample_rate);
 
+    if (pal_sdata->stream_cache && !pal_sdata->mmap) {
+        pa_pal_stream_key_init(&key, pal_sdata->stream_attributes, false, pal_sdata->pal_device,
+                               pal_sdata->buffer_size, pal_sdata->buffer_count);
+        if ((pal_sdata->stream_handle = pa_pal_stream_cache_take(pal_sdata->stream_cache, &key))) {
+            pa_log_debug("pal source reusing cached stream %p", pal_sdata->stream_handle);
+            pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_CACHE_HITS);
+            rc = 0;
+            goto opened;
+        }
+        pa_pal_stats_inc(&pal_sdata->stats, PA_PAL_STATS_CACHE_MISSES);
+    }
+
     rc = pal_stream_open(pal_sdata->stream_attributes, 1, pal_sdata->pal_device, 0, NULL, NULL, 0,
                              &pal_sdata->stream_handle);
     if (rc) {
@@ -724,12 +1061,22 @@ static int open_pal_source(pa_pal_source_data *sdata) {
 
     pa_log_debug("pal source opened %p", pal_sdata->stream_handle);
 
+    if (pal_sdata->mmap) {
+        if ((rc = pa_pal_source_mmap_open(sdata))) {
+            /* not started and not cached yet, nothing else will close it */
+            pal_stream_close(pal_sdata->stream_handle);
+            pal_sdata->stream_handle = NULL;
+            goto fail;
+        }
+        goto opened;
+    }
+
     /* FIXME: Update it by calling pal_stream_get_buffer_size */
     pa_log_debug("buffer size is %zu, buffer count is %zu\n", pal_sdata->buffer_size, pal_sdata->buffer_count);
 
     out_buf_cfg.buf_size = 0;
     out_buf_cfg.buf_count = 0;
-    in_buf_cfg.buf_size = pal_sdata->buffer_size;
+    in_buf_cfg.buf_size = pa_pal_source_pal_bytes(pal_sdata, pal_sdata->buffer_size);
     in_buf_cfg.buf_count = pal_sdata->buffer_count;
 
     rc = pal_stream_set_buffer_size(pal_sdata->stream_handle, &in_buf_cfg, &out_buf_cfg);
@@ -737,6 +1084,9 @@ static int open_pal_source(pa_pal_source_data *sdata) {
         pa_log_error("pal_stream_set_buffer_size failed\n");
     }
 
+opened:
+    /* cached or new, the session may not have the volume ramp yet */
+    pa_pal_volume_reset(pal_sdata->volume);
     sdata->pal_source_opened = true;
 
 fail:
@@ -744,8 +1094,15 @@ fail:
 }
 
 static int close_pal_source(pa_pal_source_data *sdata) {
+    return release_pal_source(sdata, false);
+}
+
+/* Stop the session and close it, or with park keep the stopped stream in
+ * the stream cache for a later open with the same media config. */
+static int release_pal_source(pa_pal_source_data *sdata, bool park) {
     pal_source_data *pal_sdata;
     pa_source_data *pa_sdata;
+    pa_pal_stream_key key;
     int rc = -1;
 
     pa_assert(sdata);
@@ -756,9 +1113,9 @@ static int close_pal_source(pa_pal_source_data *sdata) {
     pa_sdata = sdata->pa_sdata;
 
     pa_assert(pal_sdata->stream_handle);
-    pa_mutex_lock(pal_sdata->mutex);
+    pa_pal_lock_acquire(pal_sdata->lock);
 
-    pa_log_debug("closing pal source %p", pal_sdata->stream_handle);
+    pa_log_debug("%s pal source %p", park ? "parking" : "closing", pal_sdata->stream_handle);
 
     if (PA_UNLIKELY(pal_sdata->stream_handle == NULL)) {
         pa_log_error("Invalid source handle %p", pal_sdata->stream_handle);
@@ -768,20 +1125,26 @@ static int close_pal_source(pa_pal_source_data *sdata) {
         if (PA_UNLIKELY(rc))
             pa_log_error(" pal_stream_stop failed for %p error  %d", pal_sdata->stream_handle, rc);
 
-        rc = pal_stream_close(pal_sdata->stream_handle);
-        if (PA_UNLIKELY(rc)) {
+        if (park && !rc) {
+            pa_pal_stream_key_init(&key, pal_sdata->stream_attributes, false, pal_sdata->pal_device,
+                                   pal_sdata->buffer_size, pal_sdata->buffer_count);
+            park = pa_pal_stream_cache_put(pal_sdata->stream_cache, &key, pal_sdata->stream_handle);
+        } else {
+            park = false;
+        }
+
+        if (!park && (rc = pal_stream_close(pal_sdata->stream_handle))) {
             pa_log_error(" could not close source handle %p, error  %d", pal_sdata->stream_handle, rc);
         }
 
         pal_sdata->stream_handle = NULL;
+        /* unmapped with the session */
+        memset(&pal_sdata->mmap_buffer, 0, sizeof(pal_sdata->mmap_buffer));
         pal_sdata->standby = true;
         sdata->pal_source_opened = false;
     }
 
-    pa_mutex_unlock(pal_sdata->mutex);
-#ifdef SOURCE_DUMP_ENABLED
-    close(pal_sdata->write_fd);
-#endif
+    pa_pal_lock_release(pal_sdata->lock);
 
     return rc;
 }
@@ -791,13 +1154,15 @@ static int restart_pal_source(pa_pal_source_data *sdata, pa_encoding_t encoding,
     pal_source_data *pal_sdata = NULL;
     pa_source_data *pa_sdata = NULL;
     pal_audio_fmt_t pal_format;
+    pa_usec_t start = pa_rtclock_now();
     pa_assert(sdata->pal_sdata);
     pa_assert(sdata->pa_sdata);
 
     pa_sdata = sdata->pa_sdata;
     pal_sdata = sdata->pal_sdata;
-    if (!pal_sdata->standby) {
-        rc = close_pal_source((pa_pal_source_data *)sdata->pal_sdata);
+    if (sdata->pal_source_opened) {
+        /* parked, switching back to this config later is a handle swap */
+        rc = release_pal_source(sdata, true);
         if (rc) {
             pa_log_error("close_pal_source failed, error %d", rc);
             goto exit;
@@ -809,7 +1174,11 @@ static int restart_pal_source(pa_pal_source_data *sdata, pa_encoding_t encoding,
         pa_log_error("%s: unsupported format", __func__);
         return -1;
     }
-    if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH){
+    if (pal_sdata->convert) {
+        /* ss is what PulseAudio is given, PAL always captures packed */
+        sdata->pal_sdata->stream_attributes->in_media_config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S24_3LE;
+        sdata->pal_sdata->stream_attributes->in_media_config.bit_width = 24;
+    } else if (pa_sdata->avoid_config_processing & PA_PAL_CARD_AVOID_PROCESSING_FOR_BIT_WIDTH){
        switch (ss->format) {
            case PA_SAMPLE_S32LE:
                sdata->pal_sdata->stream_attributes->in_media_config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S32_LE;
@@ -841,6 +1210,8 @@ static int restart_pal_source(pa_pal_source_data *sdata, pa_encoding_t encoding,
     rc = open_pal_source(sdata);
     if (rc) {
         pa_log_error("open_pal_source failed during recreation, error %d", rc);
+    } else {
+        pa_pal_stats_record(&pal_sdata->stats, PA_PAL_STATS_RECONFIG_US, pa_rtclock_now() - start);
     }
 
 exit:
@@ -850,6 +1221,9 @@ exit:
 static int free_pal_source(pal_source_data *pal_sdata) {
     int rc = 0;
 
+    /* a queued switch must not run against a freed source */
+    pa_pal_worker_free(pal_sdata->ctrl_worker);
+
     if (!pal_sdata->standby) {
         rc = close_pal_source((pa_pal_source_data *)pal_sdata);
         if (rc) {
@@ -857,8 +1231,12 @@ static int free_pal_source(pal_source_data *pal_sdata) {
         }
     }
 
-    pa_mutex_free(pal_sdata->mutex);
-    pa_cond_free(pal_sdata->cond_ctrl_thread);
+    pa_pal_source_pool_free(pal_sdata);
+    pa_xfree(pal_sdata->convert_buf);
+    pa_pal_stream_cache_free(pal_sdata->stream_cache);
+    pa_pal_dump_slot_set(&pal_sdata->dump, NULL);
+    pa_pal_lock_free(pal_sdata->lock);
+    pa_pal_volume_free(pal_sdata->volume);
     pa_xfree(pal_sdata->stream_attributes);
     pa_xfree(pal_sdata->pal_device);
     pa_xfree(pal_sdata);
@@ -872,7 +1250,6 @@ static int create_pal_source(pa_pal_source_config *source, pa_pal_card_port_devi
 
     sdata->pal_sdata = pa_xnew0(pal_source_data, 1);
 
-    sdata->pal_sdata->mutex = pa_mutex_new(false /* recursive  */, false /* inherit_priority */);
     rc = pa_pal_source_fill_info(source, sdata->pal_sdata, port_device_data);
     if (rc) {
         pa_log_error("pal source init failed, error %d", rc);
@@ -880,6 +1257,16 @@ static int create_pal_source(pa_pal_source_config *source, pa_pal_card_port_devi
         sdata->pal_sdata = NULL;
         return rc;
     }
+
+    /* created once nothing can fail, the error path above only frees pal_sdata */
+    sdata->pal_sdata->lock = pa_pal_lock_new(&sdata->pal_sdata->stats);
+    /* an MMAP session owns its mapping, it is never parked */
+    if (!sdata->pal_sdata->mmap)
+        sdata->pal_sdata->stream_cache = pa_pal_stream_cache_new(source->stream_cache_size);
+    sdata->pal_sdata->ctrl_worker = pa_pal_worker_new("pal-source-ctrl");
+    sdata->pal_sdata->volume = pa_pal_volume_new(PA_PAL_VOLUME_DEFAULT_RAMP_MS);
+    pa_atomic_store(&sdata->pal_sdata->switch_state, PA_PAL_SWITCH_IDLE);
+
     return rc;
 }
 
@@ -1098,6 +1485,7 @@ int pa_pal_source_create(pa_module *m, pa_card *card, const char *driver, const
     pa_pal_card_port_device_data *port_device_data;
 
     char ss_buf[PA_SAMPLE_SPEC_SNPRINT_MAX];
+    pa_sample_spec ss;
 
     void *state;
 
@@ -1141,7 +1529,12 @@ int pa_pal_source_create(pa_module *m, pa_card *card, const char *driver, const
         goto exit;
     }
 
-    rc = create_pa_source(m, source->name, source->description, source->formats, &source->default_spec, &source->default_map, source->use_hw_volume, source->alternate_sample_rate, card, source->avoid_config_processing, ports, driver, sdata);
+    /* a converting source posts its convert format */
+    ss = source->default_spec;
+    if (sdata->pal_sdata->convert)
+        ss.format = source->convert_format;
+
+    rc = create_pa_source(m, source->name, source->description, source->formats, &ss, &source->default_map, source->use_hw_volume, source->alternate_sample_rate, card, source->avoid_config_processing, ports, driver, sdata);
     pa_hashmap_free(ports);
     if (PA_UNLIKELY(rc)) {
         pa_log_error("Could not create pa source for source %s, error %d", source->name, rc);
@@ -1167,3 +1560,52 @@ void pa_pal_source_close(pa_pal_source_handle_t *handle) {
     free_pal_source(sdata->pal_sdata);
     pa_xfree(sdata);
 }
+
+/* main thread, s must belong to the pal card */
+char *pa_pal_source_get_stats(pa_source *s) {
+    pa_pal_source_data *sdata;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_source_data *)s->userdata);
+
+    if (!sdata->pal_sdata)
+        return NULL;
+
+    return pa_pal_stats_to_string(&sdata->pal_sdata->stats);
+}
+
+void pa_pal_source_update_stats_proplist(pa_source *s) {
+    pa_pal_source_data *sdata;
+    pa_proplist *p;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_source_data *)s->userdata);
+
+    if (!sdata->pal_sdata)
+        return;
+
+    p = pa_proplist_copy(s->proplist);
+    if (pa_pal_stats_to_proplist(&sdata->pal_sdata->stats, p))
+        pa_source_update_proplist(s, PA_UPDATE_REPLACE, p);
+    pa_proplist_free(p);
+}
+
+/* main thread, starts a PCM tap on s or stops it when path is NULL or empty */
+int pa_pal_source_set_dump(pa_source *s, const char *path) {
+    pa_pal_source_data *sdata;
+    pal_source_data *pal_sdata;
+    pa_pal_dump *dump = NULL;
+
+    pa_assert(s);
+    pa_assert_se(sdata = (pa_pal_source_data *)s->userdata);
+
+    if (!(pal_sdata = sdata->pal_sdata))
+        return -1;
+
+    if (path && *path && !(dump = pa_pal_dump_new(path, &s->sample_spec, true)))
+        return -1;
+
+    pa_pal_dump_slot_set(&pal_sdata->dump, dump);
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/strbuf.h>
+
+#include "pal-stats.h"
+
+static const char * const counter_names[PA_PAL_STATS_COUNTER_MAX] = {
+    [PA_PAL_STATS_WRITES] = "writes",
+    [PA_PAL_STATS_WRITE_ERRORS] = "write_errors",
+    [PA_PAL_STATS_PARTIAL_WRITES] = "partial_writes",
+    [PA_PAL_STATS_UNDERRUNS] = "underruns",
+    [PA_PAL_STATS_READS] = "reads",
+    [PA_PAL_STATS_READ_ERRORS] = "read_errors",
+    [PA_PAL_STATS_OVERRUNS] = "overruns",
+    [PA_PAL_STATS_POOL_ALLOCS] = "pool_allocs",
+    [PA_PAL_STATS_OPENS] = "opens",
+    [PA_PAL_STATS_CLOSES] = "closes",
+    [PA_PAL_STATS_WARM_STARTS] = "warm_starts",
+    [PA_PAL_STATS_CACHE_HITS] = "cache_hits",
+    [PA_PAL_STATS_CACHE_MISSES] = "cache_misses",
+    [PA_PAL_STATS_LATE_WRITES] = "late_writes",
+    [PA_PAL_STATS_BUFFER_RESIZES] = "buffer_resizes",
+    [PA_PAL_STATS_LOCK_CONTENDED] = "lock_contended",
+};
+
+static const char * const hist_names[PA_PAL_STATS_HIST_MAX] = {
+    [PA_PAL_STATS_WRITE_US] = "write_us",
+    [PA_PAL_STATS_READ_US] = "read_us",
+    [PA_PAL_STATS_WAIT_US] = "wait_us",
+    [PA_PAL_STATS_RENDER_LAG_US] = "render_lag_us",
+    [PA_PAL_STATS_START_US] = "start_us",
+    [PA_PAL_STATS_RECONFIG_US] = "reconfig_us",
+    [PA_PAL_STATS_SWITCH_US] = "switch_us",
+    [PA_PAL_STATS_LOCK_WAIT_US] = "lock_wait_us",
+    [PA_PAL_STATS_LOCK_HOLD_US] = "lock_hold_us",
+};
+
+static inline uint64_t stats_load(uint64_t *v) {
+    return __atomic_load_n(v, __ATOMIC_RELAXED);
+}
+
+static inline void stats_add(uint64_t *v, uint64_t n) {
+    __atomic_fetch_add(v, n, __ATOMIC_RELAXED);
+}
+
+static unsigned stats_bucket(uint64_t value_us) {
+    unsigned bucket = 0;
+
+    while (value_us && bucket < PA_PAL_STATS_HIST_BUCKETS - 1) {
+        value_us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void pa_pal_stats_inc(pa_pal_stats *stats, pa_pal_stats_counter_t counter) {
+    pa_assert(stats);
+    pa_assert(counter < PA_PAL_STATS_COUNTER_MAX);
+
+    stats_add(&stats->counters[counter], 1);
+}
+
+uint64_t pa_pal_stats_get(pa_pal_stats *stats, pa_pal_stats_counter_t counter) {
+    pa_assert(stats);
+    pa_assert(counter < PA_PAL_STATS_COUNTER_MAX);
+
+    return stats_load(&stats->counters[counter]);
+}
+
+void pa_pal_stats_record(pa_pal_stats *stats, pa_pal_stats_hist_t hist, uint64_t value_us) {
+    pa_pal_stats_hist *h;
+    uint64_t max;
+
+    pa_assert(stats);
+    pa_assert(hist < PA_PAL_STATS_HIST_MAX);
+
+    h = &stats->hist[hist];
+    stats_add(&h->buckets[stats_bucket(value_us)], 1);
+    stats_add(&h->sum, value_us);
+    stats_add(&h->count, 1);
+
+    /* the lock histograms are recorded from any thread, a failed exchange reloads max */
+    max = stats_load(&h->max);
+    while (value_us > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, value_us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void stats_hist_print(pa_strbuf *buf, pa_pal_stats_hist *h, uint64_t count) {
+    unsigned i, last = 0;
+
+    pa_strbuf_printf(buf, "count=%" PRIu64 ",avg=%" PRIu64 ",max=%" PRIu64 ",log2=", count,
+                     stats_load(&h->sum) / count, stats_load(&h->max));
+
+    for (i = 0; i < PA_PAL_STATS_HIST_BUCKETS; i++) {
+        if (stats_load(&h->buckets[i]))
+            last = i;
+    }
+
+    for (i = 0; i <= last; i++)
+        pa_strbuf_printf(buf, "%s%" PRIu64, i ? "/" : "", stats_load(&h->buckets[i]));
+}
+
+char *pa_pal_stats_to_string(pa_pal_stats *stats) {
+    pa_strbuf *buf;
+    uint64_t value;
+    unsigned i;
+
+    pa_assert(stats);
+
+    buf = pa_strbuf_new();
+
+    for (i = 0; i < PA_PAL_STATS_COUNTER_MAX; i++) {
+        if ((value = stats_load(&stats->counters[i])))
+            pa_strbuf_printf(buf, "%s=%" PRIu64 ";", counter_names[i], value);
+    }
+
+    for (i = 0; i < PA_PAL_STATS_HIST_MAX; i++) {
+        if (!(value = stats_load(&stats->hist[i].count)))
+            continue;
+
+        pa_strbuf_printf(buf, "%s=", hist_names[i]);
+        stats_hist_print(buf, &stats->hist[i], value);
+        pa_strbuf_puts(buf, ";");
+    }
+
+    return pa_strbuf_to_string_free(buf);
+}
+
+static bool stats_proplist_set(pa_proplist *p, const char *name, char *value) {
+    char *key = pa_sprintf_malloc(PA_PAL_STATS_PROP_PREFIX "%s", name);
+    const char *old = pa_proplist_gets(p, key);
+    bool changed = !old || !pa_streq(old, value);
+
+    if (changed)
+        pa_proplist_sets(p, key, value);
+
+    pa_xfree(key);
+    pa_xfree(value);
+
+    return changed;
+}
+
+bool pa_pal_stats_to_proplist(pa_pal_stats *stats, pa_proplist *p) {
+    pa_strbuf *buf;
+    uint64_t value;
+    bool changed = false;
+    unsigned i;
+
+    pa_assert(stats);
+    pa_assert(p);
+
+    for (i = 0; i < PA_PAL_STATS_COUNTER_MAX; i++) {
+        if ((value = stats_load(&stats->counters[i])))
+            changed |= stats_proplist_set(p, counter_names[i], pa_sprintf_malloc("%" PRIu64, value));
+    }
+
+    for (i = 0; i < PA_PAL_STATS_HIST_MAX; i++) {
+        if (!(value = stats_load(&stats->hist[i].count)))
+            continue;
+
+        buf = pa_strbuf_new();
+        stats_hist_print(buf, &stats->hist[i], value);
+        changed |= stats_proplist_set(p, hist_names[i], pa_strbuf_to_string_free(buf));
+    }
+
+    return changed;
+}
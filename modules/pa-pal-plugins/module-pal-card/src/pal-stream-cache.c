@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+
+#include "pal-stream-cache.h"
+
+/* more parked sessions than this would only hold DSP memory for nothing */
+#define PA_PAL_STREAM_CACHE_MAX_SIZE 4
+
+typedef struct {
+    pa_pal_stream_key key;
+    pal_stream_handle_t *handle;
+    uint64_t parked; /* LRU stamp */
+} pa_pal_stream_cache_entry;
+
+struct pa_pal_stream_cache {
+    pa_mutex *mutex;
+    unsigned size;
+    uint64_t stamp;
+    pa_pal_stream_cache_entry entries[PA_PAL_STREAM_CACHE_MAX_SIZE];
+};
+
+static void stream_cache_close(pal_stream_handle_t *handle) {
+    int rc;
+
+    if ((rc = pal_stream_close(handle)))
+        pa_log_error("%s: could not close cached stream %p, error %d", __func__, handle, rc);
+}
+
+pa_pal_stream_cache *pa_pal_stream_cache_new(unsigned size) {
+    pa_pal_stream_cache *c;
+
+    if (!size)
+        return NULL;
+
+    if (size > PA_PAL_STREAM_CACHE_MAX_SIZE) {
+        pa_log_info("%s: stream cache size %u clamped to %d", __func__, size, PA_PAL_STREAM_CACHE_MAX_SIZE);
+        size = PA_PAL_STREAM_CACHE_MAX_SIZE;
+    }
+
+    c = pa_xnew0(pa_pal_stream_cache, 1);
+    c->mutex = pa_mutex_new(false, true); /* taken by the I/O thread on open */
+    c->size = size;
+
+    return c;
+}
+
+void pa_pal_stream_cache_free(pa_pal_stream_cache *c) {
+    if (!c)
+        return;
+
+    pa_pal_stream_cache_clear(c);
+    pa_mutex_free(c->mutex);
+    pa_xfree(c);
+}
+
+void pa_pal_stream_key_init(pa_pal_stream_key *key, struct pal_stream_attributes *attr, bool playback,
+                            struct pal_device *device, size_t buffer_size, size_t buffer_count) {
+    struct pal_media_config *config;
+
+    pa_assert(key);
+    pa_assert(attr);
+    pa_assert(device);
+
+    config = playback ? &attr->out_media_config : &attr->in_media_config;
+
+    /* compared with memcmp, padding must be zero */
+    memset(key, 0, sizeof(*key));
+    key->type = attr->type;
+    key->aud_fmt_id = config->aud_fmt_id;
+    key->sample_rate = config->sample_rate;
+    key->bit_width = config->bit_width;
+    key->ch_info = config->ch_info;
+    key->device = device->id;
+    key->device_sample_rate = device->config.sample_rate;
+    key->device_bit_width = device->config.bit_width;
+    key->device_ch_info = device->config.ch_info;
+    pa_strlcpy(key->device_custom_key, device->custom_config.custom_key, sizeof(key->device_custom_key));
+    key->buffer_size = buffer_size;
+    key->buffer_count = buffer_count;
+}
+
+pal_stream_handle_t *pa_pal_stream_cache_take(pa_pal_stream_cache *c, const pa_pal_stream_key *key) {
+    pal_stream_handle_t *handle = NULL;
+    unsigned i;
+
+    if (!c)
+        return NULL;
+
+    pa_assert(key);
+
+    pa_mutex_lock(c->mutex);
+
+    for (i = 0; i < c->size; i++) {
+        if (c->entries[i].handle && !memcmp(&c->entries[i].key, key, sizeof(*key))) {
+            handle = c->entries[i].handle;
+            c->entries[i].handle = NULL;
+            break;
+        }
+    }
+
+    pa_mutex_unlock(c->mutex);
+
+    return handle;
+}
+
+bool pa_pal_stream_cache_put(pa_pal_stream_cache *c, const pa_pal_stream_key *key, pal_stream_handle_t *handle) {
+    pal_stream_handle_t *evicted = NULL;
+    pa_pal_stream_cache_entry *slot = NULL;
+    unsigned i;
+
+    if (!c)
+        return false;
+
+    pa_assert(key);
+    pa_assert(handle);
+
+    pa_mutex_lock(c->mutex);
+
+    /* a free slot, else the least recently parked one */
+    for (i = 0; i < c->size; i++) {
+        if (!c->entries[i].handle) {
+            slot = &c->entries[i];
+            break;
+        }
+        if (!slot || c->entries[i].parked < slot->parked)
+            slot = &c->entries[i];
+    }
+
+    evicted = slot->handle;
+    slot->key = *key;
+    slot->handle = handle;
+    slot->parked = ++c->stamp;
+
+    pa_mutex_unlock(c->mutex);
+
+    /* closed outside the lock, a take for another config need not wait for it */
+    if (evicted)
+        stream_cache_close(evicted);
+
+    return true;
+}
+
+void pa_pal_stream_cache_clear(pa_pal_stream_cache *c) {
+    pal_stream_handle_t *handles[PA_PAL_STREAM_CACHE_MAX_SIZE];
+    unsigned i, n = 0;
+
+    if (!c)
+        return;
+
+    pa_mutex_lock(c->mutex);
+
+    for (i = 0; i < c->size; i++) {
+        if (c->entries[i].handle)
+            handles[n++] = c->entries[i].handle;
+        c->entries[i].handle = NULL;
+    }
+
+    pa_mutex_unlock(c->mutex);
+
+    for (i = 0; i < n; i++)
+        stream_cache_close(handles[i]);
+}
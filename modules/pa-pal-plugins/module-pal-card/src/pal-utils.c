@@ -13,9 +13,11 @@
 #include <pulsecore/core-format.h>
 #include <pulse/channelmap.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <math.h>
 
 #include "pal-utils.h"
+#include "pal-clock.h"
 
 #define PA_PAL_SINK_PROP_FORMAT_FLAG    "stream-format"
 
@@ -315,10 +317,129 @@ bool pa_pal_channel_map_to_pal(pa_channel_map *pa_map, struct pal_channel_info *
     return true;
 }
 
+/* Query the stream position and project it to the current time. session_time
+ * is the raw DSP position, cur_session_time the position now, both in us. */
+int pa_pal_util_get_session_time(pal_stream_handle_t *handle, uint64_t *session_time, uint64_t *cur_session_time) {
+    int rc;
+    uint64_t cur_qtimer, abs_qtimer_time_stamp, session_time_stamp;
+    struct pal_session_time stime = {0};
+
+    rc = pal_get_timestamp(handle, &stime);
+    if (rc)
+        return rc;
+
+    abs_qtimer_time_stamp = (uint64_t)(((uint64_t)stime.absolute_time.value_msw << 32) | (uint64_t)stime.absolute_time.value_lsw);
+    session_time_stamp = (uint64_t)(((uint64_t)stime.session_time.value_msw << 32) | (uint64_t)stime.session_time.value_lsw);
+    cur_qtimer = pa_pal_clock_now_us();
+
+    if (session_time)
+        *session_time = session_time_stamp;
+
+    if (abs_qtimer_time_stamp > cur_qtimer) {
+        /* timestamp taken ahead of us, step back from it */
+        if (abs_qtimer_time_stamp - cur_qtimer < session_time_stamp)
+            *cur_session_time = session_time_stamp - (abs_qtimer_time_stamp - cur_qtimer);
+        else
+            *cur_session_time = 0;
+    } else {
+        *cur_session_time = session_time_stamp + (cur_qtimer - abs_qtimer_time_stamp);
+    }
+
+#ifdef PAL_UTILS_DEBUG
+    pa_log_debug("%s: abs_qtimer %" PRIu64 " us, session_time %" PRIu64 " us, qtimer %" PRIu64 " us, now %" PRIu64 " us",
+                 __func__, abs_qtimer_time_stamp, session_time_stamp, cur_qtimer, *cur_session_time);
+#endif
+
+    return 0;
+}
+
+/* Frames the DSP consumed (playback) or produced (capture) on an MMAP stream,
+ * unwrapped from PAL's 32 bit position. last holds the raw position seen by
+ * the previous call, reset only takes the current position as the base. */
+int pa_pal_util_get_mmap_frames(pal_stream_handle_t *handle, int32_t *last, uint64_t *frames, bool reset) {
+    struct pal_mmap_position position = {0};
+    int32_t delta;
+    int rc;
+
+    rc = pal_stream_get_mmap_position(handle, &position);
+    if (rc)
+        return rc;
+
+    /* the modular difference survives the wrap, a position going back is ignored */
+    delta = (int32_t)((uint32_t)position.position_frames - (uint32_t)*last);
+    if (!reset && delta > 0)
+        *frames += (uint64_t)delta;
+    if (reset || delta > 0)
+        *last = position.position_frames;
+
+    return 0;
+}
+
+bool pa_pal_util_ramp(void *dst, const void *src, size_t length, const pa_sample_spec *ss, bool up) {
+    size_t frame_size, frames, i;
+    unsigned c;
+    float gain, step;
+
+    pa_assert(dst);
+    pa_assert(src);
+    pa_assert(ss);
+
+    frame_size = pa_frame_size(ss);
+    frames = length / frame_size;
+    if (!frames)
+        return true;
+
+    step = 1.0f / (float)frames;
+    gain = up ? 0.0f : 1.0f;
+    if (!up)
+        step = -step;
+
+    for (i = 0; i < frames; i++, gain += step) {
+        for (c = 0; c < ss->channels; c++) {
+            size_t n = i * ss->channels + c;
+
+            switch (ss->format) {
+                case PA_SAMPLE_S16LE:
+                    ((int16_t *)dst)[n] = (int16_t)lrintf((float)((const int16_t *)src)[n] * gain);
+                    break;
+                case PA_SAMPLE_S32LE:
+                    ((int32_t *)dst)[n] = (int32_t)lrintf((float)((const int32_t *)src)[n] * gain);
+                    break;
+                case PA_SAMPLE_S24_32LE:
+                    /* 24 bit in the low bits, the top byte is padding */
+                    ((int32_t *)dst)[n] = (int32_t)lrintf((float)(int32_t)((uint32_t)((const int32_t *)src)[n] << 8) * gain) >> 8;
+                    break;
+                case PA_SAMPLE_S24LE: {
+                    const uint8_t *s = (const uint8_t *)src + n * 3;
+                    uint8_t *d = (uint8_t *)dst + n * 3;
+                    int32_t v = (int32_t)(((uint32_t)s[0] << 8) | ((uint32_t)s[1] << 16) | ((uint32_t)s[2] << 24)) >> 8;
+
+                    v = (int32_t)lrintf((float)v * gain);
+                    d[0] = (uint8_t)v;
+                    d[1] = (uint8_t)(v >> 8);
+                    d[2] = (uint8_t)(v >> 16);
+                    break;
+                }
+                case PA_SAMPLE_FLOAT32LE:
+                    ((float *)dst)[n] = ((const float *)src)[n] * gain;
+                    break;
+                default:
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 int pa_pal_set_volume(pal_stream_handle_t *handle, uint32_t num_channels, float value)
 {
     int32_t vol = 0, ret = 0;
-    struct pal_volume_data *pal_volume = NULL;
+    /* on the stack, loopback volume is set from the main thread */
+    union {
+        struct pal_volume_data data;
+        uint8_t buf[sizeof(struct pal_volume_data) + sizeof(struct pal_channel_vol_kv) * PA_CHANNELS_MAX];
+    } pal_volume;
 
     pa_log_debug("%s: volume to be set (%f)\n", __func__, value);
 
@@ -338,21 +459,16 @@ int pa_pal_set_volume(pal_stream_handle_t *handle, uint32_t num_channels, float
 
     pa_log_debug("Setting volume to %d \n", vol);
 
-    pal_volume = (struct pal_volume_data *)calloc(1, sizeof(struct pal_volume_data)
-            + (sizeof(struct pal_channel_vol_kv) * num_channels));
-    if (!pal_volume)
-        return -ENOMEM;
-
-    pal_volume->no_of_volpair = num_channels;
+    num_channels = PA_MIN(num_channels, (uint32_t)PA_CHANNELS_MAX);
+    pal_volume.data.no_of_volpair = num_channels;
     for (int i = 0; i < num_channels; i++) {
-        pal_volume->volume_pair[i].channel_mask = 0x03;
-        pal_volume->volume_pair[i].vol = value;
+        pal_volume.data.volume_pair[i].channel_mask = 0x03;
+        pal_volume.data.volume_pair[i].vol = value;
     }
-    ret = pal_stream_set_volume(handle, pal_volume);
+    ret = pal_stream_set_volume(handle, &pal_volume.data);
     if (ret)
         pa_log_error("%s failed: %d \n", __func__, ret);
 
-    free(pal_volume);
     pa_log_debug("%s: exit", __func__);
 
     return ret;
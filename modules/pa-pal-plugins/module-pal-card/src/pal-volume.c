@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulse/sample.h>
+#include <pulse/xmalloc.h>
+#include <pulsecore/atomic.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+
+#include "pal-volume.h"
+
+struct pa_pal_volume {
+    pa_mutex *mutex; /* guards the pending update, never held across PAL calls */
+    bool pending;
+    float gain;
+    uint32_t channels;
+    uint32_t channel_mask;
+
+    /* control worker only */
+    struct pal_volume_data *payload; /* room for PA_CHANNELS_MAX pairs */
+    pal_param_payload *ramp;
+    pa_atomic_t ramp_pending;
+};
+
+pa_pal_volume *pa_pal_volume_new(uint32_t ramp_ms) {
+    pa_pal_volume *v = pa_xnew0(pa_pal_volume, 1);
+    pal_vol_ctrl_ramp_param_t ramp_param;
+
+    v->mutex = pa_mutex_new(false, false);
+    v->payload = pa_xmalloc0(sizeof(struct pal_volume_data) + sizeof(struct pal_channel_vol_kv) * PA_CHANNELS_MAX);
+
+    if (ramp_ms) {
+        ramp_param.ramp_period_ms = ramp_ms;
+        v->ramp = pa_xmalloc0(sizeof(pal_param_payload) + sizeof(ramp_param));
+        v->ramp->payload_size = sizeof(ramp_param);
+        memcpy(v->ramp->payload, &ramp_param, sizeof(ramp_param));
+        pa_atomic_store(&v->ramp_pending, 1);
+    }
+
+    return v;
+}
+
+void pa_pal_volume_free(pa_pal_volume *v) {
+    pa_assert(v);
+
+    pa_xfree(v->ramp);
+    pa_xfree(v->payload);
+    pa_mutex_free(v->mutex);
+    pa_xfree(v);
+}
+
+void pa_pal_volume_set(pa_pal_volume *v, float gain, uint32_t channels, uint32_t channel_mask) {
+    pa_assert(v);
+
+    pa_mutex_lock(v->mutex);
+    v->gain = gain;
+    v->channels = PA_MIN(channels, (uint32_t)PA_CHANNELS_MAX);
+    v->channel_mask = channel_mask;
+    v->pending = true;
+    pa_mutex_unlock(v->mutex);
+}
+
+int pa_pal_volume_apply(pa_pal_volume *v, pal_stream_handle_t *handle) {
+    uint32_t i;
+    int rc;
+
+    pa_assert(v);
+    pa_assert(handle);
+
+    pa_mutex_lock(v->mutex);
+    if (!v->pending) {
+        pa_mutex_unlock(v->mutex);
+        return 0;
+    }
+
+    v->payload->no_of_volpair = v->channels;
+    for (i = 0; i < v->channels; i++) {
+        v->payload->volume_pair[i].channel_mask = v->channel_mask;
+        v->payload->volume_pair[i].vol = v->gain;
+    }
+    v->pending = false;
+    pa_mutex_unlock(v->mutex);
+
+    /* set once per session, the DSP keeps it for every later update */
+    if (v->ramp && pa_atomic_cmpxchg(&v->ramp_pending, 1, 0) &&
+            (rc = pal_stream_set_param(handle, PAL_PARAM_ID_VOLUME_CTRL_RAMP, v->ramp)))
+        pa_log_debug("%s: volume ramp not supported, error %d", __func__, rc);
+
+    if ((rc = pal_stream_set_volume(handle, v->payload)))
+        pa_log_error("%s: pal_stream_set_volume failed, error %d", __func__, rc);
+
+    return rc;
+}
+
+void pa_pal_volume_reset(pa_pal_volume *v) {
+    pa_assert(v);
+
+    if (v->ramp)
+        pa_atomic_store(&v->ramp_pending, 1);
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+#include <pulsecore/thread.h>
+
+#include "pal-worker.h"
+
+typedef struct pa_pal_worker_job pa_pal_worker_job;
+typedef struct pa_pal_worker_thread pa_pal_worker_thread;
+
+struct pa_pal_worker_job {
+    const void *key;
+    pa_pal_worker_cb_t cb;
+    void *userdata;
+    pa_pal_worker_job *next;
+};
+
+struct pa_pal_worker_thread {
+    pa_pal_worker *w;
+    pa_thread *thread;
+    bool busy;
+    const void *key; /* of the job it runs */
+};
+
+struct pa_pal_worker {
+    pa_pal_worker_thread *threads;
+    unsigned n_threads;
+    pa_pal_worker_cb_t init_cb;
+    void *init_userdata;
+    pa_mutex *mutex;
+    pa_cond *cond; /* queue changed or a job completed, always broadcast */
+    pa_pal_worker_job *head;
+    pa_pal_worker_job *tail;
+    unsigned running;
+    bool quit;
+};
+
+/* called with the mutex held */
+static bool key_running(pa_pal_worker *w, const void *key) {
+    unsigned i;
+
+    if (!key)
+        return false;
+
+    for (i = 0; i < w->n_threads; i++) {
+        if (w->threads[i].busy && w->threads[i].key == key)
+            return true;
+    }
+
+    return false;
+}
+
+static bool in_pool(pa_pal_worker *w) {
+    pa_thread *self = pa_thread_self();
+    unsigned i;
+
+    for (i = 0; i < w->n_threads; i++) {
+        if (w->threads[i].thread == self)
+            return true;
+    }
+
+    return false;
+}
+
+/* called with the mutex held, the oldest job no other thread runs the key of */
+static pa_pal_worker_job *take_job(pa_pal_worker *w) {
+    pa_pal_worker_job *job, *prev = NULL;
+
+    for (job = w->head; job; prev = job, job = job->next) {
+        if (key_running(w, job->key))
+            continue;
+
+        if (prev)
+            prev->next = job->next;
+        else
+            w->head = job->next;
+        if (w->tail == job)
+            w->tail = prev;
+
+        return job;
+    }
+
+    return NULL;
+}
+
+/* called with the mutex held */
+static void drop_jobs(pa_pal_worker *w, const void *key) {
+    pa_pal_worker_job *job, *prev = NULL, *next;
+
+    for (job = w->head; job; job = next) {
+        next = job->next;
+
+        if (job->key != key) {
+            prev = job;
+            continue;
+        }
+
+        if (prev)
+            prev->next = next;
+        else
+            w->head = next;
+        if (w->tail == job)
+            w->tail = prev;
+
+        pa_xfree(job);
+    }
+}
+
+static void worker_thread_func(void *userdata) {
+    pa_pal_worker_thread *t = userdata;
+    pa_pal_worker *w = t->w;
+    pa_pal_worker_job *job = NULL;
+
+    if (w->init_cb)
+        w->init_cb(w->init_userdata);
+
+    pa_mutex_lock(w->mutex);
+
+    for (;;) {
+        while (!w->quit && !(job = take_job(w)))
+            pa_cond_wait(w->cond, w->mutex);
+
+        if (w->quit)
+            break;
+
+        t->busy = true;
+        t->key = job->key;
+        w->running++;
+
+        pa_mutex_unlock(w->mutex);
+        job->cb(job->userdata);
+        pa_xfree(job);
+        pa_mutex_lock(w->mutex);
+
+        t->busy = false;
+        t->key = NULL;
+        w->running--;
+        pa_cond_signal(w->cond, 1);
+    }
+
+    pa_mutex_unlock(w->mutex);
+}
+
+pa_pal_worker *pa_pal_worker_new(const char *name) {
+    return pa_pal_worker_new_pool(name, 1, NULL, NULL);
+}
+
+pa_pal_worker *pa_pal_worker_new_pool(const char *name, unsigned n_threads, pa_pal_worker_cb_t init_cb,
+                                      void *init_userdata) {
+    pa_pal_worker *w;
+    char *thread_name;
+    unsigned i;
+
+    pa_assert(name);
+    pa_assert(n_threads > 0);
+
+    w = pa_xnew0(pa_pal_worker, 1);
+    w->threads = pa_xnew0(pa_pal_worker_thread, n_threads);
+    w->init_cb = init_cb;
+    w->init_userdata = init_userdata;
+    w->mutex = pa_mutex_new(false, false);
+    w->cond = pa_cond_new();
+
+    for (i = 0; i < n_threads; i++) {
+        thread_name = n_threads > 1 ? pa_sprintf_malloc("%s-%u", name, i) : pa_xstrdup(name);
+        w->threads[i].w = w;
+        w->threads[i].thread = pa_thread_new(thread_name, worker_thread_func, &w->threads[i]);
+        pa_xfree(thread_name);
+
+        if (!w->threads[i].thread) {
+            pa_log_error("%s: could not create %s thread %u", __func__, name, i);
+            pa_pal_worker_free(w);
+            return NULL;
+        }
+
+        pa_mutex_lock(w->mutex);
+        w->n_threads++;
+        pa_mutex_unlock(w->mutex);
+    }
+
+    return w;
+}
+
+void pa_pal_worker_free(pa_pal_worker *w) {
+    pa_pal_worker_job *job;
+    unsigned i;
+
+    if (!w)
+        return;
+
+    pa_mutex_lock(w->mutex);
+    w->quit = true;
+    pa_cond_signal(w->cond, 1);
+    pa_mutex_unlock(w->mutex);
+
+    for (i = 0; i < w->n_threads; i++)
+        pa_thread_free(w->threads[i].thread);
+
+    while ((job = w->head)) {
+        w->head = job->next;
+        pa_xfree(job);
+    }
+
+    pa_cond_free(w->cond);
+    pa_mutex_free(w->mutex);
+    pa_xfree(w->threads);
+    pa_xfree(w);
+}
+
+bool pa_pal_worker_post(pa_pal_worker *w, const void *key, pa_pal_worker_cb_t cb, void *userdata) {
+    pa_pal_worker_job *job;
+
+    pa_assert(cb);
+
+    if (!w)
+        return false;
+
+    pa_mutex_lock(w->mutex);
+
+    if (w->quit) {
+        pa_mutex_unlock(w->mutex);
+        return false;
+    }
+
+    if (key) {
+        for (job = w->head; job; job = job->next) {
+            if (job->key == key) {
+                job->cb = cb;
+                job->userdata = userdata;
+                pa_mutex_unlock(w->mutex);
+                return true;
+            }
+        }
+    }
+
+    job = pa_xnew0(pa_pal_worker_job, 1);
+    job->key = key;
+    job->cb = cb;
+    job->userdata = userdata;
+
+    if (w->tail)
+        w->tail->next = job;
+    else
+        w->head = job;
+    w->tail = job;
+
+    pa_cond_signal(w->cond, 1);
+    pa_mutex_unlock(w->mutex);
+
+    return true;
+}
+
+void pa_pal_worker_sync(pa_pal_worker *w) {
+    if (!w)
+        return;
+
+    pa_assert(!in_pool(w));
+
+    pa_mutex_lock(w->mutex);
+    while ((w->head || w->running) && !w->quit)
+        pa_cond_wait(w->cond, w->mutex);
+    pa_mutex_unlock(w->mutex);
+}
+
+void pa_pal_worker_cancel(pa_pal_worker *w, const void *key) {
+    unsigned i;
+
+    pa_assert(key);
+
+    if (!w)
+        return;
+
+    pa_mutex_lock(w->mutex);
+
+    for (i = 0; i < w->n_threads; i++)
+        pa_assert(w->threads[i].thread != pa_thread_self() || w->threads[i].key != key);
+
+    for (;;) {
+        drop_jobs(w, key);
+
+        if (!key_running(w, key))
+            break;
+
+        pa_cond_wait(w->cond, w->mutex);
+    }
+
+    pa_mutex_unlock(w->mutex);
+}
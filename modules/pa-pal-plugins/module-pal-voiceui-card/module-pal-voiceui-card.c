@@ -8,6 +8,18 @@
 #include <config.h>
 #endif
 
+/* F_GET_SEALS */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <pulsecore/core-error.h>
 #include <pulsecore/core-util.h>
 #include <pulsecore/dbus-util.h>
 #include <pulsecore/modargs.h>
@@ -19,14 +31,22 @@
 #include "PalApi.h"
 #include "PalDefs.h"
 #include "pal-voiceui-utils.h"
+#include "pal-sched.h"
+#include "pal-worker.h"
+#include "pal-voiceui-lab.h"
+#include "pal-voiceui-sm-cache.h"
 #include "agm/agm_api.h"
 
 #define OK 0
 #define PAL_DBUS_OBJECT_PATH_PREFIX "/org/pulseaudio/ext/qsthw"
 #define PAL_DBUS_MODULE_IFACE "org.PulseAudio.Ext.Qsthw"
 #define PAL_DBUS_SESSION_IFACE "org.PulseAudio.Ext.Qsthw.Session"
-#define PA_DBUS_PAL_MODULE_IFACE_VERSION 0x101
+#define PA_DBUS_PAL_MODULE_IFACE_VERSION 0x104
 #define MAX_ACD_NUMBER_OF_CONTEXT 10
+#define PAL_LAB_READ_CHUNK 3840 /* bytes per background lab read */
+#define PAL_MAX_PENDING_READS 8 /* RequestLabRead calls a client may keep outstanding */
+#define PAL_DEFAULT_READ_THREADS 2
+#define PAL_MAX_READ_THREADS 16
 
 PA_MODULE_AUTHOR("QTI");
 PA_MODULE_DESCRIPTION("pal voiceui card module");
@@ -38,6 +58,12 @@ static const uint8_t chmap[] = {PAL_CHMAP_CHANNEL_FL, PAL_CHMAP_CHANNEL_FR, PAL_
 
 static const char* const valid_modargs[] = {
     "module",
+    "sched_policy",
+    "rt_priority",
+    "cpu_affinity",
+    "lab_ring_size",
+    "read_threads",
+    "sm_cache_size",
     NULL,
 };
 
@@ -58,6 +84,12 @@ struct pal_voiceui_module_data {
     pa_pal_voiceui_hooks *pal;
     bool is_session_started;
     uint32_t session_id;
+    pa_pal_sched_config sched; /* read threads, applied only if configured */
+    bool sched_set;
+    uint32_t lab_ring_size;
+    uint32_t read_threads;
+    pa_pal_worker *read_pool; /* lab reads and stop buffering of every session, keyed by session */
+    pa_pal_voiceui_sm_cache *sm_cache; /* NULL if sm_cache_size is 0 */
 };
 
 struct pal_voiceui_session_data {
@@ -67,10 +99,16 @@ struct pal_voiceui_session_data {
     int thread_state;
     struct pal_buffer *read_buf;
     unsigned int read_bytes;
+    unsigned int pending_reads; /* queued requests while thread_state is PAL_THREAD_READ_QUEUED */
+    pa_pal_voiceui_lab *lab; /* NULL if memfd is not available */
+    bool lab_request; /* the queued read is served from lab by index, not as bytes */
+    bool capturing; /* reading lab into the ring since the last detection */
+    bool overrunning;
+    uint64_t overrun_bytes; /* dropped because the client fell behind, this capture */
+    unsigned int read_sequence;
+    void *discard; /* capture that does not fit in lab */
     bool recognition_started;
-    pa_thread *async_thread;
     pa_mutex *mutex;
-    pa_cond *cond;
     pal_stream_type_t type;
 };
 
@@ -81,7 +119,9 @@ struct pal_doa {
 };
 
 static int unload_sm(DBusConnection *conn, struct pal_voiceui_session_data *ses_data);
+static void session_work(void *userdata);
 static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void load_sound_model_fd(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void unload_sound_model(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void start_recognition(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void start_recognition_v2(DBusConnection *conn, DBusMessage *msg, void *userdata);
@@ -90,6 +130,9 @@ static void get_buffer_size(DBusConnection *conn, DBusMessage *msg, void *userda
 static void read_buffer(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void stop_buffering(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void request_read_buffer(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void get_lab_ring(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void request_lab_read(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void cancel_reads(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void get_param_data(DBusConnection *conn, DBusMessage *msg, void *userdata);
 static void get_interface_version(DBusConnection *conn, DBusMessage *msg, void *userdata);
 void pa__done(pa_module *m);
@@ -97,6 +140,7 @@ void pa__done(pa_module *m);
 enum module_handler_index {
     MODULE_HANDLER_LOAD_SOUND_MODEL,
     MODULE_HANDLER_GET_INTERFACE_VERSION,
+    MODULE_HANDLER_LOAD_SOUND_MODEL_FD,
     MODULE_HANDLER_MAX
 };
 
@@ -110,6 +154,9 @@ enum session_handler_index {
     SESSION_HANDLER_STOP_BUFFERING,
     SESSION_HANDLER_REQUEST_READ_BUFFER,
     SESSION_HANDLER_GET_PARAM_DATA,
+    SESSION_HANDLER_GET_LAB_RING,
+    SESSION_HANDLER_REQUEST_LAB_READ,
+    SESSION_HANDLER_CANCEL_READS,
     SESSION_HANDLER_MAX
 };
 
@@ -119,6 +166,13 @@ pa_dbus_arg_info load_sound_model_args[] = {
     {"object_path", "o","out"}
 };
 
+/* opaque_data is a memfd sealed against writes and shrinking */
+pa_dbus_arg_info load_sound_model_fd_args[] = {
+    {"sound_model", "((i(uuuu)(uqqqay)(uqqqay))a(uuauss))","in"},
+    {"opaque_data", "h", "in"},
+    {"object_path", "o","out"}
+};
+
 pa_dbus_arg_info unload_sound_model_args[] = {
 };
 
@@ -150,6 +204,19 @@ pa_dbus_arg_info request_read_buffer_args[] = {
     {"bytes", "u", "in"},
 };
 
+pa_dbus_arg_info get_lab_ring_args[] = {
+    {"fd", "h", "out"},
+    {"size", "u", "out"},
+};
+
+pa_dbus_arg_info request_lab_read_args[] = {
+    {"bytes", "u", "in"},
+    {"read_index", "t", "in"},
+};
+
+pa_dbus_arg_info cancel_reads_args[] = {
+};
+
 pa_dbus_arg_info get_param_data_args[] = {
     {"param", "s", "in"},
     {"payload", "ay", "out"},
@@ -174,6 +241,13 @@ pa_dbus_arg_info read_buffer_available_event_args[] = {
     {"read_buffer", "ay", NULL}
 };
 
+pa_dbus_arg_info lab_read_available_event_args[] = {
+    {"read_buffer_sequence", "u", NULL},
+    {"read_status", "i", NULL},
+    {"read_index", "t", NULL},
+    {"write_index", "t", NULL}
+};
+
 pa_dbus_arg_info stop_buffering_done_event_args[] = {
     {"status", "i", NULL},
 };
@@ -189,6 +263,11 @@ static pa_dbus_method_handler pal_voiceui_module_handlers[MODULE_HANDLER_MAX] =
         .arguments = get_interface_version_args,
         .n_arguments = sizeof(get_interface_version_args)/sizeof(pa_dbus_arg_info),
         .receive_cb = get_interface_version},
+    [MODULE_HANDLER_LOAD_SOUND_MODEL_FD] = {
+        .method_name = "LoadSoundModelFd",
+        .arguments = load_sound_model_fd_args,
+        .n_arguments = sizeof(load_sound_model_fd_args)/sizeof(pa_dbus_arg_info),
+        .receive_cb = load_sound_model_fd},
 };
 
 static pa_dbus_method_handler pal_voiceui_session_handlers[SESSION_HANDLER_MAX] = {
@@ -237,12 +316,28 @@ static pa_dbus_method_handler pal_voiceui_session_handlers[SESSION_HANDLER_MAX]
         .arguments = get_param_data_args,
         .n_arguments = sizeof(get_param_data_args)/sizeof(pa_dbus_arg_info),
         .receive_cb = get_param_data},
+    [SESSION_HANDLER_GET_LAB_RING] = {
+        .method_name = "GetLabRing",
+        .arguments = get_lab_ring_args,
+        .n_arguments = sizeof(get_lab_ring_args)/sizeof(pa_dbus_arg_info),
+        .receive_cb = get_lab_ring},
+    [SESSION_HANDLER_REQUEST_LAB_READ] = {
+        .method_name = "RequestLabRead",
+        .arguments = request_lab_read_args,
+        .n_arguments = sizeof(request_lab_read_args)/sizeof(pa_dbus_arg_info),
+        .receive_cb = request_lab_read},
+    [SESSION_HANDLER_CANCEL_READS] = {
+        .method_name = "CancelReads",
+        .arguments = cancel_reads_args,
+        .n_arguments = sizeof(cancel_reads_args)/sizeof(pa_dbus_arg_info),
+        .receive_cb = cancel_reads},
 };
 
 enum signal_index {
     SIGNAL_DETECTION_EVENT,
     SIGNAL_READ_BUFFER_AVAILABLE_EVENT,
     SIGNAL_STOP_BUFFERING_DONE_EVENT,
+    SIGNAL_LAB_READ_AVAILABLE_EVENT,
     SIGNAL_MAX
 };
 
@@ -259,6 +354,10 @@ static pa_dbus_signal_info det_event_signals[SIGNAL_MAX] = {
         .name = "StopBufferingDoneEvent",
         .arguments = stop_buffering_done_event_args,
         .n_arguments = sizeof(stop_buffering_done_event_args)/sizeof(pa_dbus_arg_info)},
+    [SIGNAL_LAB_READ_AVAILABLE_EVENT] = {
+        .name = "LabReadAvailableEvent",
+        .arguments = lab_read_available_event_args,
+        .n_arguments = sizeof(lab_read_available_event_args)/sizeof(pa_dbus_arg_info)},
 };
 
 static pa_dbus_interface_info module_interface_info = {
@@ -284,7 +383,8 @@ static pa_dbus_interface_info session_interface_info = {
 };
 
 static void signal_read_buffer_available(struct pal_voiceui_session_data *ses_data,
-                                         unsigned int read_buffer_sequence, int status) {
+                                         unsigned int read_buffer_sequence, int status,
+                                         const void *data, unsigned int bytes) {
     DBusMessage *message = NULL;
     DBusMessageIter arg_i, array_i;
 
@@ -300,14 +400,37 @@ static void signal_read_buffer_available(struct pal_voiceui_session_data *ses_da
     dbus_message_iter_append_basic(&arg_i, DBUS_TYPE_INT32, &status);
 
     dbus_message_iter_open_container(&arg_i, DBUS_TYPE_ARRAY, "y", &array_i);
-    dbus_message_iter_append_fixed_array(&array_i, DBUS_TYPE_BYTE,
-                                         &ses_data->read_buf->buffer, ses_data->read_bytes);
+    dbus_message_iter_append_fixed_array(&array_i, DBUS_TYPE_BYTE, &data, bytes);
     dbus_message_iter_close_container(&arg_i, &array_i);
 
     pa_dbus_protocol_send_signal(ses_data->common->dbus_protocol, message);
     dbus_message_unref(message);
 }
 
+/* the data itself is in the lab ring, only where it starts and ends is sent */
+static void signal_lab_read_available(struct pal_voiceui_session_data *ses_data,
+                                      unsigned int read_buffer_sequence, int status) {
+    DBusMessage *message = NULL;
+    dbus_uint64_t read_index = pa_pal_voiceui_lab_read_index(ses_data->lab);
+    dbus_uint64_t write_index = pa_pal_voiceui_lab_write_index(ses_data->lab);
+
+    pa_log_debug("Posting lab read available, seq %u, status %d, index %" PRIu64 "-%" PRIu64,
+                 read_buffer_sequence, status, (uint64_t)read_index, (uint64_t)write_index);
+
+    pa_assert_se(message = dbus_message_new_signal(ses_data->obj_path,
+            session_interface_info.name,
+            det_event_signals[SIGNAL_LAB_READ_AVAILABLE_EVENT].name));
+    pa_assert_se(dbus_message_append_args(message,
+                                          DBUS_TYPE_UINT32, &read_buffer_sequence,
+                                          DBUS_TYPE_INT32, &status,
+                                          DBUS_TYPE_UINT64, &read_index,
+                                          DBUS_TYPE_UINT64, &write_index,
+                                          DBUS_TYPE_INVALID));
+
+    pa_dbus_protocol_send_signal(ses_data->common->dbus_protocol, message);
+    dbus_message_unref(message);
+}
+
 static void pa_pal_fill_default_acd_stream_attributes(struct pal_stream_attributes *stream_attr,
                                                       uint32_t *no_of_devices,
                                                       struct pal_device *devices) {
@@ -382,81 +505,200 @@ static void signal_stop_buffering_done(struct pal_voiceui_session_data *ses_data
     dbus_message_unref(message);
 }
 
-static void async_thread_func(void *userdata) {
-    struct pal_voiceui_session_data *ses_data = (struct pal_voiceui_session_data *)userdata;
+/* called with the session mutex held, one queued request was answered */
+static void complete_read(struct pal_voiceui_session_data *ses_data) {
+    if (ses_data->pending_reads)
+        ses_data->pending_reads--;
+
+    if (!ses_data->pending_reads)
+        ses_data->thread_state = PAL_THREAD_IDLE;
+}
+
+/* called with the session mutex held, answers one queued read from the ring if it has data */
+static bool serve_lab_read(struct pal_voiceui_session_data *ses_data) {
+    size_t bytes = pa_pal_voiceui_lab_readable(ses_data->lab);
+
+    if (!bytes)
+        return false;
+
+    if (ses_data->lab_request) {
+        signal_lab_read_available(ses_data, ++ses_data->read_sequence, (int)PA_MIN(bytes, ses_data->read_bytes));
+    } else {
+        bytes = PA_MIN(bytes, ses_data->read_bytes);
+        signal_read_buffer_available(ses_data, ++ses_data->read_sequence, (int)bytes,
+                                     pa_pal_voiceui_lab_read_ptr(ses_data->lab), bytes);
+        pa_pal_voiceui_lab_consume(ses_data->lab, pa_pal_voiceui_lab_read_index(ses_data->lab) + bytes);
+    }
+
+    complete_read(ses_data);
+
+    return true;
+}
+
+/* called with the session mutex held, drops it around the PAL read */
+static void capture_lab_chunk(struct pal_voiceui_session_data *ses_data) {
     uint32_t sm_handle = ses_data->common->session_id;
-    unsigned int bytes = 0, read_buffer_sequence = 0;
-    int ret = 0;
+    struct pal_buffer buf;
+    uint32_t gen = pa_pal_voiceui_lab_flush_gen(ses_data->lab);
+    bool overrun;
+    int ret;
 
-    pa_log_debug("[%d]Starting Async Thread", sm_handle);
+    /* the DSP is drained even when the client falls behind, what does not fit is dropped */
+    memset(&buf, 0, sizeof(buf));
+    buf.size = PAL_LAB_READ_CHUNK;
+    overrun = pa_pal_voiceui_lab_writable(ses_data->lab) < buf.size;
+    buf.buffer = overrun ? ses_data->discard : pa_pal_voiceui_lab_write_ptr(ses_data->lab);
 
+    pa_mutex_unlock(ses_data->mutex);
+    ret = pal_stream_read(ses_data->ses_handle, &buf);
     pa_mutex_lock(ses_data->mutex);
-    while (ses_data->thread_state != PAL_THREAD_EXIT) {
-        pa_log_debug("[%d]Async Thread wait", sm_handle);
-        pa_cond_wait(ses_data->cond, ses_data->mutex);
-        pa_log_debug("[%d]Async Thread wakeup", sm_handle);
 
-        if (ses_data->thread_state == PAL_THREAD_STOP_BUFFERING) {
-            pa_mutex_unlock(ses_data->mutex);
-            pa_log_debug("[%d]Stop buffering", sm_handle);
+    /* a detection flushed the ring meanwhile, this is audio from before it */
+    if (gen != pa_pal_voiceui_lab_flush_gen(ses_data->lab)) {
+        pa_log_debug("[%d]Dropping %d bytes captured across a lab flush", sm_handle, ret);
+        return;
+    }
+
+    if (ret <= 0) {
+        pa_log_info("[%d]Lab capture stopped with %d, %" PRIu64 " bytes dropped", sm_handle, ret,
+                    ses_data->overrun_bytes);
+        ses_data->capturing = false;
+
+        if (ses_data->thread_state == PAL_THREAD_READ_QUEUED && !serve_lab_read(ses_data)) {
+            if (ses_data->lab_request)
+                signal_lab_read_available(ses_data, ++ses_data->read_sequence, -ENODATA);
+            else
+                signal_read_buffer_available(ses_data, ++ses_data->read_sequence, -ENODATA, NULL, 0);
+            complete_read(ses_data);
+        }
+        return;
+    }
 
-            if (ses_data->recognition_started) {
-                ret = pal_stream_stop(ses_data->ses_handle);
-                ses_data->recognition_started = false;
+    if (overrun) {
+        if (!ses_data->overrunning)
+            pa_log_warn("[%d]Lab ring full, dropping capture until the client reads", sm_handle);
+        ses_data->overrunning = true;
+        ses_data->overrun_bytes += (uint64_t)ret;
+    } else {
+        ses_data->overrunning = false;
+        pa_pal_voiceui_lab_produce(ses_data->lab, (size_t)ret);
+    }
 
-                if (ret)
-                    pa_log_debug("[%d]Stop buffering failed with error %d", sm_handle, ret);
-            }
+    if (ses_data->thread_state == PAL_THREAD_READ_QUEUED)
+        serve_lab_read(ses_data);
+}
 
-            pa_mutex_lock(ses_data->mutex);
-            signal_stop_buffering_done(ses_data, ret);
-        }
+/* called with the session mutex held */
+static void stop_lab_buffering(struct pal_voiceui_session_data *ses_data) {
+    uint32_t sm_handle = ses_data->common->session_id;
+    int ret = 0;
 
-        if (ses_data->thread_state != PAL_THREAD_READ_QUEUED)
-            continue;
+    ses_data->capturing = false;
+    pa_mutex_unlock(ses_data->mutex);
+    pa_log_debug("[%d]Stop buffering", sm_handle);
+
+    if (ses_data->recognition_started) {
+        ret = pal_stream_stop(ses_data->ses_handle);
+        ses_data->recognition_started = false;
+
+        if (ret)
+            pa_log_debug("[%d]Stop buffering failed with error %d", sm_handle, ret);
+    }
+
+    pa_mutex_lock(ses_data->mutex);
+    signal_stop_buffering_done(ses_data, ret);
+}
 
-        if (ses_data->read_buf == NULL || ses_data->read_bytes != bytes) {
-            if (ses_data->read_buf)
+/* called with the session mutex held, drops it around the PAL read */
+static void read_requested(struct pal_voiceui_session_data *ses_data) {
+    uint32_t sm_handle = ses_data->common->session_id;
+    struct pal_buffer lab_buf, *buf;
+    /* a flush bumps it, a read that straddles one is dropped */
+    uint32_t gen = ses_data->lab ? pa_pal_voiceui_lab_flush_gen(ses_data->lab) : 0;
+    int ret;
+
+    if (ses_data->lab_request) {
+        /* straight into the shared ring, never over what the client has not read yet */
+        memset(&lab_buf, 0, sizeof(lab_buf));
+        lab_buf.buffer = pa_pal_voiceui_lab_write_ptr(ses_data->lab);
+        lab_buf.size = PA_MIN(ses_data->read_bytes, pa_pal_voiceui_lab_writable(ses_data->lab));
+        buf = &lab_buf;
+    } else {
+        if (ses_data->read_buf == NULL || ses_data->read_buf->size != ses_data->read_bytes) {
+            if (ses_data->read_buf) {
+                pa_xfree(ses_data->read_buf->buffer);
                 pa_xfree(ses_data->read_buf);
+            }
             ses_data->read_buf = (struct pal_buffer *)pa_xmalloc0(sizeof(struct pal_buffer));
             ses_data->read_buf->buffer = pa_xmalloc0(ses_data->read_bytes);
             ses_data->read_buf->size = ses_data->read_bytes;
-            bytes = ses_data->read_bytes;
         }
+        buf = ses_data->read_buf;
+    }
 
-        pa_mutex_unlock(ses_data->mutex);
-        ret = pal_stream_read(ses_data->ses_handle, ses_data->read_buf);
+    pa_mutex_unlock(ses_data->mutex);
+    ret = buf->size ? pal_stream_read(ses_data->ses_handle, buf) : 0;
 
-        if (ret <= 0) {
-            ret = -ENODATA;
-            pa_log_debug("[%d]Read failed with error %d", sm_handle, ret);
-        }
+    if (ret <= 0) {
+        ret = buf->size ? -ENODATA : -ENOBUFS;
+        pa_log_debug("[%d]Read failed with error %d", sm_handle, ret);
+    }
+
+    pa_mutex_lock(ses_data->mutex);
 
-        pa_mutex_lock(ses_data->mutex);
+    if (buf == &lab_buf && ret > 0 && gen == pa_pal_voiceui_lab_flush_gen(ses_data->lab))
+        pa_pal_voiceui_lab_produce(ses_data->lab, (size_t)ret);
+
+    if (ses_data->thread_state == PAL_THREAD_READ_QUEUED) {
+        if (buf == &lab_buf)
+            signal_lab_read_available(ses_data, ++ses_data->read_sequence, ret);
+        else
+            signal_read_buffer_available(ses_data, ++ses_data->read_sequence, ret,
+                                         ses_data->read_buf->buffer, ses_data->read_bytes);
+        complete_read(ses_data);
+    } else if (ses_data->thread_state == PAL_THREAD_STOP_BUFFERING) {
+        stop_lab_buffering(ses_data);
+    }
+}
 
-        if (ses_data->thread_state == PAL_THREAD_READ_QUEUED) {
-            signal_read_buffer_available(ses_data, ++read_buffer_sequence, ret);
-            ses_data->thread_state = PAL_THREAD_IDLE;
-        } else if (ses_data->thread_state == PAL_THREAD_STOP_BUFFERING) {
-            pa_mutex_unlock(ses_data->mutex);
+/* called with the session mutex held, at most one step of a session is queued */
+static void schedule_session(struct pal_voiceui_session_data *ses_data) {
+    if (ses_data->thread_state != PAL_THREAD_EXIT)
+        pa_pal_worker_post(ses_data->common->read_pool, ses_data, session_work, ses_data);
+}
 
-            if (ses_data->recognition_started) {
-                ret = pal_stream_stop(ses_data->ses_handle);
-                ses_data->recognition_started = false;
+/*
+ * One step of a session on the read pool. A session with more to do queues
+ * itself again behind the others rather than keeping the thread, so a
+ * capturing session does not starve reads of the next one.
+ */
+static void session_work(void *userdata) {
+    struct pal_voiceui_session_data *ses_data = (struct pal_voiceui_session_data *)userdata;
 
-                if (ret)
-                    pa_log_debug("[%d]Stop buffering failed with error %d", sm_handle, ret);
-            }
+    pa_mutex_lock(ses_data->mutex);
 
-            pa_mutex_lock(ses_data->mutex);
-            signal_stop_buffering_done(ses_data, ret);
-        }
-    }
-    pa_xfree(ses_data->read_buf);
-    ses_data->read_buf = NULL;
+    if (ses_data->thread_state == PAL_THREAD_EXIT)
+        goto exit;
+
+    if (ses_data->thread_state == PAL_THREAD_STOP_BUFFERING)
+        stop_lab_buffering(ses_data);
+    else if (ses_data->capturing)
+        capture_lab_chunk(ses_data);
+    else if (ses_data->thread_state == PAL_THREAD_READ_QUEUED)
+        read_requested(ses_data);
+
+    if (ses_data->capturing || ses_data->thread_state == PAL_THREAD_READ_QUEUED)
+        schedule_session(ses_data);
+
+exit:
     pa_mutex_unlock(ses_data->mutex);
+}
+
+static void read_thread_init(void *userdata) {
+    struct pal_voiceui_module_data *m_data = (struct pal_voiceui_module_data *)userdata;
 
-    pa_log_debug("[%d]Exiting Async Thread", sm_handle);
+    if (m_data->sched_set)
+        pa_pal_sched_apply(&m_data->sched, m_data->module->core, "pal read thread");
 }
 
 /* As of now pal is not filling event and cookie data. Hence just a log */
@@ -503,7 +745,22 @@ static int32_t event_callback(pal_stream_handle_t *stream_handle, uint32_t event
 
     pa_log_info("Callback event received: %d", event->status);
 
-    ses_data->thread_state = PAL_THREAD_IDLE;
+    pa_mutex_lock(ses_data->mutex);
+    if (ses_data->thread_state != PAL_THREAD_EXIT) {
+        ses_data->thread_state = PAL_THREAD_IDLE;
+        ses_data->pending_reads = 0;
+    }
+
+    /* keep the DSP drained from now on, reads are then answered from the ring */
+    if (capture_available && ses_data->lab) {
+        pa_pal_voiceui_lab_flush(ses_data->lab);
+        ses_data->overrunning = false;
+        ses_data->overrun_bytes = 0;
+        ses_data->capturing = true;
+        schedule_session(ses_data);
+    }
+    pa_mutex_unlock(ses_data->mutex);
+
     pa_assert_se(message = dbus_message_new_signal(ses_data->obj_path,
             session_interface_info.name,
             det_event_signals[SIGNAL_DETECTION_EVENT].name));
@@ -736,12 +993,29 @@ static DBusHandlerResult disconnection_filter_cb(DBusConnection *conn,
 static int unload_sm(DBusConnection *conn, struct pal_voiceui_session_data *ses_data) {
     int status = 0;
 
+    /* nothing queues the session once it exits, a read in progress is waited for */
+    pa_mutex_lock(ses_data->mutex);
+    ses_data->thread_state = PAL_THREAD_EXIT;
+    pa_mutex_unlock(ses_data->mutex);
+    pa_pal_worker_cancel(ses_data->common->read_pool, ses_data);
+
     dbus_connection_remove_filter(conn, disconnection_filter_cb, ses_data);
     status = pal_stream_close(ses_data->ses_handle);
 
     pa_assert_se(pa_dbus_protocol_remove_interface(ses_data->common->dbus_protocol,
             ses_data->obj_path, session_interface_info.name) >= 0);
 
+    if (ses_data->lab)
+        pa_pal_voiceui_lab_free(ses_data->lab);
+
+    if (ses_data->read_buf) {
+        pa_xfree(ses_data->read_buf->buffer);
+        pa_xfree(ses_data->read_buf);
+    }
+
+    pa_xfree(ses_data->discard);
+    pa_mutex_free(ses_data->mutex);
+
     pa_xfree(ses_data->obj_path);
     pa_xfree(ses_data);
 
@@ -767,17 +1041,113 @@ static void request_read_buffer(DBusConnection *conn, DBusMessage *msg, void *us
     }
 
     pa_mutex_lock(ses_data->mutex);
-    if (bytes == 0 || ses_data->async_thread == NULL ||
-        ses_data->thread_state != PAL_THREAD_IDLE) {
+    if (bytes == 0 || ses_data->thread_state != PAL_THREAD_IDLE) {
         pa_mutex_unlock(ses_data->mutex);
         pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "request_read_buffer failed");
         dbus_error_free(&error);
         return;
     }
 
+    ses_data->read_bytes = bytes;
+    ses_data->lab_request = false;
+    ses_data->pending_reads = 1;
     ses_data->thread_state = PAL_THREAD_READ_QUEUED;
+    if (!ses_data->capturing || !serve_lab_read(ses_data))
+        schedule_session(ses_data);
+    pa_mutex_unlock(ses_data->mutex);
+
+    pa_dbus_send_empty_reply(conn, msg);
+}
+
+static void get_lab_ring(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    struct pal_voiceui_session_data *ses_data = (struct pal_voiceui_session_data *)userdata;
+    DBusMessage *reply = NULL;
+    dbus_uint32_t size;
+    int fd;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(userdata);
+
+    if (!dbus_connection_can_send_type(conn, DBUS_TYPE_UNIX_FD)) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_NOT_SUPPORTED, "connection cannot pass file descriptors");
+        return;
+    }
+
+    if (!ses_data->lab) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "get_lab_ring failed");
+        return;
+    }
+
+    fd = pa_pal_voiceui_lab_fd(ses_data->lab);
+    size = (dbus_uint32_t)pa_pal_voiceui_lab_size(ses_data->lab);
+
+    /* libdbus sends a dup of fd, the ring keeps its own */
+    pa_assert_se((reply = dbus_message_new_method_return(msg)));
+    pa_assert_se(dbus_message_append_args(reply,
+                                          DBUS_TYPE_UNIX_FD, &fd,
+                                          DBUS_TYPE_UINT32, &size,
+                                          DBUS_TYPE_INVALID));
+    pa_assert_se(dbus_connection_send(conn, reply, NULL));
+    dbus_message_unref(reply);
+}
+
+static void request_lab_read(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    struct pal_voiceui_session_data *ses_data = (struct pal_voiceui_session_data *)userdata;
+    dbus_uint64_t read_index;
+    unsigned int bytes;
+    DBusError error;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(userdata);
+
+    dbus_error_init(&error);
+
+    if (!dbus_message_get_args(msg, &error, DBUS_TYPE_UINT32, &bytes,
+                               DBUS_TYPE_UINT64, &read_index, DBUS_TYPE_INVALID)) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "%s", error.message);
+        dbus_error_free(&error);
+        return;
+    }
+
+    /* lab requests may be pipelined, each answer reports everything written so far */
+    pa_mutex_lock(ses_data->mutex);
+    if (bytes == 0 || ses_data->lab == NULL ||
+        (ses_data->thread_state != PAL_THREAD_IDLE &&
+         (ses_data->thread_state != PAL_THREAD_READ_QUEUED || !ses_data->lab_request ||
+          ses_data->pending_reads >= PAL_MAX_PENDING_READS)) ||
+        pa_pal_voiceui_lab_consume(ses_data->lab, read_index) < 0) {
+        pa_mutex_unlock(ses_data->mutex);
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "request_lab_read failed");
+        return;
+    }
+
     ses_data->read_bytes = bytes;
-    pa_cond_signal(ses_data->cond, 0);
+    ses_data->lab_request = true;
+    ses_data->pending_reads++;
+    ses_data->thread_state = PAL_THREAD_READ_QUEUED;
+    if (!ses_data->capturing || !serve_lab_read(ses_data))
+        schedule_session(ses_data);
+    pa_mutex_unlock(ses_data->mutex);
+
+    pa_dbus_send_empty_reply(conn, msg);
+}
+
+/* drops every queued read request, a read already in PAL is not answered */
+static void cancel_reads(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    struct pal_voiceui_session_data *ses_data = (struct pal_voiceui_session_data *)userdata;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(userdata);
+
+    pa_mutex_lock(ses_data->mutex);
+    if (ses_data->thread_state == PAL_THREAD_READ_QUEUED) {
+        pa_log_debug("[%d]Cancelling %u queued reads", ses_data->common->session_id, ses_data->pending_reads);
+        ses_data->pending_reads = 0;
+        ses_data->thread_state = PAL_THREAD_IDLE;
+    }
     pa_mutex_unlock(ses_data->mutex);
 
     pa_dbus_send_empty_reply(conn, msg);
@@ -803,13 +1173,15 @@ static void stop_buffering(DBusConnection *conn, DBusMessage *msg, void *userdat
     }
 
     if (status) {
+        pa_mutex_unlock(ses_data->mutex);
         pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "stop_buffering failed");
         dbus_error_free(&error);
         return;
     }
 
     ses_data->thread_state = PAL_THREAD_STOP_BUFFERING;
-    pa_cond_signal(ses_data->cond, 0);
+    ses_data->pending_reads = 0;
+    schedule_session(ses_data);
     pa_mutex_unlock(ses_data->mutex);
 
     pa_dbus_send_empty_reply(conn, msg);
@@ -870,7 +1242,7 @@ static void get_buffer_size(DBusConnection *conn, DBusMessage *msg, void *userda
     dbus_error_init(&error);
 
     pa_log_debug("get buffer size");
-    buffer_size = 3840; /* Fixme: Modify this once pal_stream_get_buffer_size is implemented */
+    buffer_size = PAL_LAB_READ_CHUNK; /* Fixme: Modify this once pal_stream_get_buffer_size is implemented */
 
     pa_dbus_send_basic_value_reply(conn, msg, DBUS_TYPE_INT32, &buffer_size);
 }
@@ -1144,12 +1516,6 @@ static void unload_sound_model(DBusConnection *conn, DBusMessage *msg, void *use
 
     dbus_error_init(&error);
 
-    ses_data->thread_state = PAL_THREAD_EXIT;
-    pa_cond_signal(ses_data->cond, 0);
-    pa_thread_free(ses_data->async_thread);
-    pa_cond_free(ses_data->cond);
-    pa_mutex_free(ses_data->mutex);
-
     status = unload_sm(conn, ses_data);
     if (status != 0) {
         pa_log_error("pal stream close failed\n");
@@ -1161,22 +1527,28 @@ static void unload_sound_model(DBusConnection *conn, DBusMessage *msg, void *use
     pa_dbus_send_empty_reply(conn, msg);
 }
 
-/* implementations exposed by module global object path */
-/* Call pal_stream_open followed by pal_stream_set_param for loading sound model */
-static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userdata) {
-    struct pal_voiceui_module_data *m_data = userdata;
+/*
+ * Call pal_stream_open followed by pal_stream_set_param for loading sound model.
+ * data is the opaque model data, from the message or mapped from the client's
+ * sealed memfd fd, -1 for the message.
+ */
+static void load_sm(DBusConnection *conn, DBusMessage *msg, struct pal_voiceui_module_data *m_data,
+                    const void *data, uint32_t data_size, int fd) {
     struct pal_stream_attributes *stream_attr = NULL;
     struct pal_voiceui_session_data *ses_data = NULL;
-    pal_param_payload *prm_payload = NULL;
-    struct pal_st_phrase_sound_model phrase_sound_model = {0, };
-    struct pal_st_phrase_sound_model *p_sound_model = NULL;
+    pal_param_payload *prm_payload = NULL, *own_payload = NULL;
+    struct pal_st_phrase_sound_model phrase_sound_model;
     struct pal_st_sound_model *common_sound_model = &phrase_sound_model.common;
+    const void *header = NULL;
+    size_t header_size = 0;
+    bool cached = false;
     pal_stream_handle_t *stream_handle = NULL;
     DBusError error;
     DBusMessageIter arg_i, struct_i, struct_ii, struct_iii, array_i, sub_array_i;
-    dbus_int32_t sm_type, sm_data_size, i, j, status = 0;
+    dbus_int32_t sm_type, i, j, status = 0;
     int n_elements = 0, arg_type;
-    char *value = NULL, *thread_name = NULL;
+    char *value = NULL, *lab_name = NULL;
+    const char *str;
     char **addr_value = &value;
     uint32_t no_of_devices = 0;
     struct pal_device *devices = NULL;
@@ -1185,28 +1557,14 @@ static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userd
     struct modifier_kv *modifiers = NULL;
     int rc = 0;
 
-    pa_assert(conn);
-    pa_assert(msg);
-    pa_assert(userdata);
-
     dbus_error_init(&error);
-    if (!dbus_message_iter_init(msg, &arg_i)) {
-        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
-            "load_sound_model has no arguments");
-        dbus_error_free(&error);
-        return;
-    }
-
-    if (!pa_streq(dbus_message_get_signature(msg),
-                 "((i(uuuu)(uqqqay)(uqqqay))a(uuauss))ay")) {
-        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
-            "Invalid signature for load_sound_model");
-        dbus_error_free(&error);
-        return;
-    }
+    pa_assert_se(dbus_message_iter_init(msg, &arg_i));
 
     pa_log_debug("load sound model");
 
+    /* zeroed padding included, the header is part of what the cache compares */
+    memset(&phrase_sound_model, 0, sizeof(phrase_sound_model));
+
     stream_attr = pa_xnew0(struct pal_stream_attributes, 1);
     stream_ch_info = pa_xnew0(struct pal_channel_info, 1);
     memcpy(&stream_attr->in_media_config.ch_info, stream_ch_info, sizeof(struct pal_channel_info));
@@ -1270,7 +1628,7 @@ static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userd
     memcpy(&common_sound_model->vendor_uuid.node[0], value, n_elements);
 
     ses_data = pa_xnew0(struct pal_voiceui_session_data, 1);
-    ses_data->common = (struct pal_voiceui_module_data *)userdata;
+    ses_data->common = m_data;
     ses_data->type = stream_attr->type;
 
     rc = pal_stream_open(stream_attr, no_of_devices, devices, no_of_modifiers, modifiers, event_callback, (uint64_t)ses_data, &stream_handle);
@@ -1312,50 +1670,41 @@ static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userd
                 j++;
                 dbus_message_iter_next(&sub_array_i);
             }
+            /* the strings are copied, not their pointers into the message */
             dbus_message_iter_next(&struct_ii);
-            dbus_message_iter_get_basic(&struct_ii,
-                &phrase_sound_model.phrases[i].locale);
+            dbus_message_iter_get_basic(&struct_ii, &str);
+            pa_strlcpy(phrase_sound_model.phrases[i].locale, str, sizeof(phrase_sound_model.phrases[i].locale));
             dbus_message_iter_next(&struct_ii);
-            dbus_message_iter_get_basic(&struct_ii,
-                &phrase_sound_model.phrases[i].text);
+            dbus_message_iter_get_basic(&struct_ii, &str);
+            pa_strlcpy(phrase_sound_model.phrases[i].text, str, sizeof(phrase_sound_model.phrases[i].text));
             phrase_sound_model.num_phrases++;
             i++;
             dbus_message_iter_next(&array_i);
         }
 
-        /* read opaque data into sound model structure */
-        dbus_message_iter_next(&arg_i);
-        dbus_message_iter_recurse(&arg_i, &array_i);
-        dbus_message_iter_get_fixed_array(&array_i, addr_value, &n_elements);
-        common_sound_model->data_size = n_elements;
-        sm_data_size = sizeof(phrase_sound_model) + common_sound_model->data_size;
-        /* Fill parsed info into param payload */
-        prm_payload = (pal_param_payload *)pa_xmalloc0(sizeof(pal_param_payload) + sm_data_size);
-        prm_payload->payload_size = sizeof(pal_param_payload) + sm_data_size;
-        p_sound_model = (struct pal_st_phrase_sound_model *) prm_payload->payload;
-        memcpy(p_sound_model, &phrase_sound_model, sizeof(phrase_sound_model));
-        memcpy((char*)p_sound_model + common_sound_model->data_offset, value,
-               common_sound_model->data_size);
+        common_sound_model->data_size = data_size;
+        header = &phrase_sound_model;
+        header_size = sizeof(phrase_sound_model);
     } else if (sm_type == PAL_SOUND_MODEL_TYPE_GENERIC) {
+        /* phrase related fields are skipped */
         common_sound_model->data_offset = sizeof(struct pal_st_sound_model);
-        /*skip phrase related fields */
-        dbus_message_iter_next(&arg_i);
-        dbus_message_iter_recurse(&arg_i, &array_i);
-        dbus_message_iter_get_fixed_array(&array_i, addr_value, &n_elements);
-        sm_data_size = sizeof(struct pal_st_sound_model) + n_elements;
-        prm_payload = (pal_param_payload *)pa_xmalloc0(sizeof(pal_param_payload) + sm_data_size);
-        prm_payload->payload_size = sizeof(pal_param_payload) + sm_data_size;
-        common_sound_model = (struct pal_st_sound_model *) prm_payload->payload;
-        common_sound_model->data_size = n_elements;
-        memcpy((char*)common_sound_model + common_sound_model->data_offset,
-               value, common_sound_model->data_size);
+        common_sound_model->data_size = data_size;
+        header = common_sound_model;
+        header_size = sizeof(struct pal_st_sound_model);
     }
 
+    /* Fill parsed info into param payload, or reuse the one built for the same memfd before */
+    if (header && fd >= 0 && m_data->sm_cache)
+        prm_payload = pa_pal_voiceui_sm_cache_get(m_data->sm_cache, fd, header, header_size, data, data_size, &cached);
+    if (header && !prm_payload)
+        prm_payload = own_payload = pa_pal_voiceui_sm_payload_new(header, header_size, data, data_size);
+
+    pa_log_info("%s: sound model of %u bytes%s", __func__, data_size, cached ? ", cached" : "");
+
     status = pal_stream_set_param(stream_handle, PAL_PARAM_ID_LOAD_SOUND_MODEL, prm_payload);
 
-    pa_xfree(prm_payload);
+    pa_xfree(own_payload);
     prm_payload = NULL;
-    p_sound_model = NULL;
     common_sound_model = NULL;
     if (status != 0) {
         free(ses_data);
@@ -1370,16 +1719,18 @@ static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userd
     ses_data->ses_handle = stream_handle;
     ses_data->obj_path = pa_sprintf_malloc("%s/ses_%d", m_data->obj_path, ses_data->common->session_id);
     ses_data->mutex = pa_mutex_new(false /* recursive  */, false /* inherit_priority */);
-    ses_data->cond = pa_cond_new();
     ses_data->thread_state = PAL_THREAD_IDLE;
     ses_data->read_buf = NULL;
+    ses_data->lab_request = false;
+    ses_data->capturing = false;
     ses_data->recognition_started = false;
 
-    thread_name = pa_sprintf_malloc("pal read thread%d", ses_data->common->session_id);
-
-    if (!(ses_data->async_thread = pa_thread_new(thread_name, async_thread_func, ses_data)))
-        pa_log_error("%s: pal read thread creation failed", __func__);
-    pa_xfree(thread_name);
+    lab_name = pa_sprintf_malloc("pal-lab-%d", ses_data->common->session_id);
+    if (!(ses_data->lab = pa_pal_voiceui_lab_new(lab_name, ses_data->common->lab_ring_size)))
+        pa_log_warn("%s: no lab ring, lab is read on request only", __func__);
+    else
+        ses_data->discard = pa_xmalloc(PAL_LAB_READ_CHUNK);
+    pa_xfree(lab_name);
 
     pa_assert_se(pa_dbus_protocol_add_interface(ses_data->common->dbus_protocol,
             ses_data->obj_path, &session_interface_info, ses_data) >= 0);
@@ -1389,9 +1740,156 @@ static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userd
     pa_dbus_send_basic_value_reply(conn, msg, DBUS_TYPE_OBJECT_PATH, &ses_data->obj_path);
 }
 
+/* implementations exposed by module global object path */
+static void load_sound_model(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    DBusMessageIter arg_i, array_i;
+    const char *value = NULL;
+    int n_elements = 0;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(userdata);
+
+    if (!dbus_message_iter_init(msg, &arg_i)) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
+            "load_sound_model has no arguments");
+        return;
+    }
+
+    if (!pa_streq(dbus_message_get_signature(msg),
+                 "((i(uuuu)(uqqqay)(uqqqay))a(uuauss))ay")) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
+            "Invalid signature for load_sound_model");
+        return;
+    }
+
+    /* read opaque data, it stays in the message */
+    dbus_message_iter_next(&arg_i);
+    dbus_message_iter_recurse(&arg_i, &array_i);
+    dbus_message_iter_get_fixed_array(&array_i, &value, &n_elements);
+
+    load_sm(conn, msg, userdata, value, (uint32_t)n_elements, -1);
+}
+
+/* as load_sound_model, the opaque data is mapped from the client's memfd instead of sent in the message */
+static void load_sound_model_fd(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    DBusMessageIter arg_i;
+    struct stat st;
+    void *data = NULL;
+    int fd = -1, seals;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(userdata);
+
+    if (!dbus_message_iter_init(msg, &arg_i) ||
+            !pa_streq(dbus_message_get_signature(msg), "((i(uuuu)(uqqqay)(uqqqay))a(uuauss))h")) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
+            "Invalid signature for load_sound_model_fd");
+        return;
+    }
+
+    /* libdbus hands out a dup of the fd, closed when done */
+    dbus_message_iter_next(&arg_i);
+    dbus_message_iter_get_basic(&arg_i, &fd);
+
+    /* the client must not be able to change the model while it is copied or cached */
+    if (fd < 0 || (seals = fcntl(fd, F_GET_SEALS)) < 0 ||
+            (seals & (F_SEAL_WRITE | F_SEAL_SHRINK)) != (F_SEAL_WRITE | F_SEAL_SHRINK)) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS,
+            "opaque_data must be a memfd sealed against writes and shrinking");
+        goto exit;
+    }
+
+    if (fstat(fd, &st) < 0 || (uint64_t)st.st_size > UINT32_MAX) {
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_INVALID_ARGS, "Invalid opaque_data size");
+        goto exit;
+    }
+
+    if (st.st_size && (data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        data = NULL;
+        pa_dbus_send_error(conn, msg, DBUS_ERROR_FAILED, "Could not map opaque_data: %s", pa_cstrerror(errno));
+        goto exit;
+    }
+
+    load_sm(conn, msg, userdata, data, (uint32_t)st.st_size, fd);
+
+exit:
+    if (data)
+        munmap(data, (size_t)st.st_size);
+    if (fd >= 0)
+        close(fd);
+}
+
+static int parse_sched_modargs(pa_modargs *ma, pa_pal_sched_config *sched, bool *set) {
+    const char *value;
+
+    if ((value = pa_modargs_get_value(ma, "sched_policy", NULL))) {
+        if (pa_pal_sched_parse_policy(value, &sched->policy) < 0) {
+            pa_log_error("Invalid sched_policy %s", value);
+            return -1;
+        }
+        *set = true;
+    }
+
+    if ((value = pa_modargs_get_value(ma, "rt_priority", NULL))) {
+        if (pa_pal_sched_parse_priority(value, &sched->priority) < 0) {
+            pa_log_error("Invalid rt_priority %s", value);
+            return -1;
+        }
+        *set = true;
+    }
+
+    if ((value = pa_modargs_get_value(ma, "cpu_affinity", NULL))) {
+        if (pa_pal_sched_parse_cpu_mask(value, &sched->cpu_mask) < 0) {
+            pa_log_error("Invalid cpu_affinity %s", value);
+            return -1;
+        }
+        *set = true;
+    }
+
+    return 0;
+}
+
+static int parse_read_threads_modarg(pa_modargs *ma, uint32_t *read_threads) {
+    *read_threads = PAL_DEFAULT_READ_THREADS;
+
+    if (pa_modargs_get_value_u32(ma, "read_threads", read_threads) < 0 ||
+            *read_threads < 1 || *read_threads > PAL_MAX_READ_THREADS) {
+        pa_log_error("Invalid read_threads, expected 1 to %d", PAL_MAX_READ_THREADS);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int parse_sm_cache_modarg(pa_modargs *ma, uint32_t *sm_cache_size) {
+    *sm_cache_size = PA_PAL_VOICEUI_SM_CACHE_DEFAULT_SIZE;
+
+    if (pa_modargs_get_value_u32(ma, "sm_cache_size", sm_cache_size) < 0) {
+        pa_log_error("Invalid sm_cache_size");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int parse_lab_modargs(pa_modargs *ma, uint32_t *lab_ring_size) {
+    *lab_ring_size = PA_PAL_VOICEUI_LAB_DEFAULT_SIZE;
+
+    if (pa_modargs_get_value_u32(ma, "lab_ring_size", lab_ring_size) < 0 ||
+            *lab_ring_size < PAL_LAB_READ_CHUNK) {
+        pa_log_error("Invalid lab_ring_size");
+        return -1;
+    }
+
+    return 0;
+}
+
 int pa__init(pa_module *m) {
     struct pal_voiceui_module_data *m_data;
     pa_modargs *ma;
+    uint32_t sm_cache_size;
     int i;
 
     pa_assert(m);
@@ -1408,6 +1906,26 @@ int pa__init(pa_module *m) {
     m_data->module = m;
     m_data->session_id = 0;
 
+    if (parse_sched_modargs(ma, &m_data->sched, &m_data->sched_set) < 0)
+        goto error;
+
+    if (parse_lab_modargs(ma, &m_data->lab_ring_size) < 0)
+        goto error;
+
+    if (parse_read_threads_modarg(ma, &m_data->read_threads) < 0)
+        goto error;
+
+    /* shared by all sessions, a session only holds a thread while it reads */
+    if (!(m_data->read_pool = pa_pal_worker_new_pool("pal-read", m_data->read_threads, read_thread_init, m_data)))
+        goto error;
+
+    if (parse_sm_cache_modarg(ma, &sm_cache_size) < 0)
+        goto error;
+
+    /* 0 prepares every model again on load */
+    if (sm_cache_size)
+        m_data->sm_cache = pa_pal_voiceui_sm_cache_new(sm_cache_size);
+
     m_data->obj_path = pa_sprintf_malloc("%s/%s", PAL_DBUS_OBJECT_PATH_PREFIX,
                          "primary");
 
@@ -1442,6 +1960,9 @@ void pa__done(pa_module *m) {
     if (m_data->dbus_protocol)
         pa_dbus_protocol_unref(m_data->dbus_protocol);
 
+    pa_pal_worker_free(m_data->read_pool);
+    pa_pal_voiceui_sm_cache_free(m_data->sm_cache);
+
     if (m_data->obj_path)
         pa_xfree(m_data->obj_path);
 
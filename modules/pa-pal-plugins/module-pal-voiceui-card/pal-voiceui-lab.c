@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* memfd_create */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-error.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "pal-voiceui-lab.h"
+
+struct pa_pal_voiceui_lab {
+    int fd;
+    size_t size;
+    uint8_t *base; /* 2 * size, both halves map the same pages */
+    pa_pal_voiceui_lab_header *header; /* one page, after the ring in the memfd */
+    size_t page;
+    uint64_t write_index;
+    uint64_t read_index;
+};
+
+pa_pal_voiceui_lab *pa_pal_voiceui_lab_new(const char *name, size_t size) {
+    pa_pal_voiceui_lab *lab;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint8_t *base = MAP_FAILED;
+    void *header = MAP_FAILED;
+    int fd;
+
+    pa_assert(name);
+    pa_assert(size);
+
+    size = ((size + page - 1) / page) * page;
+
+    if ((fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0) {
+        pa_log_error("%s: memfd_create failed: %s", name, pa_cstrerror(errno));
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)(size + page)) < 0) {
+        pa_log_error("%s: could not size lab ring to %zu: %s", name, size, pa_cstrerror(errno));
+        goto fail;
+    }
+
+    /* the client may map it, an unsealed ring could be shrunk under us and fault the I/O thread */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        pa_log_error("%s: could not seal lab ring: %s", name, pa_cstrerror(errno));
+        goto fail;
+    }
+
+    if ((base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED ||
+            mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+            mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        pa_log_error("%s: could not map lab ring: %s", name, pa_cstrerror(errno));
+        goto fail;
+    }
+
+    if ((header = mmap(NULL, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)size)) == MAP_FAILED) {
+        pa_log_error("%s: could not map lab header: %s", name, pa_cstrerror(errno));
+        goto fail;
+    }
+
+    lab = pa_xnew0(pa_pal_voiceui_lab, 1);
+    lab->fd = fd;
+    lab->size = size;
+    lab->base = base;
+    lab->header = header;
+    lab->page = page;
+
+    pa_log_info("%s: lab ring of %zu bytes", name, size);
+
+    return lab;
+
+fail:
+    if (base != MAP_FAILED)
+        munmap(base, 2 * size);
+    close(fd);
+
+    return NULL;
+}
+
+void pa_pal_voiceui_lab_free(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    munmap(lab->header, lab->page);
+    munmap(lab->base, 2 * lab->size);
+    close(lab->fd);
+    pa_xfree(lab);
+}
+
+int pa_pal_voiceui_lab_fd(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->fd;
+}
+
+size_t pa_pal_voiceui_lab_size(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->size;
+}
+
+uint64_t pa_pal_voiceui_lab_write_index(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->write_index;
+}
+
+uint64_t pa_pal_voiceui_lab_read_index(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->read_index;
+}
+
+size_t pa_pal_voiceui_lab_writable(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->size - (size_t)(lab->write_index - lab->read_index);
+}
+
+void *pa_pal_voiceui_lab_write_ptr(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->base + lab->write_index % lab->size;
+}
+
+void pa_pal_voiceui_lab_produce(pa_pal_voiceui_lab *lab, size_t bytes) {
+    pa_assert(lab);
+    pa_assert(bytes <= pa_pal_voiceui_lab_writable(lab));
+
+    lab->write_index += bytes;
+}
+
+size_t pa_pal_voiceui_lab_readable(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return (size_t)(lab->write_index - lab->read_index);
+}
+
+const void *pa_pal_voiceui_lab_read_ptr(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return lab->base + lab->read_index % lab->size;
+}
+
+int pa_pal_voiceui_lab_consume(pa_pal_voiceui_lab *lab, uint64_t read_index) {
+    pa_assert(lab);
+
+    if (read_index > lab->write_index) {
+        pa_log_warn("lab read index %" PRIu64 " past write index %" PRIu64, read_index, lab->write_index);
+        return -1;
+    }
+
+    /* a client that has not seen the flush yet */
+    if (read_index > lab->read_index)
+        lab->read_index = read_index;
+
+    return 0;
+}
+
+void pa_pal_voiceui_lab_flush(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    lab->read_index = lab->write_index;
+    /* the client checks it around every copy out of the ring */
+    __atomic_add_fetch(&lab->header->flush_gen, 1, __ATOMIC_RELEASE);
+}
+
+uint32_t pa_pal_voiceui_lab_flush_gen(pa_pal_voiceui_lab *lab) {
+    pa_assert(lab);
+
+    return __atomic_load_n(&lab->header->flush_gen, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalvoiceuilabfoo
+#define foopalvoiceuilabfoo
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Look-ahead buffer ring of a voice UI session, backed by a sealed memfd that
+ * the client maps read-only. PAL reads land directly in the ring, only the
+ * read and write indices travel over D-Bus. Indices count bytes since the
+ * ring was created and never wrap, the position in the ring is index % size.
+ *
+ * The mapping is mirrored, so size bytes starting at any position are
+ * contiguous for the writer. Index updates are the caller's to serialize.
+ *
+ * One page after the ring holds a pa_pal_voiceui_lab_header. A client that
+ * finds the memfd larger than the ring maps it too and drops a copy that a
+ * flush overlapped.
+ */
+typedef struct pa_pal_voiceui_lab pa_pal_voiceui_lab;
+
+/* shared with the client at offset size of the memfd, fields are accessed atomically */
+typedef struct pa_pal_voiceui_lab_header {
+    uint32_t flush_gen; /* bumped by every flush */
+} pa_pal_voiceui_lab_header;
+
+#define PA_PAL_VOICEUI_LAB_DEFAULT_SIZE (512 * 1024)
+
+/* size is rounded up to whole pages, NULL if memfd or sealing is not available */
+pa_pal_voiceui_lab *pa_pal_voiceui_lab_new(const char *name, size_t size);
+void pa_pal_voiceui_lab_free(pa_pal_voiceui_lab *lab);
+
+int pa_pal_voiceui_lab_fd(pa_pal_voiceui_lab *lab);
+size_t pa_pal_voiceui_lab_size(pa_pal_voiceui_lab *lab);
+
+uint64_t pa_pal_voiceui_lab_write_index(pa_pal_voiceui_lab *lab);
+uint64_t pa_pal_voiceui_lab_read_index(pa_pal_voiceui_lab *lab);
+/* bytes that can be written without overwriting what the client has not read */
+size_t pa_pal_voiceui_lab_writable(pa_pal_voiceui_lab *lab);
+void *pa_pal_voiceui_lab_write_ptr(pa_pal_voiceui_lab *lab);
+void pa_pal_voiceui_lab_produce(pa_pal_voiceui_lab *lab, size_t bytes);
+/* bytes written but not read yet, contiguous from the read pointer */
+size_t pa_pal_voiceui_lab_readable(pa_pal_voiceui_lab *lab);
+const void *pa_pal_voiceui_lab_read_ptr(pa_pal_voiceui_lab *lab);
+/*
+ * The client has read everything before read_index. An index from before
+ * the last flush is taken as the flush point, one past the write index fails.
+ */
+int pa_pal_voiceui_lab_consume(pa_pal_voiceui_lab *lab, uint64_t read_index);
+/* drops everything not read yet, for a new capture */
+void pa_pal_voiceui_lab_flush(pa_pal_voiceui_lab *lab);
+uint32_t pa_pal_voiceui_lab_flush_gen(pa_pal_voiceui_lab *lab);
+
+#endif
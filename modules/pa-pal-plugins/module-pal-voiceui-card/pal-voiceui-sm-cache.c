@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-error.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "pal-voiceui-sm-cache.h"
+
+/* sealed memfds seen last, each pins its inode until dropped */
+#define PA_PAL_VOICEUI_SM_MEMFDS 8
+
+typedef struct pa_pal_voiceui_sm_memfd pa_pal_voiceui_sm_memfd;
+typedef struct pa_pal_voiceui_sm_entry pa_pal_voiceui_sm_entry;
+
+struct pa_pal_voiceui_sm_memfd {
+    dev_t dev;
+    ino_t ino;
+    int fd; /* pins the inode, so no other memfd can take it while the hash is kept */
+    size_t size;
+    uint64_t hash; /* of the data, taken when the memfd was first seen */
+    pa_pal_voiceui_sm_memfd *next;
+};
+
+struct pa_pal_voiceui_sm_entry {
+    uint64_t hash;
+    size_t size; /* header and data */
+    pal_param_payload *payload;
+    pa_pal_voiceui_sm_entry *next;
+};
+
+struct pa_pal_voiceui_sm_cache {
+    size_t max_bytes;
+    size_t bytes; /* payloads and pinned memfds */
+    unsigned n_memfds;
+    pa_pal_voiceui_sm_memfd *memfds; /* most recently used first */
+    pa_pal_voiceui_sm_entry *head; /* most recently used first */
+};
+
+static inline uint64_t rotl64(uint64_t x, unsigned r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* 8 bytes per step, it runs once per memfd */
+static uint64_t hash_update(uint64_t h, const void *data, size_t size) {
+    const uint8_t *p = data;
+    uint64_t k;
+
+    for (; size >= 8; p += 8, size -= 8) {
+        memcpy(&k, p, sizeof(k));
+        k *= UINT64_C(0x87c37b91114253d5);
+        k = rotl64(k, 31);
+        k *= UINT64_C(0x4cf5ad432745937f);
+        h ^= k;
+        h = rotl64(h, 27) * 5 + UINT64_C(0x52dce729);
+    }
+
+    for (; size; p++, size--) {
+        h ^= *p;
+        h *= UINT64_C(0x100000001b3);
+    }
+
+    return h;
+}
+
+static uint64_t hash_final(uint64_t h, size_t size) {
+    h ^= (uint64_t)size;
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+
+    return h;
+}
+
+static void memfd_free(pa_pal_voiceui_sm_memfd *m) {
+    pa_close(m->fd);
+    pa_xfree(m);
+}
+
+static void entry_free(pa_pal_voiceui_sm_entry *e) {
+    pa_xfree(e->payload);
+    pa_xfree(e);
+}
+
+/* the hash of the data in fd, read only the first time this memfd is seen */
+static bool memfd_hash(pa_pal_voiceui_sm_cache *c, int fd, const void *data, size_t data_size, uint64_t *hash,
+                       bool *known) {
+    pa_pal_voiceui_sm_memfd *m, *prev = NULL;
+    struct stat st;
+    int dup_fd;
+
+    if (fstat(fd, &st) < 0) {
+        pa_log_warn("Cannot identify sound model memfd: %s", pa_cstrerror(errno));
+        return false;
+    }
+
+    if ((uint64_t)st.st_size != data_size) {
+        pa_log_warn("Sound model memfd is %" PRIu64 " bytes, %zu mapped", (uint64_t)st.st_size, data_size);
+        return false;
+    }
+
+    for (m = c->memfds; m; prev = m, m = m->next) {
+        if (m->dev != st.st_dev || m->ino != st.st_ino || m->size != data_size)
+            continue;
+
+        if (prev) {
+            prev->next = m->next;
+            m->next = c->memfds;
+            c->memfds = m;
+        }
+
+        *hash = m->hash;
+        *known = true;
+        return true;
+    }
+
+    *hash = hash_final(hash_update(0, data, data_size), data_size);
+    *known = false;
+
+    /* without a pinned inode the hash is still good for this load */
+    if ((dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0)) < 0) {
+        pa_log_warn("Cannot keep sound model memfd: %s", pa_cstrerror(errno));
+        return true;
+    }
+
+    m = pa_xnew0(pa_pal_voiceui_sm_memfd, 1);
+    m->dev = st.st_dev;
+    m->ino = st.st_ino;
+    m->fd = dup_fd;
+    m->size = data_size;
+    m->hash = *hash;
+    m->next = c->memfds;
+    c->memfds = m;
+    c->n_memfds++;
+    c->bytes += data_size;
+
+    return true;
+}
+
+/* drops the oldest memfds, then the oldest payloads. The ones used last are kept */
+static void cache_trim(pa_pal_voiceui_sm_cache *c) {
+    pa_pal_voiceui_sm_memfd *m, *mprev;
+    pa_pal_voiceui_sm_entry *e, *prev;
+
+    /* the lists are short, walking them for the oldest is cheap next to copying a model */
+    while ((c->n_memfds > PA_PAL_VOICEUI_SM_MEMFDS || c->bytes > c->max_bytes) && c->memfds && c->memfds->next) {
+        for (mprev = c->memfds, m = mprev->next; m->next; mprev = m, m = m->next);
+
+        mprev->next = NULL;
+        c->n_memfds--;
+        c->bytes -= m->size;
+        memfd_free(m);
+    }
+
+    while (c->bytes > c->max_bytes && c->head->next) {
+        for (prev = c->head, e = prev->next; e->next; prev = e, e = e->next);
+
+        pa_log_debug("Dropping cached sound model of %zu bytes", e->size);
+        prev->next = NULL;
+        c->bytes -= e->payload->payload_size;
+        entry_free(e);
+    }
+}
+
+pal_param_payload *pa_pal_voiceui_sm_payload_new(const void *header, size_t header_size, const void *data,
+                                                 size_t data_size) {
+    pal_param_payload *payload;
+
+    pa_assert(header);
+    pa_assert(data || !data_size);
+
+    /* the only copy of the model data the module makes */
+    payload = pa_xmalloc(sizeof(pal_param_payload) + header_size + data_size);
+    payload->payload_size = sizeof(pal_param_payload) + header_size + data_size;
+    memcpy(payload->payload, header, header_size);
+    if (data_size)
+        memcpy(payload->payload + header_size, data, data_size);
+
+    return payload;
+}
+
+pa_pal_voiceui_sm_cache *pa_pal_voiceui_sm_cache_new(size_t max_bytes) {
+    pa_pal_voiceui_sm_cache *c = pa_xnew0(pa_pal_voiceui_sm_cache, 1);
+
+    c->max_bytes = max_bytes;
+
+    return c;
+}
+
+void pa_pal_voiceui_sm_cache_free(pa_pal_voiceui_sm_cache *c) {
+    pa_pal_voiceui_sm_memfd *m;
+    pa_pal_voiceui_sm_entry *e;
+
+    if (!c)
+        return;
+
+    while ((m = c->memfds)) {
+        c->memfds = m->next;
+        memfd_free(m);
+    }
+
+    while ((e = c->head)) {
+        c->head = e->next;
+        entry_free(e);
+    }
+
+    pa_xfree(c);
+}
+
+pal_param_payload *pa_pal_voiceui_sm_cache_get(pa_pal_voiceui_sm_cache *c, int fd, const void *header,
+                                               size_t header_size, const void *data, size_t data_size, bool *hit) {
+    pa_pal_voiceui_sm_entry *e, *prev = NULL;
+    uint64_t hash;
+    bool known;
+
+    pa_assert(c);
+    pa_assert(header);
+    pa_assert(hit);
+
+    if (!memfd_hash(c, fd, data, data_size, &hash, &known))
+        return NULL;
+
+    for (e = c->head; e; prev = e, e = e->next) {
+        if (e->hash != hash || e->size != header_size + data_size ||
+                memcmp(e->payload->payload, header, header_size))
+            continue;
+
+        /* a memfd seen before is sealed, its data is what was hashed. A new
+         * one was read for the hash already, once more rules out a collision */
+        if (!known && data_size && memcmp(e->payload->payload + header_size, data, data_size))
+            continue;
+
+        if (prev) {
+            prev->next = e->next;
+            e->next = c->head;
+            c->head = e;
+        }
+
+        cache_trim(c);
+
+        *hit = true;
+        return e->payload;
+    }
+
+    e = pa_xnew0(pa_pal_voiceui_sm_entry, 1);
+    e->hash = hash;
+    e->size = header_size + data_size;
+    e->payload = pa_pal_voiceui_sm_payload_new(header, header_size, data, data_size);
+    e->next = c->head;
+    c->head = e;
+    c->bytes += e->payload->payload_size;
+
+    cache_trim(c);
+
+    *hit = false;
+    return e->payload;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalvoiceuismcachefoo
+#define foopalvoiceuismcachefoo
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PalDefs.h"
+
+/*
+ * LoadSoundModelFd payloads by the content of the model: the sound model
+ * header followed by the opaque model data, as pal_stream_set_param takes
+ * them. Entries are found by a hash of the data and the header, which is
+ * small and compared as is.
+ *
+ * The data comes in a sealed memfd, so it cannot change once sent. Its hash
+ * is taken the first time a memfd is seen and kept by st_dev/st_ino, with a
+ * dup of the memfd so the inode is not reused while the hash is kept. A
+ * client that sends the same memfd again gets its payload without the model
+ * being read; one that sends the same model in a new memfd reads it once for
+ * the hash and once to compare, in place of one copy per load.
+ *
+ * The payloads and the pinned memfds count against the cache size. The
+ * oldest memfds are dropped first, then the oldest payloads; the ones used
+ * last are always kept.
+ */
+typedef struct pa_pal_voiceui_sm_cache pa_pal_voiceui_sm_cache;
+
+#define PA_PAL_VOICEUI_SM_CACHE_DEFAULT_SIZE (16 * 1024 * 1024)
+
+pa_pal_voiceui_sm_cache *pa_pal_voiceui_sm_cache_new(size_t max_bytes);
+void pa_pal_voiceui_sm_cache_free(pa_pal_voiceui_sm_cache *c);
+
+/*
+ * data is the mapping of the sealed memfd fd, read only if fd is new. The
+ * payload is owned by the cache and valid until the next call, hit is set
+ * if it was cached already. NULL if fd cannot be identified.
+ */
+pal_param_payload *pa_pal_voiceui_sm_cache_get(pa_pal_voiceui_sm_cache *c, int fd, const void *header,
+                                               size_t header_size, const void *data, size_t data_size, bool *hit);
+
+/* the same payload owned by the caller, when there is no cache */
+pal_param_payload *pa_pal_voiceui_sm_payload_new(const void *header, size_t header_size, const void *data,
+                                                 size_t data_size);
+
+#endif
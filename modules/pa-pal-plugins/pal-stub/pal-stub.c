@@ -0,0 +1,722 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <PalApi.h>
+#include <PalDefs.h>
+
+#include "pal-clock.h"
+#include "pal-stub.h"
+
+#define PAL_STUB_HIST_BUCKETS 24
+#define PAL_STUB_DEFAULT_BUFFER_COUNT 4
+#define PAL_STUB_NSEC_PER_SEC 1000000000ULL
+#define PAL_STUB_NSEC_PER_USEC 1000ULL
+#define PAL_STUB_MMAP_BURST_US 1000
+#define PAL_STUB_MMAP_MIN_BURSTS 2
+
+typedef struct {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t partial;
+    uint64_t underruns;
+    uint64_t overruns;
+    uint64_t call_ns;
+    uint64_t cpu_ns;
+    uint64_t cpu_samples;
+    uint64_t last_cpu_ns;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t hist[PAL_STUB_HIST_BUCKETS];
+} pal_stub_stats;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    int id;
+    pal_stream_type_t type;
+    pal_stream_direction_t direction;
+    bool non_blocking;
+
+    uint32_t rate;
+    size_t frame_size;
+    size_t buffer_size;
+    size_t buffer_count;
+
+    bool started;
+    bool paused;
+    uint64_t clock_ns;     /* last point the virtual DSP clock advanced */
+    uint64_t position;     /* bytes rendered/captured by the virtual DSP */
+    uint64_t transferred;  /* bytes written/read by the client */
+
+    /* MMAP streams: the DSP loops over the buffer, the client tracks the
+     * position instead of writing or reading */
+    void *mmap_buf;
+    uint32_t mmap_frames;
+    uint64_t mmap_reported; /* position of the last query, bytes */
+
+    pal_stream_callback cb;
+    uint64_t cookie;
+    pthread_t cb_thread;
+    bool cb_thread_running;
+    bool exit_cb_thread;
+    bool write_ready_pending;
+    bool drain_pending;
+
+    pal_stub_stats stats;
+} pal_stub_stream;
+
+static struct {
+    uint64_t latency_us;
+    uint64_t jitter_us;
+    uint64_t control_us;
+    uint32_t partial_pct;
+    bool realtime;
+    char *report_path;
+    int stream_count;
+    pthread_mutex_t report_lock;
+} stub = {
+    .realtime = true,
+    .report_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static uint64_t stub_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * PAL_STUB_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t stub_thread_cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * PAL_STUB_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* Absolute time in the same unit module-pal-card derives from the system counter */
+static uint64_t stub_qtimer_us(void) {
+    return pa_pal_clock_now_us();
+}
+
+static void stub_sleep_ns(uint64_t ns) {
+    struct timespec ts;
+
+    if (!ns)
+        return;
+
+    ts.tv_sec = ns / PAL_STUB_NSEC_PER_SEC;
+    ts.tv_nsec = ns % PAL_STUB_NSEC_PER_SEC;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+static uint64_t stub_env_u64(const char *name, uint64_t def) {
+    const char *value = getenv(name);
+
+    return value ? strtoull(value, NULL, 0) : def;
+}
+
+static const char *stub_type_name(pal_stream_type_t type) {
+    switch (type) {
+        case PAL_STREAM_LOW_LATENCY:
+            return "low_latency";
+        case PAL_STREAM_DEEP_BUFFER:
+            return "deep_buffer";
+        case PAL_STREAM_COMPRESSED:
+            return "compressed";
+        case PAL_STREAM_VOIP_TX:
+            return "voip_tx";
+        case PAL_STREAM_VOIP_RX:
+            return "voip_rx";
+        case PAL_STREAM_RAW:
+            return "raw";
+        case PAL_STREAM_GENERIC:
+            return "generic";
+        default:
+            return "other";
+    }
+}
+
+static size_t stub_capacity(pal_stub_stream *s, size_t request) {
+    size_t count = s->buffer_count ? s->buffer_count : PAL_STUB_DEFAULT_BUFFER_COUNT;
+    size_t size = s->buffer_size ? s->buffer_size : request;
+
+    return count * size;
+}
+
+static uint64_t stub_bytes_to_ns(pal_stub_stream *s, uint64_t bytes) {
+    return (bytes / s->frame_size) * PAL_STUB_NSEC_PER_SEC / s->rate;
+}
+
+/* Advance the virtual DSP clock up to now; called with s->lock held */
+static void stub_update_position(pal_stub_stream *s) {
+    uint64_t now = stub_now_ns();
+    uint64_t frames;
+
+    if (!s->started || s->paused) {
+        s->clock_ns = now;
+        return;
+    }
+
+    frames = (now - s->clock_ns) * s->rate / PAL_STUB_NSEC_PER_SEC;
+    s->clock_ns += frames * PAL_STUB_NSEC_PER_SEC / s->rate;
+    s->position += frames * s->frame_size;
+
+    /* nothing is transferred on an MMAP stream, the DSP never runs dry */
+    if (s->direction == PAL_AUDIO_OUTPUT && !s->mmap_buf && s->position > s->transferred) {
+        /* DSP ran dry, it plays silence without moving the session clock */
+        if (s->transferred)
+            s->stats.underruns++;
+        s->position = s->transferred;
+    }
+}
+
+static void stub_stats_begin(pal_stub_stream *s, uint64_t *t0) {
+    uint64_t cpu = stub_thread_cpu_ns();
+
+    *t0 = stub_now_ns();
+
+    if (!s->stats.first_ns)
+        s->stats.first_ns = *t0;
+
+    if (s->stats.last_cpu_ns) {
+        s->stats.cpu_ns += cpu - s->stats.last_cpu_ns;
+        s->stats.cpu_samples++;
+    }
+    s->stats.last_cpu_ns = cpu;
+
+    if (stub.latency_us || stub.jitter_us)
+        stub_sleep_ns((stub.latency_us + (stub.jitter_us ? (uint64_t)rand() % (stub.jitter_us + 1) : 0)) *
+                      PAL_STUB_NSEC_PER_USEC);
+}
+
+static void stub_stats_end(pal_stub_stream *s, uint64_t t0, size_t bytes) {
+    uint64_t t1 = stub_now_ns();
+    uint64_t us = (t1 - t0) / PAL_STUB_NSEC_PER_USEC;
+    int bucket = 0;
+
+    while (us && bucket < PAL_STUB_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    s->stats.hist[bucket]++;
+    s->stats.calls++;
+    s->stats.bytes += bytes;
+    s->stats.call_ns += t1 - t0;
+    s->stats.last_ns = t1;
+}
+
+static void stub_report(pal_stub_stream *s) {
+    pal_stub_stats *st = &s->stats;
+    double secs = (st->last_ns > st->first_ns) ? (double)(st->last_ns - st->first_ns) / PAL_STUB_NSEC_PER_SEC : 0.0;
+    FILE *f = stderr;
+    int i;
+
+    pthread_mutex_lock(&stub.report_lock);
+
+    if (stub.report_path && !(f = fopen(stub.report_path, "a")))
+        f = stderr;
+
+    fprintf(f, "stream %d %s %s rate %u frame %zu buffer %zux%zu\n", s->id, stub_type_name(s->type),
+            s->direction == PAL_AUDIO_OUTPUT ? "out" : "in", s->rate, s->frame_size, s->buffer_size, s->buffer_count);
+    fprintf(f, "  duration %.3f s, frames/s %.1f, wakeups/s %.1f, cpu/buffer %.1f us, time in pal/call %.1f us\n",
+            secs,
+            secs > 0 ? (double)(st->bytes / s->frame_size) / secs : 0.0,
+            secs > 0 ? (double)st->calls / secs : 0.0,
+            st->cpu_samples ? (double)st->cpu_ns / st->cpu_samples / PAL_STUB_NSEC_PER_USEC : 0.0,
+            st->calls ? (double)st->call_ns / st->calls / PAL_STUB_NSEC_PER_USEC : 0.0);
+    fprintf(f, "  calls %llu, partial %llu, underruns %llu, overruns %llu\n",
+            (unsigned long long)st->calls, (unsigned long long)st->partial,
+            (unsigned long long)st->underruns, (unsigned long long)st->overruns);
+    fprintf(f, "  %s latency histogram (us):\n", s->direction == PAL_AUDIO_OUTPUT ? "write" : "read");
+    for (i = 0; i < PAL_STUB_HIST_BUCKETS; i++) {
+        if (!st->hist[i])
+            continue;
+        fprintf(f, "    [%8llu, %8llu) %llu\n", i ? 1ULL << (i - 1) : 0ULL, 1ULL << i,
+                (unsigned long long)st->hist[i]);
+    }
+
+    if (f != stderr)
+        fclose(f);
+
+    pthread_mutex_unlock(&stub.report_lock);
+}
+
+static void *stub_cb_thread_func(void *userdata) {
+    pal_stub_stream *s = userdata;
+    struct timespec ts;
+    uint64_t wait_ns;
+    size_t capacity;
+
+    pthread_mutex_lock(&s->lock);
+
+    while (!s->exit_cb_thread) {
+        if (!s->write_ready_pending && !s->drain_pending) {
+            pthread_cond_wait(&s->cond, &s->lock);
+            continue;
+        }
+
+        stub_update_position(s);
+        capacity = stub_capacity(s, s->buffer_size);
+
+        if (s->write_ready_pending && (s->transferred - s->position + s->buffer_size <= capacity || !s->started)) {
+            s->write_ready_pending = false;
+            pthread_mutex_unlock(&s->lock);
+            s->cb((pal_stream_handle_t *)s, PAL_STREAM_CBK_EVENT_WRITE_READY, NULL, 0, s->cookie);
+            pthread_mutex_lock(&s->lock);
+            continue;
+        }
+
+        if (s->drain_pending && s->position >= s->transferred) {
+            s->drain_pending = false;
+            pthread_mutex_unlock(&s->lock);
+            s->cb((pal_stream_handle_t *)s, PAL_STREAM_CBK_EVENT_PARTIAL_DRAIN_READY, NULL, 0, s->cookie);
+            pthread_mutex_lock(&s->lock);
+            continue;
+        }
+
+        wait_ns = s->write_ready_pending ?
+                  stub_bytes_to_ns(s, s->transferred - s->position + s->buffer_size - capacity) :
+                  stub_bytes_to_ns(s, s->transferred - s->position);
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        wait_ns += (uint64_t)ts.tv_nsec + PAL_STUB_NSEC_PER_USEC;
+        ts.tv_sec += wait_ns / PAL_STUB_NSEC_PER_SEC;
+        ts.tv_nsec = wait_ns % PAL_STUB_NSEC_PER_SEC;
+        pthread_cond_timedwait(&s->cond, &s->lock, &ts);
+    }
+
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+int agm_init(void) {
+    return 0;
+}
+
+int agm_deinit(void) {
+    return 0;
+}
+
+int32_t pal_init(void) {
+    stub.latency_us = stub_env_u64("PAL_STUB_LATENCY_US", 0);
+    stub.jitter_us = stub_env_u64("PAL_STUB_JITTER_US", 0);
+    stub.control_us = stub_env_u64("PAL_STUB_CONTROL_US", 0);
+    stub.partial_pct = (uint32_t)stub_env_u64("PAL_STUB_PARTIAL_PCT", 0);
+    stub.realtime = stub_env_u64("PAL_STUB_REALTIME", 1) != 0;
+
+    free(stub.report_path);
+    stub.report_path = getenv("PAL_STUB_REPORT") ? strdup(getenv("PAL_STUB_REPORT")) : NULL;
+
+    srand((unsigned)stub_now_ns());
+
+    return 0;
+}
+
+void pal_deinit(void) {
+    free(stub.report_path);
+    stub.report_path = NULL;
+}
+
+int32_t pal_stream_open(struct pal_stream_attributes *attributes, uint32_t no_of_devices, struct pal_device *devices,
+                        uint32_t no_of_modifiers, struct modifier_kv *modifiers, pal_stream_callback cb,
+                        uint64_t cookie, pal_stream_handle_t **stream_handle) {
+    pal_stub_stream *s;
+    struct pal_media_config *config;
+    uint32_t bit_width;
+
+    if (!attributes || !stream_handle)
+        return -EINVAL;
+
+    s = calloc(1, sizeof(*s));
+    if (!s)
+        return -ENOMEM;
+
+    config = (attributes->direction == PAL_AUDIO_OUTPUT) ? &attributes->out_media_config : &attributes->in_media_config;
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+
+    s->id = __atomic_add_fetch(&stub.stream_count, 1, __ATOMIC_RELAXED);
+    s->type = attributes->type;
+    s->direction = attributes->direction;
+    s->non_blocking = !!(attributes->flags & PAL_STREAM_FLAG_NON_BLOCKING_MASK);
+    s->rate = config->sample_rate ? config->sample_rate : 48000;
+
+    bit_width = config->bit_width ? config->bit_width : 16;
+    if (config->aud_fmt_id == PAL_AUDIO_FMT_PCM_S24_LE || config->aud_fmt_id == PAL_AUDIO_FMT_PCM_S32_LE)
+        bit_width = 32;
+    s->frame_size = (bit_width / 8) * (config->ch_info.channels ? config->ch_info.channels : 2);
+
+    s->cb = cb;
+    s->cookie = cookie;
+
+    if (s->non_blocking && cb) {
+        if (pthread_create(&s->cb_thread, NULL, stub_cb_thread_func, s) == 0)
+            s->cb_thread_running = true;
+    }
+
+    *stream_handle = (pal_stream_handle_t *)s;
+
+    return 0;
+}
+
+int32_t pal_stream_close(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    if (s->cb_thread_running) {
+        pthread_mutex_lock(&s->lock);
+        s->exit_cb_thread = true;
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->cb_thread, NULL);
+    }
+
+    if (s->stats.calls)
+        stub_report(s);
+
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    free(s->mmap_buf);
+    free(s);
+
+    return 0;
+}
+
+int32_t pal_stream_start(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    s->started = true;
+    s->paused = false;
+    s->clock_ns = stub_now_ns();
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_stop(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    s->started = false;
+    s->write_ready_pending = false;
+    s->drain_pending = false;
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_pause(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    stub_update_position(s);
+    s->paused = true;
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_resume(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    s->paused = false;
+    s->clock_ns = stub_now_ns();
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_flush(pal_stream_handle_t *stream_handle) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    stub_update_position(s);
+    if (s->direction == PAL_AUDIO_OUTPUT)
+        s->transferred = s->position;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_drain(pal_stream_handle_t *stream_handle, pal_drain_type_t type) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+
+    if (!s)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    s->drain_pending = s->cb_thread_running;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_stream_set_buffer_size(pal_stream_handle_t *stream_handle, pal_buffer_config_t *in_buff_cfg,
+                                   pal_buffer_config_t *out_buff_cfg) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    pal_buffer_config_t *cfg;
+
+    if (!s)
+        return -EINVAL;
+
+    cfg = (s->direction == PAL_AUDIO_OUTPUT) ? out_buff_cfg : in_buff_cfg;
+    if (cfg) {
+        s->buffer_size = cfg->buf_size;
+        s->buffer_count = cfg->buf_count;
+    }
+
+    return 0;
+}
+
+ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *buf) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    size_t capacity, queued, accept;
+    uint64_t t0;
+
+    if (!s || !buf || !buf->buffer)
+        return -EINVAL;
+
+    stub_stats_begin(s, &t0);
+
+    pthread_mutex_lock(&s->lock);
+    capacity = stub_capacity(s, buf->size);
+    accept = buf->size;
+
+    for (;;) {
+        stub_update_position(s);
+        queued = s->transferred - s->position;
+
+        if (!stub.realtime || !s->started || queued + buf->size <= capacity)
+            break;
+
+        if (s->non_blocking) {
+            accept = (capacity > queued) ? capacity - queued : 0;
+            accept -= accept % s->frame_size;
+            break;
+        }
+
+        pthread_mutex_unlock(&s->lock);
+        stub_sleep_ns(stub_bytes_to_ns(s, queued + buf->size - capacity) + PAL_STUB_NSEC_PER_USEC);
+        pthread_mutex_lock(&s->lock);
+    }
+
+    if (s->non_blocking && accept == buf->size && stub.partial_pct && (uint32_t)(rand() % 100) < stub.partial_pct) {
+        accept = buf->size / 2;
+        accept -= accept % s->frame_size;
+    }
+
+    if (accept < buf->size) {
+        s->stats.partial++;
+        s->write_ready_pending = true;
+        pthread_cond_signal(&s->cond);
+    }
+
+    s->transferred += accept;
+    stub_stats_end(s, t0, accept);
+    pthread_mutex_unlock(&s->lock);
+
+    return (ssize_t)accept;
+}
+
+ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *buf) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    size_t capacity, available;
+    uint64_t t0;
+
+    if (!s || !buf || !buf->buffer)
+        return -EINVAL;
+
+    stub_stats_begin(s, &t0);
+
+    pthread_mutex_lock(&s->lock);
+    capacity = stub_capacity(s, buf->size);
+
+    for (;;) {
+        stub_update_position(s);
+
+        if (!stub.realtime) {
+            s->position = s->transferred + buf->size;
+            break;
+        }
+
+        available = s->position - s->transferred;
+        if (available > capacity) {
+            /* client fell behind, DSP overwrote the oldest buffers */
+            s->stats.overruns++;
+            s->transferred = s->position - capacity;
+            available = capacity;
+        }
+
+        if (s->started && available >= buf->size)
+            break;
+
+        pthread_mutex_unlock(&s->lock);
+        stub_sleep_ns(stub_bytes_to_ns(s, buf->size - (s->started ? available : 0)) + PAL_STUB_NSEC_PER_USEC);
+        pthread_mutex_lock(&s->lock);
+    }
+
+    memset(buf->buffer, 0, buf->size);
+    s->transferred += buf->size;
+    stub_stats_end(s, t0, buf->size);
+    pthread_mutex_unlock(&s->lock);
+
+    return (ssize_t)buf->size;
+}
+
+/* a buffer of at least min_size_frames in whole bursts of PAL_STUB_MMAP_BURST_US */
+int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle, int32_t min_size_frames,
+                                      struct pal_mmap_buffer *info) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    uint32_t burst, frames;
+
+    if (!s || !info || min_size_frames < 0)
+        return -EINVAL;
+
+    burst = (uint32_t)((uint64_t)s->rate * PAL_STUB_MMAP_BURST_US / (PAL_STUB_NSEC_PER_SEC / PAL_STUB_NSEC_PER_USEC));
+    if (!burst)
+        burst = 1;
+    frames = (uint32_t)min_size_frames > burst * PAL_STUB_MMAP_MIN_BURSTS ? (uint32_t)min_size_frames :
+             burst * PAL_STUB_MMAP_MIN_BURSTS;
+    frames = (frames + burst - 1) / burst * burst;
+
+    pthread_mutex_lock(&s->lock);
+    free(s->mmap_buf);
+    s->mmap_buf = calloc(frames, s->frame_size);
+    s->mmap_frames = s->mmap_buf ? frames : 0;
+    pthread_mutex_unlock(&s->lock);
+
+    if (!s->mmap_buf)
+        return -ENOMEM;
+
+    memset(info, 0, sizeof(*info));
+    info->buffer = s->mmap_buf;
+    info->fd = -1;
+    info->buffer_size_frames = frames;
+    info->burst_size_frames = burst;
+
+    return 0;
+}
+
+/* frames the DSP went through since start, driven by the monotonic clock
+ * and wrapping at 32 bit like PAL's */
+int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle, struct pal_mmap_position *position) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    uint64_t t0;
+
+    if (!s || !position)
+        return -EINVAL;
+
+    if (!s->mmap_buf)
+        return -ENOSYS;
+
+    stub_stats_begin(s, &t0);
+
+    pthread_mutex_lock(&s->lock);
+    stub_update_position(s);
+    position->position_frames = (int32_t)(uint32_t)(s->position / s->frame_size);
+    position->time_nanoseconds = (int64_t)s->clock_ns;
+    /* what the DSP went through before the first query is outside the report window */
+    stub_stats_end(s, t0, s->stats.calls ? (size_t)(s->position - s->mmap_reported) : 0);
+    s->mmap_reported = s->position;
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int32_t pal_get_timestamp(pal_stream_handle_t *stream_handle, struct pal_session_time *stime) {
+    pal_stub_stream *s = (pal_stub_stream *)stream_handle;
+    uint64_t session_us, abs_us;
+
+    if (!s || !stime)
+        return -EINVAL;
+
+    pthread_mutex_lock(&s->lock);
+    stub_update_position(s);
+    session_us = stub_bytes_to_ns(s, s->position) / PAL_STUB_NSEC_PER_USEC;
+    abs_us = stub_qtimer_us();
+    pthread_mutex_unlock(&s->lock);
+
+    stime->session_time.value_lsw = (uint32_t)session_us;
+    stime->session_time.value_msw = (uint32_t)(session_us >> 32);
+    stime->absolute_time.value_lsw = (uint32_t)abs_us;
+    stime->absolute_time.value_msw = (uint32_t)(abs_us >> 32);
+
+    return 0;
+}
+
+int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle, struct pal_volume_data *volume) {
+    if (!stream_handle || !volume)
+        return -EINVAL;
+
+    stub_sleep_ns(stub.control_us * PAL_STUB_NSEC_PER_USEC);
+
+    return 0;
+}
+
+int32_t pal_stream_set_mute(pal_stream_handle_t *stream_handle, bool state) {
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_stream_set_device(pal_stream_handle_t *stream_handle, uint32_t no_of_devices, struct pal_device *devices) {
+    if (!stream_handle || !devices)
+        return -EINVAL;
+
+    stub_sleep_ns(stub.control_us * PAL_STUB_NSEC_PER_USEC);
+
+    return 0;
+}
+
+int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle, uint32_t param_id, pal_param_payload *param_payload) {
+    return stream_handle ? 0 : -EINVAL;
+}
+
+int32_t pal_set_param(uint32_t param_id, void *param_payload, size_t payload_size) {
+    return 0;
+}
+
+int32_t pal_get_param(uint32_t param_id, void **param_payload, size_t *payload_size, void *query) {
+    return -ENOSYS;
+}
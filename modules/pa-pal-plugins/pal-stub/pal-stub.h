@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef foopalstubfoo
+#define foopalstubfoo
+
+/*
+ * Host-side stand-in for libpal/libagm, linked into module-pal-card when the
+ * plugin is configured with --with-pal-stub. Streams are paced by a virtual
+ * DSP clock and report per-stream statistics when they are closed. MMAP
+ * streams get a buffer the virtual DSP loops over, with the position
+ * advanced by the monotonic clock.
+ *
+ * Behaviour is tuned through environment variables read at pal_init():
+ *   PAL_STUB_LATENCY_US   fixed extra latency added to every write/read
+ *   PAL_STUB_JITTER_US    uniformly distributed extra latency [0, jitter]
+ *   PAL_STUB_PARTIAL_PCT  percentage of non-blocking writes forced partial
+ *   PAL_STUB_CONTROL_US   time spent in set_volume/set_device calls
+ *   PAL_STUB_REALTIME     0 disables DSP clock pacing (throughput mode)
+ *   PAL_STUB_REPORT       file the per-stream report is appended to
+ */
+
+int agm_init(void);
+int agm_deinit(void);
+
+#endif
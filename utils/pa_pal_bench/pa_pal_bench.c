@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Drives several pal sinks and sources concurrently through pa_simple and
+ * reports client side throughput and latency. Meant to be run by
+ * pa_pal_bench.sh against module-pal-card built with --with-pal-stub, where
+ * the stub reports the DSP side of the same streams.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <pulse/simple.h>
+#include <pulse/error.h>
+
+#define BENCH_MAX_STREAMS 16
+#define BENCH_DEFAULT_DURATION_S 10
+#define BENCH_DEFAULT_FRAMES 480
+
+typedef struct {
+    const char *device;
+    bool playback;
+    pthread_t thread;
+    bool thread_created;
+
+    uint64_t frames;
+    uint64_t calls;
+    uint64_t lat_min_us;
+    uint64_t lat_max_us;
+    uint64_t lat_sum_us;
+    uint64_t lat_samples;
+    uint64_t max_call_us;
+    int error;
+} bench_stream;
+
+static pa_sample_spec spec = {
+    .format = PA_SAMPLE_S16LE,
+    .rate = 48000,
+    .channels = 2,
+};
+
+static unsigned duration_s = BENCH_DEFAULT_DURATION_S;
+static size_t period_frames = BENCH_DEFAULT_FRAMES;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void *bench_thread_func(void *userdata) {
+    bench_stream *s = userdata;
+    pa_buffer_attr attr;
+    pa_simple *pa = NULL;
+    size_t period_bytes = period_frames * pa_frame_size(&spec);
+    uint64_t start, end, t0, t1;
+    pa_usec_t latency;
+    uint8_t *buf;
+    int ret, error;
+
+    buf = calloc(1, period_bytes);
+    if (!buf) {
+        s->error = -1;
+        return NULL;
+    }
+
+    memset(&attr, 0xff, sizeof(attr));
+    attr.tlength = (uint32_t)(4 * period_bytes);
+    attr.fragsize = (uint32_t)period_bytes;
+
+    pa = pa_simple_new(NULL, "pa_pal_bench", s->playback ? PA_STREAM_PLAYBACK : PA_STREAM_RECORD, s->device,
+                       s->playback ? "bench playback" : "bench capture", &spec, NULL, &attr, &ret);
+    if (!pa) {
+        fprintf(stderr, "%s: pa_simple_new failed for %s: %s\n", __func__, s->device, pa_strerror(ret));
+        s->error = ret;
+        goto exit;
+    }
+
+    s->lat_min_us = UINT64_MAX;
+    start = now_us();
+    end = start + (uint64_t)duration_s * 1000000ULL;
+
+    while ((t0 = now_us()) < end) {
+        if (s->playback)
+            ret = pa_simple_write(pa, buf, period_bytes, &error);
+        else
+            ret = pa_simple_read(pa, buf, period_bytes, &error);
+
+        if (ret < 0) {
+            fprintf(stderr, "%s: %s failed on %s: %s\n", __func__, s->playback ? "write" : "read", s->device,
+                    pa_strerror(error));
+            s->error = error;
+            break;
+        }
+
+        t1 = now_us();
+        if (t1 - t0 > s->max_call_us)
+            s->max_call_us = t1 - t0;
+
+        s->calls++;
+        s->frames += period_frames;
+
+        latency = pa_simple_get_latency(pa, &error);
+        if (latency != (pa_usec_t)-1) {
+            if (latency < s->lat_min_us)
+                s->lat_min_us = latency;
+            if (latency > s->lat_max_us)
+                s->lat_max_us = latency;
+            s->lat_sum_us += latency;
+            s->lat_samples++;
+        }
+    }
+
+    if (s->playback)
+        pa_simple_drain(pa, &error);
+
+exit:
+    if (pa)
+        pa_simple_free(pa);
+    free(buf);
+
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [-o sink]... [-i source]... [-t seconds] [-p period_frames] [-r rate] [-c channels]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    bench_stream streams[BENCH_MAX_STREAMS];
+    unsigned n_streams = 0, i;
+    int opt, ret = 0;
+
+    memset(streams, 0, sizeof(streams));
+
+    while ((opt = getopt(argc, argv, "o:i:t:p:r:c:h")) != -1) {
+        switch (opt) {
+            case 'o':
+            case 'i':
+                if (n_streams == BENCH_MAX_STREAMS) {
+                    fprintf(stderr, "too many streams, max %d\n", BENCH_MAX_STREAMS);
+                    return 1;
+                }
+                streams[n_streams].device = optarg;
+                streams[n_streams].playback = (opt == 'o');
+                n_streams++;
+                break;
+            case 't':
+                duration_s = (unsigned)atoi(optarg);
+                break;
+            case 'p':
+                period_frames = (size_t)atoi(optarg);
+                break;
+            case 'r':
+                spec.rate = (uint32_t)atoi(optarg);
+                break;
+            case 'c':
+                spec.channels = (uint8_t)atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (!n_streams || !duration_s || !period_frames || !pa_sample_spec_valid(&spec)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i < n_streams; i++) {
+        if (pthread_create(&streams[i].thread, NULL, bench_thread_func, &streams[i])) {
+            fprintf(stderr, "failed to create thread for %s\n", streams[i].device);
+            streams[i].error = -1;
+            continue;
+        }
+        streams[i].thread_created = true;
+    }
+
+    for (i = 0; i < n_streams; i++) {
+        if (streams[i].thread_created)
+            pthread_join(streams[i].thread, NULL);
+    }
+
+    printf("%-40s %-4s %12s %10s %10s %10s %10s %12s\n", "device", "dir", "frames/s", "calls/s", "lat min",
+           "lat avg", "lat max", "max call us");
+
+    for (i = 0; i < n_streams; i++) {
+        bench_stream *s = &streams[i];
+
+        if (s->error)
+            ret = 1;
+
+        printf("%-40s %-4s %12.1f %10.1f %10llu %10llu %10llu %12llu%s\n", s->device, s->playback ? "out" : "in",
+               (double)s->frames / duration_s, (double)s->calls / duration_s,
+               s->lat_samples ? (unsigned long long)s->lat_min_us : 0ULL,
+               s->lat_samples ? (unsigned long long)(s->lat_sum_us / s->lat_samples) : 0ULL,
+               (unsigned long long)s->lat_max_us, (unsigned long long)s->max_call_us,
+               s->error ? " (error)" : "");
+    }
+
+    return ret;
+}
@@ -0,0 +1,114 @@
+#!/bin/sh
+#
+# Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+# Starts a private pulseaudio instance with module-pal-card built against the
+# PAL stub (--with-pal-stub), plays/records on every pal sink and source
+# concurrently with pa_pal_bench and prints the client and stub reports.
+#
+# usage: pa_pal_bench.sh [-m module_dir] [-c conf_dir] [-t seconds] [-p period_frames] [-v ramp_ms]
+#
+# -v ramps the volume of every pal sink up and down every ramp_ms while the
+# benchmark runs, the stub report then shows underruns caused by control
+# traffic on the write path.
+#
+# The stub is tuned through PAL_STUB_LATENCY_US, PAL_STUB_JITTER_US, PAL_STUB_CONTROL_US,
+# PAL_STUB_PARTIAL_PCT and PAL_STUB_REALTIME, which are passed through.
+
+MODULE_DIR=""
+CONF_DIR="$(dirname "$0")/conf"
+DURATION=10
+PERIOD=480
+RAMP_MS=""
+
+while getopts "m:c:t:p:v:h" opt; do
+    case $opt in
+        m) MODULE_DIR="$OPTARG" ;;
+        c) CONF_DIR="$OPTARG" ;;
+        t) DURATION="$OPTARG" ;;
+        p) PERIOD="$OPTARG" ;;
+        v) RAMP_MS="$OPTARG" ;;
+        *) echo "usage: $0 [-m module_dir] [-c conf_dir] [-t seconds] [-p period_frames] [-v ramp_ms]"; exit 1 ;;
+    esac
+done
+
+[ -d "$CONF_DIR" ] || CONF_DIR="/usr/share/pa_pal_bench"
+
+WORK_DIR=$(mktemp -d)
+export PULSE_RUNTIME_PATH="$WORK_DIR"
+export PULSE_SERVER="unix:$WORK_DIR/native"
+export PAL_STUB_REPORT="$WORK_DIR/stub-report.txt"
+
+cleanup() {
+    [ -n "$RAMP_PID" ] && kill "$RAMP_PID" 2>/dev/null
+    [ -n "$PA_PID" ] && kill "$PA_PID" 2>/dev/null && wait "$PA_PID" 2>/dev/null
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT INT TERM
+
+pulseaudio -n --daemonize=no --exit-idle-time=-1 --disallow-exit \
+    ${MODULE_DIR:+--dl-search-path="$MODULE_DIR"} \
+    -L "module-native-protocol-unix socket=$WORK_DIR/native" \
+    -L "module-pal-card conf_dir_name=$CONF_DIR" \
+    --log-target=file:"$WORK_DIR/pulseaudio.log" &
+PA_PID=$!
+
+i=0
+until pactl info >/dev/null 2>&1; do
+    i=$((i + 1))
+    if [ $i -gt 50 ] || ! kill -0 "$PA_PID" 2>/dev/null; then
+        echo "pulseaudio failed to start"
+        cat "$WORK_DIR/pulseaudio.log"
+        exit 1
+    fi
+    sleep 0.1
+done
+
+ARGS=""
+SINKS=$(pactl list short sinks | awk '{print $2}' | grep pal)
+for sink in $SINKS; do
+    ARGS="$ARGS -o $sink"
+done
+for source in $(pactl list short sources | awk '{print $2}' | grep pal | grep -v '\.monitor$'); do
+    ARGS="$ARGS -i $source"
+done
+
+if [ -z "$ARGS" ]; then
+    echo "no pal sinks or sources found"
+    exit 1
+fi
+
+if [ -n "$RAMP_MS" ]; then
+    (
+        SLEEP=$(awk "BEGIN { print $RAMP_MS / 1000 }")
+        while true; do
+            for vol in 20 40 60 80 100 80 60 40; do
+                for sink in $SINKS; do
+                    pactl set-sink-volume "$sink" "$vol%"
+                done
+                sleep "$SLEEP"
+            done
+        done
+    ) &
+    RAMP_PID=$!
+fi
+
+pa_pal_bench -t "$DURATION" -p "$PERIOD" $ARGS
+RET=$?
+
+if [ -n "$RAMP_PID" ]; then
+    kill "$RAMP_PID" 2>/dev/null
+    wait "$RAMP_PID" 2>/dev/null
+    RAMP_PID=""
+fi
+
+kill "$PA_PID" 2>/dev/null
+wait "$PA_PID" 2>/dev/null
+PA_PID=""
+
+echo
+echo "PAL stub report:"
+cat "$PAL_STUB_REPORT" 2>/dev/null
+
+exit $RET
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Feeds the position DLL of module-pal-card a simulated DSP position with
+ * timestamp jitter and clock drift, then a seek and a stall, and checks that
+ * the output stays monotonic, converges, never leads the raw position by more
+ * than PA_PAL_CLOCK_DLL_MAX_LEAD_US and restarts on the jump. Runs on the
+ * host, exits non zero on the first failed check.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pal-clock.h"
+
+#define TEST_PERIOD_US 10000
+#define TEST_JITTER_US 1000
+#define TEST_DRIFT 1.0005 /* DSP clock against the system counter */
+#define TEST_SETTLE_US 10000000ULL
+#define TEST_MAX_SETTLED_ERROR_US 1000
+#define TEST_SEEK_US 1000000ULL
+#define TEST_STALL_US 200000ULL
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAIL %s:%d: ", __func__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            failures++; \
+            return; \
+        } \
+    } while (0)
+
+static int64_t jitter(void) {
+    return (int64_t)(rand() % (2 * TEST_JITTER_US + 1)) - TEST_JITTER_US;
+}
+
+static uint64_t raw_pos(uint64_t true_pos) {
+    int64_t j = jitter();
+
+    return j < 0 && (uint64_t)-j > true_pos ? 0 : (uint64_t)((int64_t)true_pos + j);
+}
+
+static int64_t diff(uint64_t a, uint64_t b) {
+    return (int64_t)a - (int64_t)b;
+}
+
+/* runs the loop for duration_us from clock and true position, returns the last output */
+static bool settle(pa_pal_clock_dll *dll, uint64_t *clock, double *true_pos, uint64_t duration_us,
+                   uint64_t *out) {
+    uint64_t end = *clock + duration_us, raw, pos, last = 0;
+    bool first = true;
+
+    for (; *clock < end; *clock += TEST_PERIOD_US, *true_pos += TEST_PERIOD_US * TEST_DRIFT) {
+        raw = raw_pos((uint64_t)*true_pos);
+        pos = pa_pal_clock_dll_update(dll, *clock, raw);
+
+        if (!first && pos < last) {
+            fprintf(stderr, "output went back from %llu to %llu\n", (unsigned long long)last,
+                    (unsigned long long)pos);
+            return false;
+        }
+        if (pos > raw + PA_PAL_CLOCK_DLL_MAX_LEAD_US) {
+            fprintf(stderr, "output %llu leads raw %llu\n", (unsigned long long)pos, (unsigned long long)raw);
+            return false;
+        }
+
+        first = false;
+        last = pos;
+    }
+
+    *out = last;
+    return true;
+}
+
+static void test_converges(void) {
+    pa_pal_clock_dll dll;
+    uint64_t clock = 1000000, pos;
+    double true_pos = 0;
+
+    pa_pal_clock_dll_reset(&dll);
+
+    CHECK(settle(&dll, &clock, &true_pos, TEST_SETTLE_US, &pos), "not monotonic or leading while settling");
+    CHECK(llabs(diff(pos, (uint64_t)(true_pos - TEST_PERIOD_US * TEST_DRIFT))) < TEST_MAX_SETTLED_ERROR_US,
+          "settled error %lld us", (long long)diff(pos, (uint64_t)(true_pos - TEST_PERIOD_US * TEST_DRIFT)));
+    CHECK(dll.rate > TEST_DRIFT - 0.0005 && dll.rate < TEST_DRIFT + 0.0005, "rate %f", dll.rate);
+}
+
+static void test_resets_on_jump(void) {
+    pa_pal_clock_dll dll;
+    uint64_t clock = 1000000, pos, raw;
+    double true_pos = 0;
+
+    pa_pal_clock_dll_reset(&dll);
+    CHECK(settle(&dll, &clock, &true_pos, TEST_SETTLE_US, &pos), "not monotonic or leading while settling");
+
+    /* seek forward, the output follows right away */
+    true_pos += TEST_SEEK_US;
+    raw = raw_pos((uint64_t)true_pos);
+    pos = pa_pal_clock_dll_update(&dll, clock, raw);
+    CHECK(pos == raw, "output %llu after a seek to %llu", (unsigned long long)pos, (unsigned long long)raw);
+
+    /* flush back to 0 */
+    clock += TEST_PERIOD_US;
+    pos = pa_pal_clock_dll_update(&dll, clock, 0);
+    CHECK(pos == 0, "output %llu after a flush", (unsigned long long)pos);
+
+    /* a clock going back restarts as well */
+    pos = pa_pal_clock_dll_update(&dll, clock - TEST_PERIOD_US, 5000);
+    CHECK(pos == 5000, "output %llu after the clock went back", (unsigned long long)pos);
+}
+
+static void test_stall(void) {
+    pa_pal_clock_dll dll;
+    uint64_t clock = 1000000, pos, stalled, end;
+    double true_pos = 0;
+    int64_t lead, max_lead = 0;
+
+    pa_pal_clock_dll_reset(&dll);
+    CHECK(settle(&dll, &clock, &true_pos, TEST_SETTLE_US, &pos), "not monotonic or leading while settling");
+
+    /* the DSP stops advancing, the output must not run away from it */
+    stalled = (uint64_t)true_pos;
+    for (end = clock + TEST_STALL_US; clock < end; clock += TEST_PERIOD_US) {
+        pos = pa_pal_clock_dll_update(&dll, clock, stalled);
+        lead = diff(pos, stalled);
+        max_lead = lead > max_lead ? lead : max_lead;
+    }
+    CHECK(max_lead <= PA_PAL_CLOCK_DLL_MAX_LEAD_US, "led a stalled DSP by %lld us", (long long)max_lead);
+
+    /* and it locks again once the DSP resumes from where it stopped */
+    true_pos = (double)stalled;
+    CHECK(settle(&dll, &clock, &true_pos, TEST_SETTLE_US, &pos), "not monotonic or leading after the stall");
+    CHECK(llabs(diff(pos, (uint64_t)(true_pos - TEST_PERIOD_US * TEST_DRIFT))) < TEST_MAX_SETTLED_ERROR_US,
+          "error %lld us after the stall", (long long)diff(pos, (uint64_t)(true_pos - TEST_PERIOD_US * TEST_DRIFT)));
+}
+
+int main(void) {
+    srand(1);
+
+    test_converges();
+    test_resets_on_jump();
+    test_stall();
+
+    if (failures) {
+        fprintf(stderr, "%d failed\n", failures);
+        return 1;
+    }
+
+    printf("pal-clock DLL: all passed\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Times the packed 24 bit converters of module-pal-card, every implementation
+ * the CPU runs against the scalar one, and checks that they give bit
+ * identical output. Runs on the host or on target, no PAL needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <pulse/sample.h>
+
+#include "pal-pcm-convert.h"
+
+#define BENCH_DEFAULT_FRAMES 480
+#define BENCH_DEFAULT_CHANNELS 8
+#define BENCH_DEFAULT_ITERATIONS 20000
+
+static const pa_sample_format_t formats[] = {
+    PA_SAMPLE_FLOAT32LE,
+    PA_SAMPLE_S32LE,
+    PA_SAMPLE_S24_32LE,
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* full scale noise plus out of range floats to exercise clamping */
+static void fill_host(void *buf, size_t n, pa_sample_format_t format) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+        if (format == PA_SAMPLE_FLOAT32LE)
+            ((float *)buf)[i] = ((float)(int32_t)r / 2147483648.0f) * 1.25f;
+        else if (format == PA_SAMPLE_S24_32LE)
+            ((int32_t *)buf)[i] = (int32_t)(r << 8) >> 8;
+        else
+            ((int32_t *)buf)[i] = (int32_t)r;
+    }
+}
+
+static double time_ns(pa_pal_pcm_convert_func_t f, void *dst, const void *src, size_t n, unsigned iterations) {
+    uint64_t start;
+    unsigned i;
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++)
+        f(dst, src, n);
+
+    return (double)(now_ns() - start) / iterations;
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [-f frames] [-c channels] [-n iterations]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    size_t frames = BENCH_DEFAULT_FRAMES, channels = BENCH_DEFAULT_CHANNELS, n;
+    unsigned iterations = BENCH_DEFAULT_ITERATIONS, i;
+    uint8_t *host, *packed, *unpacked, *out;
+    int opt, impl, ret = 0;
+
+    while ((opt = getopt(argc, argv, "f:c:n:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                frames = (size_t)atoi(optarg);
+                break;
+            case 'c':
+                channels = (size_t)atoi(optarg);
+                break;
+            case 'n':
+                iterations = (unsigned)atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (!frames || !channels || !iterations) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    n = frames * channels;
+    host = malloc(n * PA_PAL_PCM_CONVERT_HOST_BYTES);
+    packed = malloc(n * PA_PAL_PCM_CONVERT_PACKED_BYTES);
+    unpacked = malloc(n * PA_PAL_PCM_CONVERT_HOST_BYTES);
+    out = malloc(n * PA_PAL_PCM_CONVERT_HOST_BYTES);
+    if (!host || !packed || !unpacked || !out) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("%zu frames x %zu channels, %u iterations, best %s\n", frames, channels, iterations,
+           pa_pal_pcm_convert_impl_to_string(pa_pal_pcm_convert_best()));
+    printf("%-10s %-8s %-6s %12s %10s %s\n", "format", "dir", "impl", "ns/buffer", "speedup", "exact");
+
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        pa_sample_format_t format = formats[i];
+        double pack_ref = 0, unpack_ref = 0, t;
+
+        fill_host(host, n, format);
+
+        for (impl = 0; impl < PA_PAL_PCM_CONVERT_MAX; impl++) {
+            pa_pal_pcm_convert_func_t pack, unpack;
+            bool exact;
+
+            if (!pa_pal_pcm_convert_impl_available(impl))
+                continue;
+
+            pack = pa_pal_pcm_convert_get_pack(impl, format);
+            unpack = pa_pal_pcm_convert_get_unpack(impl, format);
+            if (!pack || !unpack)
+                continue;
+
+            /* scalar runs first, its output is the reference for the others */
+            t = time_ns(pack, out, host, n, iterations);
+            if (impl == PA_PAL_PCM_CONVERT_SCALAR) {
+                pack_ref = t;
+                memcpy(packed, out, n * PA_PAL_PCM_CONVERT_PACKED_BYTES);
+            }
+            exact = !memcmp(packed, out, n * PA_PAL_PCM_CONVERT_PACKED_BYTES);
+            printf("%-10s %-8s %-6s %12.0f %9.2fx %s\n", pa_sample_format_to_string(format), "pack",
+                   pa_pal_pcm_convert_impl_to_string(impl), t, pack_ref / t, exact ? "yes" : "NO");
+            ret |= !exact;
+
+            t = time_ns(unpack, out, packed, n, iterations);
+            if (impl == PA_PAL_PCM_CONVERT_SCALAR) {
+                unpack_ref = t;
+                memcpy(unpacked, out, n * PA_PAL_PCM_CONVERT_HOST_BYTES);
+            }
+            exact = !memcmp(unpacked, out, n * PA_PAL_PCM_CONVERT_HOST_BYTES);
+            printf("%-10s %-8s %-6s %12.0f %9.2fx %s\n", pa_sample_format_to_string(format), "unpack",
+                   pa_pal_pcm_convert_impl_to_string(impl), t, unpack_ref / t, exact ? "yes" : "NO");
+            ret |= !exact;
+        }
+    }
+
+    free(host);
+    free(packed);
+    free(unpacked);
+    free(out);
+
+    return ret;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2025 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Loads a number of voice UI sessions against a stubbed pal_stream_read and
+ * drains the look-ahead buffer of some of them, once with a read thread per
+ * session as module-pal-voiceui-card used to, once on the shared pal-worker
+ * pool it uses now. The stub delivers 16 kHz mono S16 in real time after a
+ * preroll, like the DSP does after a detection, and drops what is not read
+ * within its buffer. Runs on the host or on target, no PAL needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <pulse/xmalloc.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/mutex.h>
+#include <pulsecore/thread.h>
+
+#include "pal-worker.h"
+
+#define BENCH_RATE 32000 /* bytes/s */
+#define BENCH_CHUNK 3840 /* what the module reads per step */
+#define BENCH_PREROLL 32000 /* history buffered at detection */
+#define BENCH_DSP_BUFFER 64000 /* older than this is dropped */
+#define BENCH_DEFAULT_SESSIONS 16
+#define BENCH_DEFAULT_CAPTURING 2
+#define BENCH_DEFAULT_THREADS 2
+#define BENCH_DEFAULT_SECONDS 5
+#define BENCH_NSEC_PER_SEC 1000000000ULL
+
+typedef struct {
+    unsigned index;
+    bool capturing;
+    bool quit;
+    pa_mutex *mutex;
+    pa_cond *cond;
+    pa_thread *thread;
+    uint8_t buf[BENCH_CHUNK];
+
+    /* stub DSP */
+    uint64_t start_ns;
+    uint64_t consumed;
+    uint64_t dropped;
+    uint64_t lag; /* bytes left in the DSP after the last read */
+
+    uint64_t chunks;
+    uint64_t last_ns;
+    uint64_t max_gap_ns;
+} bench_session;
+
+typedef struct {
+    const char *name;
+    unsigned threads;
+    double load_ms;
+    double unload_ms;
+    double cpu_ms;
+    long csw;
+    double max_lag_ms; /* how far behind real time a capturing session ended up */
+    double fairness;
+    uint64_t max_gap_ns;
+    uint64_t dropped;
+} bench_result;
+
+static pa_pal_worker *pool;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * BENCH_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts;
+
+    ts.tv_sec = ns / BENCH_NSEC_PER_SEC;
+    ts.tv_nsec = ns % BENCH_NSEC_PER_SEC;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+static double cpu_ms(void) {
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e3 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e3;
+}
+
+static long context_switches(void) {
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+/* pal_stream_read of a lab stream: blocks until a chunk is there */
+static void stub_read(bench_session *s) {
+    uint64_t produced, available, t;
+
+    for (;;) {
+        produced = BENCH_PREROLL + (now_ns() - s->start_ns) * BENCH_RATE / BENCH_NSEC_PER_SEC;
+        if (produced - s->consumed > BENCH_DSP_BUFFER) {
+            s->dropped += produced - s->consumed - BENCH_DSP_BUFFER;
+            s->consumed = produced - BENCH_DSP_BUFFER;
+        }
+
+        available = produced - s->consumed;
+        if (available >= BENCH_CHUNK)
+            break;
+
+        sleep_ns((BENCH_CHUNK - available) * BENCH_NSEC_PER_SEC / BENCH_RATE + 1000);
+    }
+
+    memset(s->buf, (int)s->index, sizeof(s->buf));
+    s->consumed += BENCH_CHUNK;
+    s->lag = available - BENCH_CHUNK;
+    s->chunks++;
+
+    t = now_ns();
+    if (s->last_ns && t - s->last_ns > s->max_gap_ns)
+        s->max_gap_ns = t - s->last_ns;
+    s->last_ns = t;
+}
+
+/* the read thread a session had before, idle ones wait for a detection that does not come */
+static void session_thread_func(void *userdata) {
+    bench_session *s = userdata;
+
+    pa_mutex_lock(s->mutex);
+    while (!s->quit) {
+        if (!s->capturing) {
+            pa_cond_wait(s->cond, s->mutex);
+            continue;
+        }
+
+        pa_mutex_unlock(s->mutex);
+        stub_read(s);
+        pa_mutex_lock(s->mutex);
+    }
+    pa_mutex_unlock(s->mutex);
+}
+
+/* one chunk per job, then behind the other sessions, like session_work() */
+static void session_step(void *userdata) {
+    bench_session *s = userdata;
+
+    stub_read(s);
+
+    pa_mutex_lock(s->mutex);
+    if (!s->quit)
+        pa_pal_worker_post(pool, s, session_step, s);
+    pa_mutex_unlock(s->mutex);
+}
+
+static void run(bench_session *sessions, unsigned n_sessions, unsigned n_capturing, unsigned n_threads,
+                unsigned seconds, bench_result *r) {
+    double cpu, sum = 0, sum_sq = 0, lag_ms;
+    uint64_t t, start;
+    long csw;
+    unsigned i;
+    char *name;
+
+    cpu = cpu_ms();
+    csw = context_switches();
+
+    t = now_ns();
+    if (n_threads)
+        pool = pa_pal_worker_new_pool("bench-read", n_threads, NULL, NULL);
+
+    for (i = 0; i < n_sessions; i++) {
+        bench_session *s = &sessions[i];
+
+        memset(s, 0, sizeof(*s));
+        s->index = i;
+        s->mutex = pa_mutex_new(false, false);
+
+        if (!n_threads) {
+            s->cond = pa_cond_new();
+            name = pa_sprintf_malloc("pal read thread%u", i);
+            s->thread = pa_thread_new(name, session_thread_func, s);
+            pa_xfree(name);
+        }
+    }
+    r->load_ms = (double)(now_ns() - t) / 1e6;
+    r->threads = n_threads ? n_threads : n_sessions;
+
+    /* detection on the first n_capturing sessions */
+    start = now_ns();
+    for (i = 0; i < n_capturing; i++) {
+        bench_session *s = &sessions[i];
+
+        pa_mutex_lock(s->mutex);
+        s->start_ns = start;
+        s->capturing = true;
+        if (n_threads)
+            pa_pal_worker_post(pool, s, session_step, s);
+        else
+            pa_cond_signal(s->cond, 0);
+        pa_mutex_unlock(s->mutex);
+    }
+
+    sleep_ns((uint64_t)seconds * BENCH_NSEC_PER_SEC);
+
+    t = now_ns();
+    for (i = 0; i < n_sessions; i++) {
+        bench_session *s = &sessions[i];
+
+        pa_mutex_lock(s->mutex);
+        s->quit = true;
+        if (!n_threads)
+            pa_cond_signal(s->cond, 0);
+        pa_mutex_unlock(s->mutex);
+
+        if (n_threads) {
+            pa_pal_worker_cancel(pool, s);
+        } else {
+            pa_thread_free(s->thread);
+            pa_cond_free(s->cond);
+        }
+        pa_mutex_free(s->mutex);
+    }
+    pa_pal_worker_free(pool);
+    pool = NULL;
+    r->unload_ms = (double)(now_ns() - t) / 1e6;
+
+    r->cpu_ms = cpu_ms() - cpu;
+    r->csw = context_switches() - csw;
+    r->max_lag_ms = 0;
+    r->max_gap_ns = 0;
+    r->dropped = 0;
+
+    for (i = 0; i < n_capturing; i++) {
+        bench_session *s = &sessions[i];
+
+        lag_ms = (double)s->lag * 1e3 / BENCH_RATE;
+        r->max_lag_ms = lag_ms > r->max_lag_ms ? lag_ms : r->max_lag_ms;
+        sum += (double)s->chunks;
+        sum_sq += (double)s->chunks * (double)s->chunks;
+        r->max_gap_ns = s->max_gap_ns > r->max_gap_ns ? s->max_gap_ns : r->max_gap_ns;
+        r->dropped += s->dropped;
+    }
+
+    /* Jain's index over chunks read, 1 is perfectly even */
+    r->fairness = sum_sq ? (sum * sum) / (n_capturing * sum_sq) : 1;
+}
+
+static void print_result(const bench_result *r) {
+    printf("%-8s %7u %9.2f %9.2f %9.1f %8ld %8.3f %9.1f %9.1f %9" PRIu64 "\n", r->name, r->threads,
+           r->load_ms, r->unload_ms, r->cpu_ms, r->csw, r->fairness, (double)r->max_gap_ns / 1e6,
+           r->max_lag_ms, r->dropped);
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [-s sessions] [-c capturing] [-t pool threads] [-d seconds]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned n_sessions = BENCH_DEFAULT_SESSIONS, n_capturing = BENCH_DEFAULT_CAPTURING;
+    unsigned n_threads = BENCH_DEFAULT_THREADS, seconds = BENCH_DEFAULT_SECONDS;
+    bench_session *sessions;
+    bench_result r;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:c:t:d:h")) != -1) {
+        switch (opt) {
+            case 's':
+                n_sessions = (unsigned)atoi(optarg);
+                break;
+            case 'c':
+                n_capturing = (unsigned)atoi(optarg);
+                break;
+            case 't':
+                n_threads = (unsigned)atoi(optarg);
+                break;
+            case 'd':
+                seconds = (unsigned)atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (!n_sessions || n_capturing > n_sessions || !n_threads || !seconds) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sessions = pa_xnew0(bench_session, n_sessions);
+
+    printf("%u sessions, %u capturing, %u pool threads, %u s\n", n_sessions, n_capturing, n_threads, seconds);
+    printf("%-8s %7s %9s %9s %9s %8s %8s %9s %9s %9s\n", "mode", "threads", "load ms", "unload ms",
+           "cpu ms", "ctxsw", "fair", "gap ms", "lag ms", "dropped");
+
+    memset(&r, 0, sizeof(r));
+    r.name = "thread";
+    run(sessions, n_sessions, n_capturing, 0, seconds, &r);
+    print_result(&r);
+
+    memset(&r, 0, sizeof(r));
+    r.name = "pool";
+    run(sessions, n_sessions, n_capturing, n_threads, seconds, &r);
+    print_result(&r);
+
+    pa_xfree(sessions);
+
+    return 0;
+}
@@ -32,7 +32,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib/gprintf.h>
 
 #include "pa_pal_voiceui.h"
@@ -45,17 +50,32 @@
 #define PA_QST_DBUS_ASYNC_CALL_TIMEOUT_MS 1000
 
 #define PA_QST_DBUS_MODULE_IFACE_VERSION_101 0x101
+#define PA_QST_DBUS_MODULE_IFACE_VERSION_102 0x102
+#define PA_QST_DBUS_MODULE_IFACE_VERSION_103 0x103
+#define PA_QST_DBUS_MODULE_IFACE_VERSION_104 0x104
+#define PA_QST_MAX_READ_DEPTH 8
+#define PA_QST_SM_MEMFDS 4 /* sealed memfds kept, one per recently loaded model */
 
 #ifndef memscpy
 #define memscpy(dst, dst_size, src, bytes_to_copy) \
         (void) memcpy(dst, src, MIN(dst_size, bytes_to_copy))
 #endif
 
+struct pa_qst_sm_memfd {
+    gint fd;
+    void *map;
+    gsize size;
+};
+
 struct pa_qst_module_data {
     GDBusConnection *conn;
     char g_obj_path[PA_QST_DBUS_MODULE_OBJ_PATH_SIZE];
     GHashTable *ses_hash_table;
     guint interface_version;
+
+    /* sealed memfds of the models sent last, most recently used first. One is
+     * sent again for the same model, so alternating models hit the server cache */
+    struct pa_qst_sm_memfd sm_memfds[PA_QST_SM_MEMFDS];
 };
 
 struct pa_qst_session_data {
@@ -76,8 +96,86 @@ struct pa_qst_session_data {
     guint read_bytes_received;
     gint stop_buffering_status;
     volatile guint read_buffer_sequence;
+
+    /* lab ring shared with the server, NULL when reads go over D-Bus */
+    guint sub_id_lab_event;
+    guchar *lab_ring;
+    gsize lab_ring_size;
+    guint64 lab_read_index;
+    guint64 lab_server_read_index; /* ahead of ours when the server flushed or dropped data */
+    guint64 lab_write_index;
+    gint lab_read_status;
+    /* flush generation in the page after the ring, NULL if the server has none */
+    guint32 *lab_flush_gen;
+    guint32 lab_answer_gen; /* when the last answer arrived, a copy made after a flush is dropped */
+    gsize lab_map_size;
+
+    /* asynchronous reads, see pa_qst_start_read */
+    pa_qst_ses_handle_t handle;
+    pa_qst_read_callback_t read_callback;
+    void *read_cookie;
+    guint read_chunk;
+    guint read_delivered;
+    guint read_depth;
+    guint read_outstanding; /* requests the server has not answered yet */
 };
 
+static void on_read_queued(GObject *source, GAsyncResult *res, gpointer data) {
+    GError *error = NULL;
+    GVariant *result;
+
+    result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    if (result == NULL) {
+        g_printerr("Error queueing asynchronous read: %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    g_variant_unref(result);
+}
+
+/* the answer arrives as a signal, the call itself is not waited for */
+static void queue_read(GDBusConnection *conn, struct pa_qst_session_data *ses_data) {
+    if (ses_data->lab_ring)
+        g_dbus_connection_call(conn,
+                               NULL,
+                               ses_data->obj_path,
+                               PA_QST_DBUS_SESSION_IFACE,
+                               "RequestLabRead",
+                               g_variant_new("(ut)", ses_data->read_chunk, ses_data->lab_read_index),
+                               NULL,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               NULL,
+                               on_read_queued,
+                               NULL);
+    else
+        g_dbus_connection_call(conn,
+                               NULL,
+                               ses_data->obj_path,
+                               PA_QST_DBUS_SESSION_IFACE,
+                               "RequestReadBuffer",
+                               g_variant_new("(u)", ses_data->read_chunk),
+                               NULL,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               NULL,
+                               on_read_queued,
+                               NULL);
+}
+
+/*
+ * Called with the session mutex held. Tops the server's queue back up to the
+ * requested depth after every answer, error or not, and after a detection,
+ * which drops whatever the server had queued.
+ */
+static void refill_reads(GDBusConnection *conn, struct pa_qst_session_data *ses_data) {
+    while (ses_data->read_callback && ses_data->read_outstanding < ses_data->read_depth) {
+        queue_read(conn, ses_data);
+        ses_data->read_outstanding++;
+    }
+}
+
 static pa_qst_ses_handle_t parse_ses_handle(char *obj_path) {
     char **handle_string;
     pa_qst_ses_handle_t handle;
@@ -119,6 +217,24 @@ static void on_read_buffer_available_event(GDBusConnection *conn,
         g_warning("missed read_buffer_available event! last seq %u, cur seq %u\n",
                     ses_data->read_buffer_sequence, read_buffer_sequence);
 
+    g_mutex_lock(&ses_data->mutex);
+    if (ses_data->read_callback) {
+        ses_data->read_buffer_sequence = read_buffer_sequence;
+        array_v = status < 0 ? NULL : g_variant_iter_next_value(&arg_i);
+        value = array_v ? g_variant_get_fixed_array(array_v, &n_elements, element_size) : NULL;
+        ses_data->read_callback(ses_data->handle, value ? 0 : (status < 0 ? status : -EIO),
+                                ++ses_data->read_delivered, (const unsigned char *)value, n_elements,
+                                ses_data->read_cookie);
+        if (array_v)
+            g_variant_unref(array_v);
+        if (ses_data->read_outstanding)
+            ses_data->read_outstanding--;
+        refill_reads(conn, ses_data);
+        g_mutex_unlock(&ses_data->mutex);
+        return;
+    }
+    g_mutex_unlock(&ses_data->mutex);
+
     if (ses_data->read_bytes_requested == 0 || status < 0) {
         g_printerr ("Error reading buffer bytes (%d), seq(%u) status(%d)\n",
                     ses_data->read_bytes_requested, read_buffer_sequence, status);
@@ -246,6 +362,238 @@ exit:
     return ret;
 }
 
+static guint32 lab_flush_gen(struct pa_qst_session_data *ses_data) {
+    return ses_data->lab_flush_gen ? __atomic_load_n(ses_data->lab_flush_gen, __ATOMIC_ACQUIRE) : 0;
+}
+
+/* called with the session mutex held, hands out everything new straight from the ring */
+static void deliver_lab_reads(struct pa_qst_session_data *ses_data,
+                              gint status, guint64 read_index, guint64 write_index) {
+    guint64 index;
+    gsize offset, n;
+
+    if (status < 0) {
+        ses_data->read_callback(ses_data->handle, status, ++ses_data->read_delivered, NULL, 0,
+                                ses_data->read_cookie);
+        return;
+    }
+
+    /* the server keeps this range until a later request moves the read index past it */
+    index = MAX(ses_data->lab_read_index, read_index);
+    while (index < write_index) {
+        /* a detection flushed the ring since the answer, the rest is from before it */
+        if (lab_flush_gen(ses_data) != ses_data->lab_answer_gen) {
+            g_printf("lab ring flushed, dropping %" G_GUINT64_FORMAT " bytes\n", write_index - index);
+            index = write_index;
+            break;
+        }
+        offset = index % ses_data->lab_ring_size;
+        n = MIN(MIN((guint64)ses_data->read_chunk, write_index - index), ses_data->lab_ring_size - offset);
+        ses_data->read_callback(ses_data->handle, 0, ++ses_data->read_delivered,
+                                ses_data->lab_ring + offset, n, ses_data->read_cookie);
+        index += n;
+    }
+    ses_data->lab_read_index = index;
+}
+
+static void on_lab_read_available_event(GDBusConnection *conn,
+                                  const gchar *sender_name,
+                                  const gchar *object_path,
+                                  const gchar *interface_name,
+                                  const gchar *signal_name,
+                                  GVariant *parameters,
+                                  gpointer data) {
+    struct pa_qst_session_data *ses_data = (struct pa_qst_session_data *)data;
+    guint read_buffer_sequence = 0;
+    guint64 read_index = 0, write_index = 0;
+    gint status = 0;
+
+    if (!parameters) {
+        g_printerr("params received as NULL in lab read avail event\n");
+        return;
+    }
+    g_variant_get(parameters, "(uitt)", &read_buffer_sequence, &status, &read_index, &write_index);
+
+    if (read_buffer_sequence != ses_data->read_buffer_sequence + 1)
+        g_warning("missed lab_read_available event! last seq %u, cur seq %u\n",
+                    ses_data->read_buffer_sequence, read_buffer_sequence);
+
+    g_mutex_lock(&ses_data->mutex);
+    ses_data->lab_answer_gen = lab_flush_gen(ses_data);
+    if (ses_data->read_callback) {
+        ses_data->read_buffer_sequence = read_buffer_sequence;
+        deliver_lab_reads(ses_data, status, read_index, write_index);
+        if (ses_data->read_outstanding)
+            ses_data->read_outstanding--;
+        refill_reads(conn, ses_data);
+        g_mutex_unlock(&ses_data->mutex);
+        return;
+    }
+
+    ses_data->lab_read_status = status;
+    ses_data->lab_server_read_index = read_index;
+    ses_data->lab_write_index = write_index;
+    ses_data->read_buffer_sequence = read_buffer_sequence;
+    g_cond_signal(&ses_data->cond);
+    g_mutex_unlock(&ses_data->mutex);
+}
+
+static int subscribe_lab_read_available_event(struct pa_qst_module_data *m_data,
+                                     struct pa_qst_session_data *ses_data,
+                                     bool subscribe) {
+    GVariant *result;
+    GVariant *argument_sig_listener = NULL;
+    GError *error = NULL;
+    char signal_name[128];
+
+    g_snprintf(signal_name, sizeof(signal_name),
+               "%s.%s", PA_QST_DBUS_SESSION_IFACE, "LabReadAvailableEvent");
+    if (subscribe) {
+        /* one core listener for all sessions, as for the other session signals */
+        if (g_hash_table_size(m_data->ses_hash_table) == 0) {
+            const gchar *obj_str[] = {};
+            argument_sig_listener = g_variant_new("(@s@ao)",
+                            g_variant_new_string(signal_name),
+                            g_variant_new_objv(obj_str, 0));
+            result = g_dbus_connection_call_sync(m_data->conn,
+                                    NULL,
+                                    "/org/pulseaudio/core1",
+                                    "org.PulseAudio.Core1",
+                                    "ListenForSignal",
+                                    argument_sig_listener,
+                                    NULL,
+                                    G_DBUS_CALL_FLAGS_NONE,
+                                    -1,
+                                    NULL,
+                                    &error);
+            if (result == NULL) {
+                g_printerr ("Error invoking ListenForSignal(): %s\n", error->message);
+                g_error_free(error);
+                return -EINVAL;
+            }
+            g_variant_unref(result);
+        }
+
+        ses_data->sub_id_lab_event = g_dbus_connection_signal_subscribe(m_data->conn,
+                           NULL,
+                           PA_QST_DBUS_SESSION_IFACE,
+                           "LabReadAvailableEvent",
+                           ses_data->obj_path,
+                           NULL,
+                           G_DBUS_SIGNAL_FLAGS_NONE,
+                           on_lab_read_available_event,
+                           ses_data,
+                           NULL);
+    } else {
+        if (g_hash_table_size(m_data->ses_hash_table) == 1) {
+            argument_sig_listener = g_variant_new("(@s)",
+                            g_variant_new_string(signal_name));
+            result = g_dbus_connection_call_sync(m_data->conn,
+                                    NULL,
+                                    "/org/pulseaudio/core1",
+                                    "org.PulseAudio.Core1",
+                                    "StopListeningForSignal",
+                                    argument_sig_listener,
+                                    NULL,
+                                    G_DBUS_CALL_FLAGS_NONE,
+                                    -1,
+                                    NULL,
+                                    &error);
+            if (result == NULL) {
+                g_printerr ("Error invoking StopListeningForSignal(): %s\n", error->message);
+                g_error_free(error);
+                return -EINVAL;
+            }
+            g_variant_unref(result);
+        }
+
+        if (ses_data->sub_id_lab_event)
+            g_dbus_connection_signal_unsubscribe(m_data->conn, ses_data->sub_id_lab_event);
+        ses_data->sub_id_lab_event = 0;
+    }
+
+    return 0;
+}
+
+/* maps the server's lab ring read-only, reads then no longer carry the data over D-Bus */
+static int map_lab_ring(struct pa_qst_module_data *m_data,
+                        struct pa_qst_session_data *ses_data) {
+    GVariant *result;
+    GUnixFDList *fd_list = NULL;
+    GError *error = NULL;
+    gint32 fd_index;
+    guint32 size;
+    gsize map_size;
+    struct stat st;
+    void *ring;
+    gint fd;
+
+    if (m_data->interface_version < PA_QST_DBUS_MODULE_IFACE_VERSION_102)
+        return -ENOSYS;
+
+    result = g_dbus_connection_call_with_unix_fd_list_sync(m_data->conn,
+                            NULL,
+                            ses_data->obj_path,
+                            PA_QST_DBUS_SESSION_IFACE,
+                            "GetLabRing",
+                            NULL,
+                            G_VARIANT_TYPE("(hu)"),
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            NULL,
+                            &fd_list,
+                            NULL,
+                            &error);
+    if (result == NULL) {
+        g_printerr ("Error invoking GetLabRing(): %s\n", error->message);
+        g_error_free(error);
+        return -EINVAL;
+    }
+
+    g_variant_get(result, "(hu)", &fd_index, &size);
+    g_variant_unref(result);
+
+    fd = fd_list ? g_unix_fd_list_get(fd_list, fd_index, &error) : -1;
+    if (fd_list)
+        g_object_unref(fd_list);
+    if (fd < 0) {
+        g_printerr("No lab ring fd received: %s\n", error ? error->message : "no fd list");
+        if (error)
+            g_error_free(error);
+        return -EINVAL;
+    }
+
+    /* a server that publishes the flush generation has its page after the ring */
+    map_size = size;
+    if (fstat(fd, &st) == 0 && (gsize)st.st_size >= size + sizeof(guint32))
+        map_size = (gsize)st.st_size;
+
+    ring = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        g_printerr("Could not map lab ring of %u bytes: %s\n", size, strerror(errno));
+        close(fd);
+        return -EINVAL;
+    }
+    close(fd);
+
+    if (subscribe_lab_read_available_event(m_data, ses_data, true /* subscribe */)) {
+        munmap(ring, map_size);
+        return -EINVAL;
+    }
+
+    ses_data->lab_ring = (guchar *)ring;
+    ses_data->lab_ring_size = size;
+    ses_data->lab_map_size = map_size;
+    ses_data->lab_flush_gen = map_size > size ? (guint32 *)((guchar *)ring + size) : NULL;
+    ses_data->lab_answer_gen = lab_flush_gen(ses_data);
+    ses_data->lab_read_index = 0;
+    ses_data->lab_server_read_index = 0;
+    ses_data->lab_write_index = 0;
+    g_printf("lab ring of %u bytes mapped\n", size);
+
+    return 0;
+}
+
 static void on_stop_buffering_done_event(GDBusConnection *conn,
                                   const gchar *sender_name,
                                   const gchar *object_path,
@@ -389,6 +737,12 @@ static void on_det_event_callback(GDBusConnection *conn,
         return;
     }
     g_printf("signal handler: Ondetection event signal received\n");
+
+    /* the server dropped every queued read on detection */
+    g_mutex_lock(&ses_data->mutex);
+    ses_data->read_outstanding = 0;
+    refill_reads(conn, ses_data);
+    g_mutex_unlock(&ses_data->mutex);
     uint32_t frame_count = 0;
     uint32_t *sess_id = (uint32_t *)ses_data->cookie;
 
@@ -593,6 +947,14 @@ static gint unload_sm(struct pa_qst_module_data *m_data,
         g_printerr("Failed to unsubscribe for stop buffering event");
     }
 
+    if (ses_data->lab_ring) {
+        if (subscribe_lab_read_available_event(m_data, ses_data, false /*unsubscribe */))
+            g_printerr("Failed to unsubscribe for lab read event");
+        munmap(ses_data->lab_ring, ses_data->lab_map_size);
+        ses_data->lab_ring = NULL;
+        ses_data->lab_flush_gen = NULL;
+    }
+
     g_cond_clear(&ses_data->cond);
     g_mutex_clear(&ses_data->mutex);
 
@@ -625,6 +987,83 @@ static gint unload_sm(struct pa_qst_module_data *m_data,
     return ret;
 }
 
+static void sound_model_memfd_release(struct pa_qst_sm_memfd *m) {
+    if (m->map)
+        munmap(m->map, m->size);
+    if (m->fd >= 0)
+        close(m->fd);
+    m->map = NULL;
+    m->size = 0;
+    m->fd = -1;
+}
+
+/* moves slot i to the front, the slots before it move down one */
+static void sound_model_memfd_use(struct pa_qst_module_data *m_data, guint i) {
+    struct pa_qst_sm_memfd m = m_data->sm_memfds[i];
+
+    memmove(&m_data->sm_memfds[1], &m_data->sm_memfds[0], i * sizeof(m));
+    m_data->sm_memfds[0] = m;
+}
+
+/*
+ * Sealed copy of the opaque sound model data, the server maps it instead of
+ * getting it in the message. The memfd is kept and a dup of it is sent again
+ * for the same model, so the server can find the payload it built for it
+ * without reading the model.
+ */
+static gint sound_model_memfd(struct pa_qst_module_data *m_data, const void *data, size_t size) {
+    const gchar *p = (const gchar *)data;
+    struct pa_qst_sm_memfd *m;
+    ssize_t written;
+    guint i;
+    gint fd;
+
+    for (i = 0; i < PA_QST_SM_MEMFDS; i++) {
+        m = &m_data->sm_memfds[i];
+        if (m->fd >= 0 && m->size == size && (!size || !memcmp(m->map, data, size))) {
+            sound_model_memfd_use(m_data, i);
+            return fcntl(m_data->sm_memfds[0].fd, F_DUPFD_CLOEXEC, 0);
+        }
+    }
+
+    fd = memfd_create("pa-qst-sm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return -1;
+
+    while (size > 0) {
+        written = write(fd, p, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            goto fail;
+        p += written;
+        size -= written;
+    }
+
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+        goto fail;
+
+    /* only kept if it can be compared with the next model, in place of the least recently used one */
+    size = p - (const gchar *)data;
+    m = &m_data->sm_memfds[PA_QST_SM_MEMFDS - 1];
+    sound_model_memfd_release(m);
+    if (size && (m->map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        m->map = NULL;
+        return fd;
+    }
+
+    m->fd = fd;
+    m->size = size;
+    sound_model_memfd_use(m_data, PA_QST_SM_MEMFDS - 1);
+
+    return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+fail:
+    g_printerr("Could not pass sound model in a memfd: %s\n", g_strerror(errno));
+    close(fd);
+    return -1;
+}
+
 gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
                              pal_param_payload *prm_payload,
                              void *cookie,
@@ -636,7 +1075,9 @@ gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
     GVariant *argument_1, *argument_2, *argument_load;
     GError *error = NULL;
     GVariantBuilder builder_1;
-    gint i = 0, j = 0;
+    GUnixFDList *fd_list = NULL;
+    gint i = 0, j = 0, fd = -1;
+    const gchar *method;
     struct pal_st_phrase_sound_model *sound_model = NULL;
     struct pa_qst_session_data *ses_data = NULL;
     struct pa_qst_module_data *m_data = NULL;
@@ -696,10 +1137,6 @@ gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
     }
     value_3 = g_variant_builder_end(&builder_1);
 
-    value_4 = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
-        (gconstpointer)((gchar *)sound_model + sound_model->common.data_offset),
-        sound_model->common.data_size, sizeof(guchar));
-
     argument_1 = g_variant_new("(@i@(uuuu)@(uqqqay)@(uqqqay))",
                                g_variant_new_int32(sound_model->common.type),
                                value_0,
@@ -710,27 +1147,57 @@ gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
                                argument_1,
                                value_3);
 
-    argument_load = g_variant_new("(@((i(uuuu)(uqqqay)(uqqqay))a(uuauss))@ay)",
-                               argument_2,
-                               value_4);
+    if (m_data->interface_version >= PA_QST_DBUS_MODULE_IFACE_VERSION_103)
+        fd = sound_model_memfd(m_data, (gchar *)sound_model + sound_model->common.data_offset,
+                               sound_model->common.data_size);
 
     /*
      * Use global obj and intf path to call LoadSoundModel which
      * will return per session obj path.
      */
-    result = g_dbus_connection_call_sync(m_data->conn,
-                            NULL, /* bus_name */
-                            m_data->g_obj_path,
-                            PA_QST_DBUS_MODULE_IFACE,
-                            "LoadSoundModel",
-                            argument_load,
-                            G_VARIANT_TYPE("(o)"),
-                            G_DBUS_CALL_FLAGS_NONE,
-                            -1,
-                            NULL,
-                            &error);
+    if (fd >= 0) {
+        /* the list owns fd from here on */
+        fd_list = g_unix_fd_list_new_from_array(&fd, 1);
+        argument_load = g_variant_new("(@((i(uuuu)(uqqqay)(uqqqay))a(uuauss))h)",
+                                   argument_2,
+                                   0 /* index in fd_list */);
+        method = "LoadSoundModelFd";
+        result = g_dbus_connection_call_with_unix_fd_list_sync(m_data->conn,
+                                NULL, /* bus_name */
+                                m_data->g_obj_path,
+                                PA_QST_DBUS_MODULE_IFACE,
+                                method,
+                                argument_load,
+                                G_VARIANT_TYPE("(o)"),
+                                G_DBUS_CALL_FLAGS_NONE,
+                                -1,
+                                fd_list,
+                                NULL,
+                                NULL,
+                                &error);
+        g_object_unref(fd_list);
+    } else {
+        value_4 = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
+            (gconstpointer)((gchar *)sound_model + sound_model->common.data_offset),
+            sound_model->common.data_size, sizeof(guchar));
+        argument_load = g_variant_new("(@((i(uuuu)(uqqqay)(uqqqay))a(uuauss))@ay)",
+                                   argument_2,
+                                   value_4);
+        method = "LoadSoundModel";
+        result = g_dbus_connection_call_sync(m_data->conn,
+                                NULL, /* bus_name */
+                                m_data->g_obj_path,
+                                PA_QST_DBUS_MODULE_IFACE,
+                                method,
+                                argument_load,
+                                G_VARIANT_TYPE("(o)"),
+                                G_DBUS_CALL_FLAGS_NONE,
+                                -1,
+                                NULL,
+                                &error);
+    }
     if (result == NULL) {
-        g_printerr ("Error invoking LoadSoundModel(): %s\n", error->message);
+        g_printerr ("Error invoking %s(): %s\n", method, error->message);
         g_error_free(error);
         goto exit;
     }
@@ -741,6 +1208,7 @@ gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
 
     /* parse sm handle from object path */
     ses_handle = parse_ses_handle(ses_data->obj_path);
+    ses_data->handle = ses_handle;
 
     /* Start threadloop to listen to signals from server */
     snprintf(thread_name, sizeof(thread_name), "pa_loop_%d", ses_handle);
@@ -771,6 +1239,11 @@ gint pa_qst_load_sound_model(const pa_qst_handle_t *mod_handle,
         g_warning("Failed to subscribe for stop buffering event");
     }
 
+    /* older servers or no fd passing, reads fall back to byte arrays */
+    ses_data->lab_ring = NULL;
+    if (map_lab_ring(m_data, ses_data))
+        g_printf("lab ring not available, reading over D-Bus\n");
+
     /* add session to module hash table */
     g_hash_table_insert(m_data->ses_hash_table, GINT_TO_POINTER(ses_handle), ses_data);
     *handle = ses_handle;
@@ -1146,6 +1619,7 @@ int pa_qst_read_buffer(const pa_qst_handle_t *mod_handle,
     GVariant *argument = NULL;
     gint64 start_time, end_time;
     guint last_read_sequence;
+    gsize offset, first;
 
     if (!m_data || !buf) {
         g_printf("Invalid input params\n");
@@ -1161,7 +1635,75 @@ int pa_qst_read_buffer(const pa_qst_handle_t *mod_handle,
         goto exit;
     }
 
-    if (m_data->interface_version < PA_QST_DBUS_MODULE_IFACE_VERSION_101) {
+    if (ses_data->read_callback) {
+        g_printerr("[%d]asynchronous read in progress\n", handle);
+        goto exit;
+    }
+
+    if (ses_data->lab_ring) {
+        g_mutex_lock(&ses_data->mutex);
+        last_read_sequence = ses_data->read_buffer_sequence;
+        g_mutex_unlock(&ses_data->mutex);
+
+        /* the read index tells the server which part of the ring is free again */
+        argument = g_variant_new("(@u@t)",
+                    g_variant_new_uint32(MIN(bytes, ses_data->lab_ring_size)),
+                    g_variant_new_uint64(ses_data->lab_read_index));
+        result = g_dbus_connection_call_sync(m_data->conn,
+                            NULL,
+                            ses_data->obj_path,
+                            PA_QST_DBUS_SESSION_IFACE,
+                            "RequestLabRead",
+                            argument,
+                            NULL,
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            NULL,
+                            &error);
+        if (result == NULL) {
+            g_printerr ("Error invoking RequestLabRead(): %s\n", error->message);
+            g_error_free(error);
+            goto exit;
+        }
+        g_variant_unref(result);
+
+        end_time = g_get_monotonic_time() + (PA_QST_DBUS_ASYNC_CALL_TIMEOUT_MS * G_TIME_SPAN_MILLISECOND);
+        g_mutex_lock(&ses_data->mutex);
+        while (ses_data->read_buffer_sequence == last_read_sequence &&
+               g_get_monotonic_time() < end_time) {
+           g_cond_wait_until(&ses_data->cond, &ses_data->mutex, end_time);
+        }
+        if (ses_data->read_buffer_sequence == last_read_sequence || ses_data->lab_read_status < 0) {
+            g_printerr("[%d]error obtaining lab read, read sequence %u, status %d\n",
+                       handle, ses_data->read_buffer_sequence, ses_data->lab_read_status);
+            g_mutex_unlock(&ses_data->mutex);
+            goto exit;
+        }
+        /* a new capture started after our last read, what we had not read is gone */
+        if (ses_data->lab_server_read_index > ses_data->lab_read_index)
+            ses_data->lab_read_index = ses_data->lab_server_read_index;
+        bytes_received = MIN(bytes, ses_data->lab_write_index - ses_data->lab_read_index);
+        g_mutex_unlock(&ses_data->mutex);
+
+        /* the server does not write over this range until the next request moves the read index */
+        offset = ses_data->lab_read_index % ses_data->lab_ring_size;
+        first = MIN(bytes_received, ses_data->lab_ring_size - offset);
+        memcpy(buf, ses_data->lab_ring + offset, first);
+        memcpy(buf + first, ses_data->lab_ring, bytes_received - first);
+
+        /* a flush since the answer, the copy is audio from before the detection */
+        g_mutex_lock(&ses_data->mutex);
+        if (lab_flush_gen(ses_data) != ses_data->lab_answer_gen) {
+            g_mutex_unlock(&ses_data->mutex);
+            g_printerr("[%d]lab ring flushed during the read, dropping %" G_GSIZE_FORMAT " bytes\n",
+                       handle, bytes_received);
+            memset(buf, 0, bytes);
+            bytes_received = 0;
+            goto exit;
+        }
+        g_mutex_unlock(&ses_data->mutex);
+        ses_data->lab_read_index += bytes_received;
+    } else if (m_data->interface_version < PA_QST_DBUS_MODULE_IFACE_VERSION_101) {
         argument = g_variant_new("(@u)",
                     g_variant_new_uint32(bytes));
         result = g_dbus_connection_call_sync(m_data->conn,
@@ -1251,6 +1793,108 @@ exit:
     return bytes_received;
 }
 
+int pa_qst_start_read(const pa_qst_handle_t *mod_handle,
+                      pa_qst_ses_handle_t handle,
+                      size_t bytes,
+                      unsigned int depth,
+                      pa_qst_read_callback_t callback,
+                      void *cookie) {
+    struct pa_qst_module_data *m_data = (struct pa_qst_module_data *)mod_handle;
+    struct pa_qst_session_data *ses_data;
+
+    if (!m_data || !callback || !bytes || !depth) {
+        g_printf("Invalid input params\n");
+        return -EINVAL;
+    }
+
+    if ((ses_data = (struct pa_qst_session_data *)g_hash_table_lookup(m_data->ses_hash_table,
+                        GINT_TO_POINTER(handle))) == NULL) {
+        g_printerr("No session exists for given handle %d\n", handle);
+        return -EINVAL;
+    }
+
+    if (m_data->interface_version < PA_QST_DBUS_MODULE_IFACE_VERSION_101) {
+        g_printerr("Asynchronous reads not supported on Interface\n");
+        return -ENOSYS;
+    }
+
+    if (ses_data->read_callback) {
+        g_printerr("[%d]asynchronous read already in progress\n", handle);
+        return -EBUSY;
+    }
+
+    /* reads over byte arrays have a single buffer on the server side */
+    if (ses_data->lab_ring) {
+        depth = MIN(depth, PA_QST_MAX_READ_DEPTH);
+        bytes = MIN(bytes, ses_data->lab_ring_size);
+    } else {
+        depth = 1;
+    }
+
+    g_printf("[%d]asynchronous read of %zu bytes, %u outstanding\n", handle, bytes, depth);
+
+    g_mutex_lock(&ses_data->mutex);
+    ses_data->read_chunk = bytes;
+    ses_data->read_delivered = 0;
+    ses_data->read_cookie = cookie;
+    ses_data->read_callback = callback;
+    ses_data->read_depth = depth;
+    ses_data->read_outstanding = 0;
+    refill_reads(m_data->conn, ses_data);
+    g_mutex_unlock(&ses_data->mutex);
+
+    return 0;
+}
+
+int pa_qst_stop_read(const pa_qst_handle_t *mod_handle,
+                     pa_qst_ses_handle_t handle) {
+    struct pa_qst_module_data *m_data = (struct pa_qst_module_data *)mod_handle;
+    struct pa_qst_session_data *ses_data;
+    GVariant *result;
+    GError *error = NULL;
+
+    if (!m_data) {
+        g_printf("Invalid input params\n");
+        return -EINVAL;
+    }
+
+    if ((ses_data = (struct pa_qst_session_data *)g_hash_table_lookup(m_data->ses_hash_table,
+                        GINT_TO_POINTER(handle))) == NULL) {
+        g_printerr("No session exists for given handle %d\n", handle);
+        return -EINVAL;
+    }
+
+    /* waits for a callback in progress, answers still on their way are dropped */
+    g_mutex_lock(&ses_data->mutex);
+    ses_data->read_callback = NULL;
+    ses_data->read_cookie = NULL;
+    ses_data->read_outstanding = 0;
+    g_mutex_unlock(&ses_data->mutex);
+
+    /* so they do not hold the session's read state for a later pa_qst_read_buffer */
+    if (m_data->interface_version >= PA_QST_DBUS_MODULE_IFACE_VERSION_104) {
+        result = g_dbus_connection_call_sync(m_data->conn,
+                            NULL,
+                            ses_data->obj_path,
+                            PA_QST_DBUS_SESSION_IFACE,
+                            "CancelReads",
+                            NULL,
+                            NULL,
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            NULL,
+                            &error);
+        if (result == NULL) {
+            g_printerr("Error invoking CancelReads(): %s\n", error->message);
+            g_error_free(error);
+            return -EIO;
+        }
+        g_variant_unref(result);
+    }
+
+    return 0;
+}
+
 int pa_qst_stop_buffering(const pa_qst_handle_t *mod_handle,
                           pa_qst_ses_handle_t handle) {
     GVariant *result;
@@ -1378,6 +2022,7 @@ pa_qst_handle_t *pa_qst_init(const char *module_name) {
     const gchar *s_address = NULL;
     GError *error = NULL;
     char module_string[128];
+    guint i;
 
     if (!g_strcmp0(module_name, PA_QST_MODULE_ID_PRIMARY)) {
         g_strlcpy(module_string, "primary", sizeof(module_string));
@@ -1414,6 +2059,9 @@ pa_qst_handle_t *pa_qst_init(const char *module_name) {
     /* hash table to retrieve session information */
     m_data->ses_hash_table = g_hash_table_new(g_direct_hash, g_direct_equal);
 
+    for (i = 0; i < PA_QST_SM_MEMFDS; i++)
+        m_data->sm_memfds[i].fd = -1;
+
     /* Initialize module interface version */
     m_data->interface_version = PA_QST_DBUS_MODULE_IFACE_VERSION_DEFAULT;
     pa_qst_update_interface_version(m_data);
@@ -1429,8 +2077,11 @@ exit:
 int pa_qst_deinit(const pa_qst_handle_t *mod_handle) {
     struct pa_qst_module_data *m_data = (struct pa_qst_module_data *)mod_handle;
     GError *error = NULL;
+    guint i;
 
     if (m_data) {
+        for (i = 0; i < PA_QST_SM_MEMFDS; i++)
+            sound_model_memfd_release(&m_data->sm_memfds[i]);
         if (m_data->ses_hash_table) {
             g_hash_table_destroy(m_data->ses_hash_table);
         }
@@ -40,6 +40,20 @@ typedef int pa_qst_ses_handle_t;
 
 typedef void (*pa_qst_recognition_callback_t)(struct pal_st_recognition_event *event,
                                               void *cookie);
+
+/*
+ * Called for each buffer of an asynchronous read, in order, from the
+ * session's signal thread. sequence counts buffers from 1, status is
+ * negative on error. buf is only valid during the call. The session is
+ * locked meanwhile, the callback must not call back into this library for
+ * it; once pa_qst_stop_read returns no further call is made.
+ */
+typedef void (*pa_qst_read_callback_t)(pa_qst_ses_handle_t sound_model_handle,
+                                       int status,
+                                       unsigned int sequence,
+                                       const unsigned char *buf,
+                                       size_t bytes,
+                                       void *cookie);
 /*
  * Below are the API definitions that are used by PA QTI ST client
  */
@@ -81,6 +95,25 @@ int pa_qst_read_buffer(const pa_qst_handle_t *mod_handle,
                        unsigned char *buf,
                        size_t bytes);
 
+/*
+ * Keeps up to depth read requests of at most bytes each outstanding, so
+ * buffers arrive without waiting for a D-Bus round trip. Servers without the
+ * shared lab ring allow one outstanding request. Requests are queued again
+ * after every answer, errors included, and after a detection. An error does
+ * not end the read, pa_qst_stop_read does. pa_qst_read_buffer cannot be used
+ * on the session until pa_qst_stop_read, which also cancels the requests
+ * still queued on servers that support it.
+ */
+int pa_qst_start_read(const pa_qst_handle_t *mod_handle,
+                      pa_qst_ses_handle_t sound_model_handle,
+                      size_t bytes,
+                      unsigned int depth,
+                      pa_qst_read_callback_t callback,
+                      void *cookie);
+
+int pa_qst_stop_read(const pa_qst_handle_t *mod_handle,
+                     pa_qst_ses_handle_t sound_model_handle);
+
 int pa_qst_stop_buffering(const pa_qst_handle_t *mod_handle,
                           pa_qst_ses_handle_t sound_model_handle);
 
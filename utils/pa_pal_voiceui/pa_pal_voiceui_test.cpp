@@ -96,6 +96,7 @@
     "-dch device number of channel\n" \
     "-ope opaque enable(1)/disable(0)\n" \
     "-vendor_uuid vendor uuid for the session\n" \
+    "-lab_read_depth read lab asynchronously with this many reads outstanding\n" \
     "-cmd_file <File name with list of commands to read from>\n"
 
 using namespace std;
@@ -213,6 +214,7 @@ const pa_qst_handle_t *pa_qst_handle;
 static struct sm_session_data sound_trigger_info[MAX_SOUND_TRIGGER_SESSIONS];
 static unsigned int num_sessions;
 static int lab_duration = 5; //5sec is default duration
+static int lab_read_depth = 0; //0 reads lab synchronously
 static int kb_duration_ms = 2000; //2000 msec is default duration
 int total_duration_ms = 0;
 static int generic_payload_size = 0;
@@ -318,6 +320,72 @@ static void process_detection_event(struct sm_session_data *ses_data) {
     printf("%s: start_index: %d end_index: %d\n", __func__, startIndex, endIndex);
 }
 
+struct lab_capture {
+    FILE *fp;
+    size_t bytes_to_skip;
+    size_t bytes_to_read;
+    size_t cur_bytes_read;
+    size_t actual_bytes_read;
+    bool done;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void lab_read_callback(pa_qst_ses_handle_t ses_handle __unused, int status, unsigned int sequence,
+                              const unsigned char *buf, size_t bytes, void *cookie) {
+    struct lab_capture *cap = (struct lab_capture *)cookie;
+
+    pthread_mutex_lock(&cap->lock);
+    if (status < 0) {
+        printf("lab read %u failed with %d\n", sequence, status);
+        cap->done = true;
+    } else if (!cap->done) {
+        if (!(cap->cur_bytes_read < cap->bytes_to_skip)) {
+            if (fwrite(buf, 1, bytes, cap->fp) != bytes) {
+                printf("Error writing lab capture data into file %s\n", strerror(errno));
+                cap->done = true;
+            }
+            cap->actual_bytes_read += bytes;
+        }
+        cap->cur_bytes_read += bytes;
+        if (cap->cur_bytes_read >= cap->bytes_to_read)
+            cap->done = true;
+    }
+    if (cap->done)
+        pthread_cond_signal(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+}
+
+/* the library hands buffers to lab_read_callback as they arrive, returns the bytes written */
+static size_t capture_lab_data_async(pa_qst_ses_handle_t ses_handle, FILE *fp, size_t bytes,
+                                     size_t total_bytes_to_read, size_t bytes_to_skip) {
+    struct lab_capture cap;
+    int rc;
+
+    memset(&cap, 0, sizeof(cap));
+    cap.fp = fp;
+    cap.bytes_to_skip = bytes_to_skip;
+    cap.bytes_to_read = total_bytes_to_read;
+    pthread_mutex_init(&cap.lock, NULL);
+    pthread_cond_init(&cap.cond, NULL);
+
+    rc = pa_qst_start_read(pa_qst_handle, ses_handle, bytes, lab_read_depth, lab_read_callback, &cap);
+    if (rc) {
+        printf("Could not start asynchronous lab read, error %d\n", rc);
+    } else {
+        pthread_mutex_lock(&cap.lock);
+        while (!cap.done)
+            pthread_cond_wait(&cap.cond, &cap.lock);
+        pthread_mutex_unlock(&cap.lock);
+        pa_qst_stop_read(pa_qst_handle, ses_handle);
+    }
+
+    pthread_cond_destroy(&cap.cond);
+    pthread_mutex_destroy(&cap.lock);
+
+    return cap.actual_bytes_read;
+}
+
 static void capture_lab_data(pal_st_recognition_event *event) {
     void *buffer = NULL;
     size_t bytes, written;
@@ -378,7 +446,9 @@ static void capture_lab_data(pal_st_recognition_event *event) {
     header.block_align = header.num_channels * (header.bits_per_sample / 8);
     header.data_id = ID_DATA;
     fseek(fp, sizeof(struct wav_header), 0);
-    while (cur_bytes_read < total_bytes_to_read) {
+    if (lab_read_depth > 0)
+        actual_bytes_read = capture_lab_data_async(ses_handle, fp, bytes, total_bytes_to_read, bytes_to_skip);
+    while (lab_read_depth <= 0 && cur_bytes_read < total_bytes_to_read) {
         bytes_read = pa_qst_read_buffer(pa_qst_handle, ses_handle,
                      (unsigned char *) buffer, bytes);
         if (bytes_read > 0) {
@@ -686,6 +756,9 @@ int main(int argc, char *argv[]) {
         else if ((strcmp(argv[i], "-lab_duration") == 0) && ((i+1) < argc)) {
             lab_duration = atoi(argv[i+1]);
         }
+        else if ((strcmp(argv[i], "-lab_read_depth") == 0) && ((i+1) < argc)) {
+            lab_read_depth = atoi(argv[i+1]);
+        }
         else if ((strcmp(argv[i], "-kb") == 0) && ((i+1) < argc)) {
             keyword_buffer =
                   (0 == strncasecmp(argv[i+1], "true", 4))? true:false;